@@ -0,0 +1,436 @@
+/****************************
+ * bench.cpp:  measures how fast the position heap is built and searched,
+ * on generated texts and on files, and writes the results as JSON
+ * ***************************/
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "heap.h"
+#include "file.h"
+#include "queryContext.h"
+#include "mylist.h"
+
+//  Usage:  bench [-n length] [-q queries] [-o output] [file ...]
+//
+//  Each generated corpus has 'length' characters (default 1000000):
+//  uniform random texts over 2, 4, 20 and 256 letters, a DNA-like text
+//  (ACGT, with mutated copies of earlier stretches, as genomes have), and
+//  three texts with large h(T), the worst case for the heap's height:
+//  a Fibonacci word, a short period repeated, and a single letter
+//  repeated.  Each file named on the command line is a further corpus,
+//  typically natural-language text.
+//
+//  For each corpus the heap is built in a child process, so that the peak
+//  resident set size reported is that of the one heap.  Then, for each
+//  pattern length in PATTERN_LENGTHS, 'queries' patterns (default 2000)
+//  are searched for:  half copied from random places in the text, so
+//  that they occur, and half random strings over the corpus's letters,
+//  which mostly do not.  Each search is timed separately, and the
+//  latencies are grouped by pattern length and by the number of
+//  occurrences found, since a search takes O(m + k) time.  The same 
+//  patterns are then searched again, without timing each search, to 
+//  compare the rate of searches one at a time with that of 
+//  heap::searchBatch, given BATCH_SIZE patterns at a time, which 
+//  interleaves them to overlap their cache misses.
+//
+//  Last, 'queries' patterns are made in groups of DICTIONARY_GROUP that
+//  share a prefix, as a dictionary of related sequences does:  each group
+//  has a base of 20-60 letters copied from the text, and each pattern is
+//  the base cut short by up to 8 letters, with up to 4 random letters
+//  after it.  The patterns are shuffled, then searched as one set three
+//  ways:  one at a time, by searchBatch, and by heap::searchDictionary,
+//  which indexes each shared prefix only once.  Every answer is held at
+//  once, so on a repetitive text only as many patterns are used as have
+//  DICTIONARY_HITS occurrences between them.
+//
+//  The build's own statistics (see heap::getBuildStats) are reported 
+//  too, so that a corpus that makes construction climb far or scan long
+//  sibling lists stands out.  The JSON goes to 'output' (default 
+//  bench.json).  Compile with optimization for meaningful numbers:
+//  make clean; make bench OPT=-O2.
+
+const int PATTERN_LENGTHS[] = {2, 4, 8, 16, 32, 64, 128};
+const int PATTERN_LENGTH_COUNT = sizeof(PATTERN_LENGTHS) / sizeof(int);
+const int BATCH_SIZE = 64;     // patterns per heap::searchBatch
+const int DICTIONARY_GROUP = 50;  // patterns that share a prefix
+const long long DICTIONARY_HITS = 1 << 24;  // most occurrences held at once
+const int HIT_CLASSES = 5;     // 0, 1-9, 10-99, 100-999, 1000 or more
+const char *HIT_CLASS_NAMES[HIT_CLASSES] =
+    {"0", "1-9", "10-99", "100-999", "1000+"};
+
+// seconds on a clock that does not jump
+static double now()
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// writeString:  'text' as a JSON string, with quotes and backslashes 
+//  escaped, as are control characters, which a file name may contain
+static void writeString(FILE *out, const char *text)
+{
+    fputc ('"', out);
+    for (const char *c = text; *c; c++)
+        if (*c == '"' || *c == '\\')
+            fprintf (out, "\\%c", *c);
+        else if ((unsigned char) *c < 0x20)
+            fprintf (out, "\\u%04x", (unsigned char) *c);
+        else
+            fputc (*c, out);
+    fputc ('"', out);
+}
+
+// hitClass:  which of HIT_CLASS_NAMES 'hits' occurrences fall in
+static int hitClass(long long hits)
+{
+    int hitClass = 0;
+    for (long long bound = 1; hitClass < HIT_CLASSES - 1 && hits >= bound;
+             bound *= 10)
+        hitClass++;
+    return hitClass;
+}
+
+// percentile:  the 'fraction' quantile of the sorted 'times'
+static double percentile(const vector<double> &times, double fraction)
+{
+    long index = (long) (fraction * (times.size() - 1) + 0.5);
+    return times[index];
+}
+
+/****************************
+ * generate:  fill 'text' with 'length' characters of the generated corpus
+ * called 'name'; return false if there is no such corpus.
+ * ***************************/
+static bool generate(const char *name, char *text, long length)
+{
+    if (strncmp (name, "random-", 7) == 0)
+    {
+        int sigma = atoi (name + 7);
+        for (long i = 0; i < length; i++)
+            text[i] = (char) (sigma == 256 ? rand() % 256
+                                           : 'a' + rand() % sigma);
+    }
+    else if (strcmp (name, "dna") == 0)
+    {
+        const char *bases = "ACGT";
+        long i = 0;
+        while (i < length)
+        {
+            // a mutated copy of an earlier stretch, or a fresh one ...
+            long stretch = 100 + rand() % 1000;
+            bool copy = i > 2000 && rand() % 4 == 0;
+            long source = copy ? rand() % (i - stretch > 0 ? i - stretch : 1)
+                               : 0;
+            for (long j = 0; j < stretch && i < length; j++, i++)
+                text[i] = copy && rand() % 100 != 0 ? text[source + j]
+                                                    : bases[rand() % 4];
+        }
+    }
+    else if (strcmp (name, "fibonacci") == 0)
+    {
+        // the Fibonacci word is the fixed point of a -> ab, b -> a; its
+        //  i-th letter is b exactly when floor((i+2)/phi) - floor((i+1)/phi)
+        //  is 0
+        const double phi = (1 + sqrt(5.0)) / 2;
+        for (long i = 0; i < length; i++)
+            text[i] = (long) ((i + 2) / phi) - (long) ((i + 1) / phi) == 1
+                          ? 'a' : 'b';
+    }
+    else if (strcmp (name, "periodic") == 0)
+    {
+        for (long i = 0; i < length; i++)
+            text[i] = "abcdefg"[i % 7];
+    }
+    else if (strcmp (name, "unary") == 0)
+        memset (text, 'a', length);
+    else return false;
+    return true;
+}
+
+/****************************
+ * benchDictionary:  time the three ways of searching a dictionary of
+ * 'count' patterns (see the top of this file), and write them to 'out'
+ * as the corpus's "dictionary" field.  Each way holds every answer at
+ * once, as searchDictionary must.
+ * ***************************/
+static void benchDictionary(FILE *out, const heap *H, const char *text,
+                            long length, const vector<char> &alphabet,
+                            int count)
+{
+    vector<char> patterns (count * 64);
+    vector<const char *> patternStarts (count);
+    vector<int> patternLengths (count);
+    const char *base = text;
+    int baseLength = 0;
+    for (int q = 0; q < count; q++)
+    {
+        if (q % DICTIONARY_GROUP == 0)
+        {
+            baseLength = 20 + rand() % 41;
+            base = text + rand() % (length - baseLength + 1);
+        }
+        char *pattern = &patterns[q * 64];
+        int kept = baseLength - rand() % 9;
+        int added = rand() % 5;
+        memcpy (pattern, base, kept);
+        for (int i = 0; i < added; i++)
+            pattern[kept + i] = alphabet[rand() % alphabet.size()];
+        patternStarts[q] = pattern;
+        patternLengths[q] = kept + added;
+    }
+    for (int q = count - 1; q > 0; q--)
+    {
+        int other = rand() % (q + 1);
+        swap (patternStarts[q], patternStarts[other]);
+        swap (patternLengths[q], patternLengths[other]);
+    }
+    long long hits = 0;
+    for (int q = 0; q < count; q++)
+    {
+        hits += H->count (patternStarts[q], patternLengths[q]);
+        if (hits > DICTIONARY_HITS) count = q;
+    }
+
+    vector<mylist *> results (count);
+    double start = now();
+    for (int q = 0; q < count; q++)
+        results[q] = H->search (patternStarts[q], patternLengths[q]);
+    double oneAtATime = now() - start;
+    for (int q = 0; q < count; q++)
+        delete results[q];
+    start = now();
+    for (int q = 0; q < count; q += BATCH_SIZE)
+        H->searchBatch (&patternStarts[q], &patternLengths[q],
+                        min (BATCH_SIZE, count - q), &results[q]);
+    double batched = now() - start;
+    for (int q = 0; q < count; q++)
+        delete results[q];
+    start = now();
+    H->searchDictionary (&patternStarts[0], &patternLengths[0], count, 
+                         &results[0]);
+    double dictionary = now() - start;
+    for (int q = 0; q < count; q++)
+        delete results[q];
+    fprintf (out, ",\n     \"dictionary\": {\"patterns\": %d, "
+                  "\"oneAtATimeSeconds\": %.6f, \"batchedSeconds\": %.6f, "
+                  "\"dictionarySeconds\": %.6f}", count, oneAtATime, batched,
+             dictionary);
+}
+
+/****************************
+ * benchCorpus:  build the heap for 'text', search it, and write one JSON
+ * object describing the results to 'out'.  Runs in a child process, so
+ * the peak RSS is this corpus's alone.
+ * ***************************/
+static void benchCorpus(FILE *out, const char *name, const char *text,
+                        long length, int queries)
+{
+    bool present[256] = {false};
+    for (long i = 0; i < length; i++)
+        present[(unsigned char) text[i]] = true;
+    vector<char> alphabet;
+    for (int c = 0; c < 256; c++)
+        if (present[c]) alphabet.push_back((char) c);
+
+    double start = now();
+    heap *H = heap::create (text, length);
+    double buildSeconds = now() - start;
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+
+    fprintf (out, "    {\"name\": ");
+    writeString (out, name);
+    fprintf (out, ", \"length\": %ld, \"alphabet\": %d, \"indexBytes\": %d,\n",
+             length, (int) alphabet.size(), H->getIndexSize());
+    fprintf (out, "     \"buildSeconds\": %.6f, \"buildCharsPerSecond\": %.0f, "
+                  "\"peakRssKB\": %ld,\n", buildSeconds,
+             length / buildSeconds, usage.ru_maxrss);
+    const buildStats &stats = H->getBuildStats();
+    fprintf (out, "     \"phases\": [");
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+        fprintf (out, "%s{\"name\": \"%s\", \"seconds\": %.6f, "
+                      "\"climbSteps\": %lld, \"bytesAllocated\": %lld}",
+                 phase == 0 ? "" : ",\n                 ", PHASE_NAMES[phase],
+                 stats.phases[phase].seconds, stats.phases[phase].climbSteps,
+                 stats.phases[phase].bytesAllocated);
+    fprintf (out, "],\n     \"scanHistogram\": [");
+    for (int bucket = 0; bucket < SCAN_BUCKETS; bucket++)
+        fprintf (out, "%s%lld", bucket == 0 ? "" : ", ",
+                 stats.scanHistogram[bucket]);
+    fprintf (out, "], \"indexedLookups\": %lld, \"maxDepth\": %lld, "
+                  "\"peakBytes\": %lld, \"heapBytes\": %lld,\n",
+             stats.indexedLookups, stats.maxDepth, stats.peakBytes,
+             H->memoryUsage().total);
+    fprintf (out, "     \"search\": [");
+
+    queryContext context;
+    vector<char> patterns (queries * 128);
+    vector<const char *> patternStarts (queries);
+    vector<int> patternLengths (queries);
+    vector<mylist *> results (BATCH_SIZE);
+    vector<double> oneAtATime, batched;   // searches per second, by length
+    bool first = true;
+    for (int l = 0; l < PATTERN_LENGTH_COUNT; l++)
+    {
+        int patternLength = PATTERN_LENGTHS[l];
+        if (patternLength > length) break;
+        vector<double> times[HIT_CLASSES];
+        for (int q = 0; q < queries; q++)
+        {
+            char *pattern = &patterns[q * 128];
+            patternStarts[q] = pattern;
+            patternLengths[q] = patternLength;
+            if (q % 2 == 0)
+                memcpy (pattern, text + rand() % (length - patternLength + 1),
+                        patternLength);
+            else
+                for (int i = 0; i < patternLength; i++)
+                    pattern[i] = alphabet[rand() % alphabet.size()];
+            double searchStart = now();
+            long long hits = H->search (pattern, patternLength, context);
+            times[hitClass (hits)].push_back ((now() - searchStart) * 1e6);
+        }
+        for (int c = 0; c < HIT_CLASSES; c++)
+        {
+            if (times[c].empty()) continue;
+            sort (times[c].begin(), times[c].end());
+            fprintf (out, "%s\n       {\"patternLength\": %d, \"hits\": \"%s\", "
+                          "\"queries\": %d, \"p50Us\": %.3f, \"p90Us\": %.3f, "
+                          "\"p99Us\": %.3f, \"maxUs\": %.3f}",
+                     first ? "" : ",", patternLength, HIT_CLASS_NAMES[c],
+                     (int) times[c].size(), percentile (times[c], 0.5),
+                     percentile (times[c], 0.9), percentile (times[c], 0.99),
+                     times[c].back());
+            first = false;
+        }
+
+        // (each way holds BATCH_SIZE lists at once, so that both pay the 
+        //  same for memory)
+        double searchStart = now();
+        for (int q = 0; q < queries; q += BATCH_SIZE)
+        {
+            int batchSize = min (BATCH_SIZE, queries - q);
+            for (int i = 0; i < batchSize; i++)
+                results[i] = H->search (patternStarts[q + i], patternLength);
+            for (int i = 0; i < batchSize; i++)
+                delete results[i];
+        }
+        oneAtATime.push_back (queries / (now() - searchStart));
+        searchStart = now();
+        for (int q = 0; q < queries; q += BATCH_SIZE)
+        {
+            int batchSize = min (BATCH_SIZE, queries - q);
+            H->searchBatch (&patternStarts[q], &patternLengths[q], batchSize,
+                            &results[0]);
+            for (int i = 0; i < batchSize; i++)
+                delete results[i];
+        }
+        batched.push_back (queries / (now() - searchStart));
+    }
+    fprintf (out, "],\n     \"throughput\": [");
+    for (unsigned l = 0; l < batched.size(); l++)
+        fprintf (out, "%s\n       {\"patternLength\": %d, "
+                      "\"oneAtATimePerSecond\": %.0f, "
+                      "\"batchedPerSecond\": %.0f}",
+                 l == 0 ? "" : ",", PATTERN_LENGTHS[l], oneAtATime[l], 
+                 batched[l]);
+    fprintf (out, "]");
+    if (length >= 60)
+        benchDictionary (out, H, text, length, alphabet, queries);
+    fprintf (out, "}");
+    delete H;
+}
+
+int main (int argc, char **argv)
+{
+    long length = 1000000;
+    int queries = 2000;
+    const char *outputFilename = "bench.json";
+    int option;
+    while ((option = getopt (argc, argv, "n:q:o:")) != -1)
+    {
+        if (option == 'n') length = atol (optarg);
+        else if (option == 'q') queries = atoi (optarg);
+        else if (option == 'o') outputFilename = optarg;
+        else
+        {
+            cout << "usage: bench [-n length] [-q queries] [-o output] "
+                    "[file ...]\n";
+            exit(1);
+        }
+    }
+    if (length < 1 || queries < 0)
+       {cout << "bench:  the length must be positive\n"; exit(1);}
+
+    FILE *out = fopen (outputFilename, "w");
+    if (!out)
+    {
+        cout << "Attempt to open " << outputFilename << " failed.\n";
+        exit(1);
+    }
+    fprintf (out, "{\"benchmark\": \"position heap\", \"queries\": %d,\n"
+                  " \"corpora\": [\n", queries);
+
+    const char *generated[] = {"random-2", "random-4", "random-20",
+                               "random-256", "dna", "fibonacci", "periodic",
+                               "unary"};
+    int generatedCount = sizeof(generated) / sizeof(char *);
+    int corpusCount = generatedCount + argc - optind;
+    for (int corpus = 0; corpus < corpusCount; corpus++)
+    {
+        const char *name = corpus < generatedCount
+                               ? generated[corpus]
+                               : argv[optind + corpus - generatedCount];
+        cout << "Benchmarking " << name << " ...\n";
+        fflush (out);
+        cout.flush();
+        pid_t child = fork();
+        if (child < 0) {cout << "bench:  fork failed\n"; exit(1);}
+        if (child == 0)
+        {
+            srand (corpus + 1);
+            if (corpus > 0) fprintf (out, ",\n");
+            if (corpus < generatedCount)
+            {
+                char *text = new char[length];
+                generate (name, text, length);
+                benchCorpus (out, name, text, length, queries);
+                delete []text;
+            }
+            else
+            {
+                long textLength;
+                char *text = fileMap (name, textLength, false);
+                if (!text)
+                {
+                    cout << "bench:  cannot map " << name << "\n";
+                    _exit(1);
+                }
+                benchCorpus (out, name, text, textLength, queries);
+                fileUnmap (text, textLength);
+            }
+            fclose (out);
+            _exit(0);
+        }
+        int status;
+        waitpid (child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            cout << "bench:  benchmarking " << name << " failed\n";
+            exit(1);
+        }
+    }
+    fprintf (out, "\n ]}\n");
+    fclose (out);
+    return 0;
+}
@@ -0,0 +1,208 @@
+/****************************
+ * bitVector.cpp:  arrays of bits and of small integers, for the succinct
+ * heap (see succinctHeap.cpp)
+ * **************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include "bitVector.h"
+using std::cout;
+
+//  rank(i) is the number of ones before bit i, and select(k) is the
+//  position of the one of rank k (counted from 0).  rank adds the count
+//  kept for the block of RANK_BLOCK words that contains bit i to the ones
+//  in the words before it within the block.  select starts at the block
+//  that holds the nearest sampled one below it and moves forward a block
+//  at a time, which is O(1) as long as the ones are not sparse; the
+//  parentheses of a tree, half of which are ones, are never sparse.  The
+//  directories take about a quarter of a bit per bit.
+
+const int RANK_BLOCK = 8;          // words per block, 512 bits
+const int SELECT_SAMPLE = 512;     // ones between samples
+
+bitVector::bitVector(long long length)
+{
+    this->length = length;
+    wordCount = length / 64 + 1;
+    words = new uint64_t[wordCount];
+    if (!words)
+       {cout << "Memory allocation failure in bitVector\n"; exit(1);}
+    memset (words, 0, wordCount * sizeof(uint64_t));
+    blockRanks = selectSamples = NULL;
+    blockCount = sampleCount = 0;
+    ones = 0;
+}
+
+bitVector::~bitVector()
+{
+    delete []words;
+    delete []blockRanks;
+    delete []selectSamples;
+}
+
+void bitVector::set(long long i)
+{
+    words[i >> 6] |= 1ULL << (i & 63);
+}
+
+bool bitVector::get(long long i) const
+{
+    return (words[i >> 6] >> (i & 63)) & 1;
+}
+
+/****************************
+ * finish:  build the rank and select directories, after the last set
+ * **************************/
+void bitVector::finish()
+{
+    blockCount = (wordCount + RANK_BLOCK - 1) / RANK_BLOCK;
+    blockRanks = new long long[blockCount + 1];
+    if (!blockRanks)
+       {cout << "Memory allocation failure in bitVector\n"; exit(1);}
+    ones = 0;
+    for (long long b = 0; b < blockCount; b++)
+    {
+        blockRanks[b] = ones;
+        for (long long w = b * RANK_BLOCK;
+                 w < (b + 1) * RANK_BLOCK && w < wordCount; w++)
+            ones += __builtin_popcountll (words[w]);
+    }
+    blockRanks[blockCount] = ones;
+
+    sampleCount = ones / SELECT_SAMPLE + 1;
+    selectSamples = new long long[sampleCount];
+    if (!selectSamples)
+       {cout << "Memory allocation failure in bitVector\n"; exit(1);}
+    long long block = 0;
+    for (long long s = 0; s < sampleCount; s++)
+    {
+        while (blockRanks[block + 1] <= s * SELECT_SAMPLE
+                   && block + 1 < blockCount)
+            block++;
+        selectSamples[s] = block;
+    }
+}
+
+// rank:  the number of ones in bits 0 .. i-1
+long long bitVector::rank(long long i) const
+{
+    long long word = i >> 6;
+    long long count = blockRanks[word / RANK_BLOCK];
+    for (long long w = word / RANK_BLOCK * RANK_BLOCK; w < word; w++)
+        count += __builtin_popcountll (words[w]);
+    if (i & 63)
+        count += __builtin_popcountll (words[word] << (64 - (i & 63)));
+    return count;
+}
+
+// select:  the position of the one with 'k' ones before it
+long long bitVector::select(long long k) const
+{
+    long long block = selectSamples[k / SELECT_SAMPLE];
+    while (blockRanks[block + 1] <= k)
+        block++;
+    long long remaining = k - blockRanks[block];
+    long long w = block * RANK_BLOCK;
+    for (;;)
+    {
+        int count = __builtin_popcountll (words[w]);
+        if (remaining < count) break;
+        remaining -= count;
+        w++;
+    }
+    uint64_t bits = words[w];
+    for ( ; remaining > 0; remaining--)
+        bits &= bits - 1;    // clear the lowest one
+    return w * 64 + __builtin_ctzll (bits);
+}
+
+long long bitVector::getLength() const
+{
+    return length;
+}
+
+long long bitVector::getOnes() const
+{
+    return ones;
+}
+
+// getWords:  the bits themselves, for scanning many at once
+const uint64_t *bitVector::getWords() const
+{
+    return words;
+}
+
+long long bitVector::memoryUsage() const
+{
+    return wordCount * sizeof(uint64_t)
+           + (blockCount + 1 + sampleCount) * sizeof(long long);
+}
+
+/****************************
+ * packedArray:  'length' integers of 'width' bits each, all zero.  The
+ * integers are laid end to end in 64-bit words, so one may straddle two.
+ * **************************/
+packedArray::packedArray(long long length, int width)
+{
+    this->length = length;
+    this->width = width;
+    wordCount = (length * width) / 64 + 2;
+    words = new uint64_t[wordCount];
+    if (!words)
+       {cout << "Memory allocation failure in packedArray\n"; exit(1);}
+    memset (words, 0, wordCount * sizeof(uint64_t));
+}
+
+packedArray::~packedArray()
+{
+    delete []words;
+}
+
+// set:  store 'value' as integer i, which must not have been set before
+void packedArray::set(long long i, uint64_t value)
+{
+    writeBits (words, i * width, width, value);
+}
+
+uint64_t packedArray::get(long long i) const
+{
+    return readBits (words, i * width, width);
+}
+
+long long packedArray::memoryUsage() const
+{
+    return wordCount * sizeof(uint64_t);
+}
+
+// widthOf:  the number of bits 'value' takes, at least 1
+int packedArray::widthOf(uint64_t value)
+{
+    return value == 0 ? 1 : 64 - __builtin_clzll (value);
+}
+
+// readBits:  the 'width' bits from bit 'bit' of 'words', which must have
+//  a word to spare after them
+uint64_t packedArray::readBits(const uint64_t *words, long long bit,
+                               int width)
+{
+    if (width == 0) return 0;
+    long long word = bit >> 6;
+    int shift = bit & 63;
+    uint64_t value = words[word] >> shift;
+    if (shift + width > 64)
+        value |= words[word + 1] << (64 - shift);
+    return width == 64 ? value : value & ((1ULL << width) - 1);
+}
+
+// writeBits:  store 'value' in the 'width' bits from bit 'bit', which
+//  must be zero
+void packedArray::writeBits(uint64_t *words, long long bit, int width,
+                            uint64_t value)
+{
+    if (width == 0) return;
+    long long word = bit >> 6;
+    int shift = bit & 63;
+    words[word] |= value << shift;
+    if (shift + width > 64)
+        words[word + 1] |= value >> (64 - shift);
+}
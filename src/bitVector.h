@@ -0,0 +1,53 @@
+/*************************
+  bitVector.h:  see bitVector.cpp
+ ************************/
+#include <stdint.h>
+
+// A fixed-length array of bits that answers rank and select in O(1) time
+//  once it is finished
+class bitVector
+{
+    public:
+        bitVector (long long length);
+        ~bitVector ();
+        void set (long long i);
+        bool get (long long i) const;
+        void finish ();
+        long long rank (long long i) const;
+        long long select (long long k) const;
+        long long getLength () const;
+        long long getOnes () const;
+        const uint64_t *getWords () const;
+        long long memoryUsage () const;
+    private:
+        uint64_t *words;        // bit i is bit i % 64 of word i / 64
+        long long length;       // number of bits
+        long long wordCount;
+        long long ones;         // number of bits set, once finished
+        long long *blockRanks;  // ones before each block of RANK_BLOCK
+                                //   words, and after the last
+        long long blockCount;
+        long long *selectSamples;  // block of every SELECT_SAMPLE-th one
+        long long sampleCount;
+};
+
+// An array of unsigned integers of a fixed number of bits each
+class packedArray
+{
+    public:
+        packedArray (long long length, int width);
+        ~packedArray ();
+        void set (long long i, uint64_t value);
+        uint64_t get (long long i) const;
+        long long memoryUsage () const;
+        static int widthOf (uint64_t value);
+        static uint64_t readBits (const uint64_t *words, long long bit,
+                                  int width);
+        static void writeBits (uint64_t *words, long long bit, int width,
+                               uint64_t value);
+    private:
+        uint64_t *words;
+        long long length;
+        long long wordCount;
+        int width;              // bits per integer, at most 64
+};
@@ -0,0 +1,122 @@
+/****************************
+ * checkApprox.cpp:  checks approximateSearch (see heap.cpp) against a
+ * brute-force comparison at every offset of the text:  a count of
+ * mismatches, and the edit-distance dynamic program.  Run by 'make
+ * check'; exits with status 1 at the first wrong answer.
+ * ***************************/
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "heap.h"
+#include "mylist.h"
+
+const int TRIALS = 40;          // texts
+const int QUERIES = 60;         // patterns searched for in each text
+const int MAX_ERRORS = 3;
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// withinMismatches:  whether the pattern matches the text at 'start' with
+//  at most 'k' letters different
+static bool withinMismatches(const string &text, long long start,
+                             const string &pattern, int k)
+{
+    if (start + pattern.size() > text.size()) return false;
+    int mismatches = 0;
+    for (size_t j = 0; j < pattern.size(); j++)
+        if (text[start + j] != pattern[j]) mismatches++;
+    return mismatches <= k;
+}
+
+// withinEdits:  whether some prefix of the text from 'start' on is within
+//  edit distance 'k' of the pattern; distance[j] is the edit distance
+//  from the first j letters of the pattern to the prefix read so far
+static bool withinEdits(const string &text, long long start,
+                        const string &pattern, int k)
+{
+    int m = pattern.size();
+    vector<int> distance (m + 1), next (m + 1);
+    for (int j = 0; j <= m; j++)
+        distance[j] = j;
+    if (distance[m] <= k) return true;
+    for (size_t i = start; i < text.size(); i++)
+    {
+        next[0] = distance[0] + 1;
+        for (int j = 1; j <= m; j++)
+            next[j] = min (min (distance[j] + 1, next[j - 1] + 1),
+                           distance[j - 1] + (text[i] != pattern[j - 1]));
+        distance.swap (next);
+        if (distance[m] <= k) return true;
+        if (*min_element (distance.begin(), distance.end()) > k)
+            return false;
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 6;
+        string text = randomLetters (1 + rand() % 800, sigma);
+        long long n = text.size();
+        heap *H = heap::create (text.c_str(), n);
+        for (int q = 0; q < QUERIES; q++)
+        {
+            int k = rand() % (MAX_ERRORS + 1);
+            string pattern;
+            if (q % 2 == 0)   // a stretch of the text with errors put in
+            {
+                int start = rand() % n;
+                pattern = text.substr (start, rand() % 12);
+                for (int e = rand() % (k + 1); e > 0 && pattern.size() > 0;
+                         e--)
+                    pattern[rand() % pattern.size()] = 'a' + rand() % sigma;
+            }
+            else
+                pattern = randomLetters (rand() % 10, sigma);
+
+            for (int model = 0; model < 2; model++)
+            {
+                vector<long long> expected;
+                for (long long start = 0; start < n; start++)
+                    if (model == 0 ? withinMismatches (text, start, pattern, k)
+                                   : withinEdits (text, start, pattern, k))
+                        expected.push_back (n - 1 - start);
+                sort (expected.begin(), expected.end());
+
+                mylist *found = H->approximateSearch (pattern.c_str(),
+                                    pattern.size(), k,
+                                    model == 0 ? MISMATCHES : EDITS);
+                vector<long long> positions (found->getArray(),
+                                             found->getArray()
+                                                 + found->size());
+                delete found;
+                sort (positions.begin(), positions.end());
+                if (positions != expected)
+                {
+                    cout << "checkApprox:  wrong with "
+                         << (model == 0 ? "mismatches" : "edits")
+                         << " in trial " << trial << " for pattern \""
+                         << pattern << "\", k = " << k << ", in text \""
+                         << text << "\"\n";
+                    return 1;
+                }
+            }
+        }
+        delete H;
+    }
+    cout << "checkApprox:  ok\n";
+    return 0;
+}
@@ -0,0 +1,133 @@
+/****************************
+ * checkBatch.cpp:  checks searchBatch (see heap.cpp) against a naive 
+ * search.  The batches are of every size from one pattern to several 
+ * times INTERLEAVED_SEARCHES, so that walks end and are replaced at every
+ * point, and mix patterns copied from the text, which go on through many
+ * X_i, with random ones, which mostly end early.  Some heaps have been
+ * added to at the left or cut at either end, and some have a cache (see
+ * setCache), through which the patterns are searched one at a time.  Run
+ * by 'make check'; exits with status 1 at the first wrong answer.
+ * ***************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "heap.h"
+#include "mylist.h"
+
+const int TRIALS = 60;          // texts
+const int BATCHES = 10;         // batches searched for in each text
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// naiveSearch:  the positions of 'pattern' in 'text' by strstr, numbered
+//  from the right end as the heap numbers them, in ascending order
+static vector<long long> naiveSearch(const string &text,
+                                     const string &pattern)
+{
+    vector<long long> positions;
+    long long n = text.size();
+    const char *found = strstr (text.c_str(), pattern.c_str());
+    while (found)
+    {
+        positions.push_back (n - 1 - (found - text.c_str()));
+        found = strstr (found + 1, pattern.c_str());
+    }
+    sort (positions.begin(), positions.end());
+    return positions;
+}
+
+// randomPattern:  a stretch of the text, perhaps with a letter changed,
+//  or random letters
+static string randomPattern(const string &text, int sigma)
+{
+    if (rand() % 3 == 0)
+        return randomLetters (1 + rand() % 6, sigma + 1);
+    int start = rand() % text.size();
+    string pattern = text.substr (start, 1 + rand() % 40);
+    if (rand() % 4 == 0)
+        pattern[rand() % pattern.size()] = 'a' + rand() % sigma;
+    return pattern;
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 4;
+        string original = randomLetters (20 + rand() % 800, sigma);
+        string text = original;
+        heap *H = heap::create (original.c_str(), original.size());
+        switch (trial % 4)
+        {
+            case 1:
+            {
+                string added = randomLetters (1 + rand() % 100, sigma);
+                H->prepend (added.c_str(), added.size());
+                text = added + text;
+                break;
+            }
+            case 2:
+            {
+                int cut = 1 + rand() % (text.size() / 4);
+                H->deletePrefix (cut);
+                text.erase (0, cut);
+                cut = 1 + rand() % (text.size() / 4);
+                H->deleteSuffix (cut);
+                text.erase (text.size() - cut);
+                break;
+            }
+            case 3:
+                H->setCache (1 << 20, RECENCY_EVICTION);
+                break;
+        }
+
+        for (int b = 0; b < BATCHES; b++)
+        {
+            int patternCount = 1 + rand() % (4 * INTERLEAVED_SEARCHES);
+            vector<string> patterns;
+            vector<const char *> starts;
+            vector<int> lengths;
+            for (int p = 0; p < patternCount; p++)
+                patterns.push_back (randomPattern (text, sigma));
+            for (int p = 0; p < patternCount; p++)
+            {
+                starts.push_back (patterns[p].c_str());
+                lengths.push_back (patterns[p].size());
+            }
+            vector<mylist *> results (patternCount);
+            H->searchBatch (&starts[0], &lengths[0], patternCount,
+                            &results[0]);
+            for (int p = 0; p < patternCount; p++)
+            {
+                vector<long long> positions (results[p]->getArray(),
+                                             results[p]->getArray()
+                                                 + results[p]->size());
+                delete results[p];
+                sort (positions.begin(), positions.end());
+                if (positions != naiveSearch (text, patterns[p]))
+                {
+                    cout << "checkBatch:  wrong in trial " << trial
+                         << " for pattern " << p << " of " << patternCount
+                         << ", \"" << patterns[p] << "\", in text \""
+                         << text << "\"\n";
+                    return 1;
+                }
+            }
+        }
+        delete H;
+    }
+    cout << "checkBatch:  ok\n";
+    return 0;
+}
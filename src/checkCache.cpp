@@ -0,0 +1,153 @@
+/****************************
+ * checkCache.cpp:  checks that a heap with a result cache (see setCache
+ * in heap.cpp) gives the answers of a naive search before and after
+ * prepend, deletePrefix and deleteSuffix, which must drop the answers
+ * the cache holds.  The same few patterns are searched again and again,
+ * so that most searches are answered from the cache.  Run by 'make
+ * check'; exits with status 1 at the first wrong answer.
+ * ***************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "heap.h"
+#include "mylist.h"
+#include "queryContext.h"
+
+const int TRIALS = 60;          // texts, each modified STEPS times
+const int STEPS = 12;
+const int PATTERNS = 30;        // the patterns that are searched for ...
+const int QUERIES = 200;        //   this many times in all after each step
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// naiveSearch:  the positions of 'pattern' in 'text' by strstr, numbered
+//  from the right end as the heap numbers them, in ascending order
+static vector<long long> naiveSearch(const string &text,
+                                     const string &pattern)
+{
+    vector<long long> positions;
+    long long n = text.size();
+    const char *found = strstr (text.c_str(), pattern.c_str());
+    while (found)
+    {
+        positions.push_back (n - 1 - (found - text.c_str()));
+        found = strstr (found + 1, pattern.c_str());
+    }
+    sort (positions.begin(), positions.end());
+    return positions;
+}
+
+// checkQueries:  search for the patterns through each of the cached
+//  calls; false if any answer is wrong
+static bool checkQueries(const heap *H, const string &text,
+                         const vector<string> &patterns)
+{
+    queryContext context;
+    for (int q = 0; q < QUERIES; q++)
+    {
+        const string &pattern = patterns[rand() % patterns.size()];
+        vector<long long> expected = naiveSearch (text, pattern);
+        vector<long long> positions;
+        switch (q % 3)
+        {
+            case 0:
+            {
+                mylist *found = H->search (pattern.c_str(), pattern.size());
+                positions.assign (found->getArray(),
+                                  found->getArray() + found->size());
+                delete found;
+                break;
+            }
+            case 1:
+                H->search (pattern.c_str(), pattern.size(), context);
+                positions.assign (context.getOccurrences(),
+                                  context.getOccurrences() + context.size());
+                break;
+            case 2:
+                if (H->count (pattern.c_str(), pattern.size())
+                            != (long long) expected.size()
+                        || H->contains (pattern.c_str(), pattern.size())
+                               != !expected.empty())
+                {
+                    cout << "checkCache:  count or contains wrong for \""
+                         << pattern << "\"";
+                    return false;
+                }
+                continue;
+        }
+        sort (positions.begin(), positions.end());
+        if (positions != expected)
+        {
+            cout << "checkCache:  search wrong for \"" << pattern << "\"";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    long long hits = 0;
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 4;
+        string original = randomLetters (50 + rand() % 400, sigma);
+        string text = original;
+        heap *H = heap::create (original.c_str(), original.size());
+        H->setCache (trial % 3 == 0 ? 2000 : 1 << 20,
+                     trial % 2 ? FREQUENCY_EVICTION : RECENCY_EVICTION);
+        vector<string> patterns;
+        for (int p = 0; p < PATTERNS; p++)
+            patterns.push_back (randomLetters (1 + rand() % 5, sigma));
+
+        for (int step = 0; step < STEPS; step++)
+        {
+            if (!checkQueries (H, text, patterns))
+            {
+                cout << " in trial " << trial << ", step " << step
+                     << ", in text \"" << text << "\"\n";
+                return 1;
+            }
+            int cut = 1 + rand() % (text.size() / 4);
+            switch (rand() % 3)
+            {
+                case 0:
+                {
+                    string added = randomLetters (1 + rand() % 30, sigma);
+                    H->prepend (added.c_str(), added.size());
+                    text = added + text;
+                    break;
+                }
+                case 1:
+                    H->deletePrefix (cut);
+                    text.erase (0, cut);
+                    break;
+                case 2:
+                    H->deleteSuffix (cut);
+                    text.erase (text.size() - cut);
+                    break;
+            }
+        }
+        hits += H->getCacheStats().hits;
+        delete H;
+    }
+    if (hits == 0)
+    {
+        cout << "checkCache:  no search was answered from the cache\n";
+        return 1;
+    }
+    cout << "checkCache:  ok\n";
+    return 0;
+}
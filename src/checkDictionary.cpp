@@ -0,0 +1,151 @@
+/****************************
+ * checkDictionary.cpp:  checks searchDictionary (see heap.cpp) against a
+ * naive search.  Each set of patterns is grown from a few stems copied 
+ * from the text, the way a blocklist grows:  patterns that extend a stem,
+ * cut it short, or change its last letters, so that they share prefixes
+ * of every length, together with repeats and random patterns, all in 
+ * random order.  Some heaps have been added to at the left or cut at 
+ * either end.  Run by 'make check'; exits with status 1 at the first 
+ * wrong answer.
+ * ***************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "heap.h"
+#include "mylist.h"
+
+const int TRIALS = 60;          // texts
+const int SETS = 6;             // sets of patterns searched for in each text
+const int STEMS = 4;            // stems each set is grown from
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// naiveSearch:  the positions of 'pattern' in 'text' by strstr, numbered
+//  from the right end as the heap numbers them, in ascending order
+static vector<long long> naiveSearch(const string &text,
+                                     const string &pattern)
+{
+    vector<long long> positions;
+    long long n = text.size();
+    const char *found = strstr (text.c_str(), pattern.c_str());
+    while (found)
+    {
+        positions.push_back (n - 1 - (found - text.c_str()));
+        found = strstr (found + 1, pattern.c_str());
+    }
+    sort (positions.begin(), positions.end());
+    return positions;
+}
+
+// patternSet:  patterns grown from stems copied from the text
+static vector<string> patternSet(const string &text, int sigma)
+{
+    vector<string> stems, patterns;
+    for (int s = 0; s < STEMS; s++)
+        stems.push_back (text.substr (rand() % text.size(), 
+                                      1 + rand() % 30));
+    int patternCount = 1 + rand() % 80;
+    for (int p = 0; p < patternCount; p++)
+    {
+        string pattern = stems[rand() % STEMS];
+        switch (rand() % 5)
+        {
+            case 0:   // the stem, and more
+                pattern += randomLetters (1 + rand() % 10, sigma);
+                break;
+            case 1:   // part of it
+                pattern.erase (1 + rand() % pattern.size());
+                break;
+            case 2:   // its last letters changed
+                for (int e = 1 + rand() % 3; e > 0; e--)
+                {
+                    int last = rand() % (pattern.size() / 3 + 1);
+                    pattern[pattern.size() - 1 - last] = 'a' + rand() % 
+                                                         (sigma + 1);
+                }
+                break;
+            case 3:   // one already in the set
+                if (!patterns.empty())
+                    pattern = patterns[rand() % patterns.size()];
+                break;
+            case 4:
+                pattern = randomLetters (1 + rand() % 6, sigma + 1);
+                break;
+        }
+        patterns.push_back (pattern);
+    }
+    return patterns;
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 4;
+        string original = randomLetters (20 + rand() % 800, sigma);
+        string text = original;
+        heap *H = heap::create (original.c_str(), original.size());
+        if (trial % 3 == 1)
+        {
+            string added = randomLetters (1 + rand() % 100, sigma);
+            H->prepend (added.c_str(), added.size());
+            text = added + text;
+        }
+        else if (trial % 3 == 2)
+        {
+            int cut = 1 + rand() % (text.size() / 4);
+            H->deletePrefix (cut);
+            text.erase (0, cut);
+            cut = 1 + rand() % (text.size() / 4);
+            H->deleteSuffix (cut);
+            text.erase (text.size() - cut);
+        }
+
+        for (int set = 0; set < SETS; set++)
+        {
+            vector<string> patterns = patternSet (text, sigma);
+            int patternCount = patterns.size();
+            vector<const char *> starts;
+            vector<int> lengths;
+            for (int p = 0; p < patternCount; p++)
+            {
+                starts.push_back (patterns[p].c_str());
+                lengths.push_back (patterns[p].size());
+            }
+            vector<mylist *> results (patternCount);
+            H->searchDictionary (&starts[0], &lengths[0], patternCount,
+                                 &results[0]);
+            for (int p = 0; p < patternCount; p++)
+            {
+                vector<long long> positions (results[p]->getArray(),
+                                             results[p]->getArray()
+                                                 + results[p]->size());
+                delete results[p];
+                sort (positions.begin(), positions.end());
+                if (positions != naiveSearch (text, patterns[p]))
+                {
+                    cout << "checkDictionary:  wrong in trial " << trial
+                         << " for pattern " << p << " of " << patternCount
+                         << ", \"" << patterns[p] << "\", in text \""
+                         << text << "\"\n";
+                    return 1;
+                }
+            }
+        }
+        delete H;
+    }
+    cout << "checkDictionary:  ok\n";
+    return 0;
+}
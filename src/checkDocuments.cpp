@@ -0,0 +1,140 @@
+/****************************
+ * checkDocuments.cpp:  checks a documentCollection (see
+ * documentCollection.cpp) against a naive search of each document:
+ * search with documentOf, listDocuments, and topDocuments, whose
+ * frequencies are the numbers of occurrences in each document.  Run by
+ * 'make check'; exits with status 1 at the first wrong answer.
+ * ***************************/
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "documentCollection.h"
+#include "mylist.h"
+
+const int TRIALS = 60;          // collections
+const int QUERIES = 60;         // patterns searched for in each
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// occurrences:  the offsets in 'document' where 'pattern' starts
+static vector<long long> occurrences(const string &document,
+                                     const string &pattern)
+{
+    vector<long long> offsets;
+    for (size_t found = document.find (pattern); found != string::npos;
+             found = document.find (pattern, found + 1))
+        offsets.push_back (found);
+    return offsets;
+}
+
+// failure:  report what the collection got wrong and give up
+static void failure(int trial, const char *what,
+                    const vector<string> &documents, const string &pattern)
+{
+    cout << "checkDocuments:  " << what << " wrong in trial " << trial
+         << ", for pattern \"" << pattern << "\" in documents";
+    for (unsigned d = 0; d < documents.size(); d++)
+        cout << " \"" << documents[d] << "\"";
+    cout << '\n';
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 4;
+        int documentCount = 1 + rand() % 30;
+        vector<string> documents;
+        vector<const char *> starts;
+        vector<long long> lengths;
+        for (int d = 0; d < documentCount; d++)
+            documents.push_back (randomLetters (rand() % 40, sigma));
+        for (int d = 0; d < documentCount; d++)
+        {
+            starts.push_back (documents[d].c_str());
+            lengths.push_back (documents[d].size());
+        }
+        documentCollection C (&starts[0], &lengths[0], documentCount);
+
+        for (int q = 0; q < QUERIES; q++)
+        {
+            const string &from = documents[rand() % documentCount];
+            string pattern;
+            if (q % 2 == 0 && from.size() > 0)
+            {
+                int start = rand() % from.size();
+                pattern = from.substr (start, 1 + rand() % (from.size()
+                                                            - start));
+            }
+            else
+                pattern = randomLetters (1 + rand() % 4, sigma);
+            if (q % 10 == 9)   // a separator occurs in no document
+                pattern[rand() % pattern.size()] = SEPARATOR;
+
+            // (document, offset) of each occurrence, and the frequencies
+            vector<pair<long long, long long> > expected;
+            vector<pair<long long, long long> > ranked;   // (-count, d)
+            vector<long long> containing;   // in ascending order
+            for (int d = 0; d < documentCount; d++)
+            {
+                vector<long long> offsets = occurrences (documents[d],
+                                                         pattern);
+                for (unsigned i = 0; i < offsets.size(); i++)
+                    expected.push_back (make_pair (d, offsets[i]));
+                if (offsets.size() > 0)
+                    containing.push_back (d);
+                if (offsets.size() > 0)
+                    ranked.push_back (make_pair (-(long long) offsets.size(),
+                                                 d));
+            }
+            sort (ranked.begin(), ranked.end());
+
+            mylist *found = C.search (pattern.c_str(), pattern.size());
+            vector<pair<long long, long long> > located;
+            for (long long i = 0; i < found->size(); i++)
+            {
+                long long offset;
+                int d = C.documentOf (found->getElement(i), offset);
+                located.push_back (make_pair (d, offset));
+            }
+            delete found;
+            sort (located.begin(), located.end());
+            if (located != expected)
+                failure (trial, "search", documents, pattern);
+
+            mylist *listed = C.listDocuments (pattern.c_str(),
+                                              pattern.size());
+            vector<long long> listedDocuments (listed->getArray(),
+                                               listed->getArray()
+                                                   + listed->size());
+            delete listed;
+            if (listedDocuments != containing)
+                failure (trial, "listDocuments", documents, pattern);
+
+            int k = 1 + rand() % 5;
+            vector<long long> top (k), frequencies (k);
+            int count = C.topDocuments (pattern.c_str(), pattern.size(), k,
+                                        &top[0], &frequencies[0]);
+            bool right = count == min (k, (int) ranked.size());
+            for (int i = 0; right && i < count; i++)
+                right = top[i] == ranked[i].second
+                        && frequencies[i] == -ranked[i].first;
+            if (!right)
+                failure (trial, "topDocuments", documents, pattern);
+        }
+    }
+    cout << "checkDocuments:  ok\n";
+    return 0;
+}
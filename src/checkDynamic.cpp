@@ -0,0 +1,177 @@
+/****************************
+ * checkDynamic.cpp:  checks prepend, deletePrefix and deleteSuffix (see
+ * heap.cpp) against a naive search of the same text, kept alongside, and
+ * that prepending to a periodic text, whose heap is one long path, takes
+ * no more than PERIODIC_SECONDS.  Run by 'make check'; exits with status
+ * 1 at the first wrong answer.
+ * ***************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "heap.h"
+#include "mylist.h"
+
+const int TRIALS = 200;         // texts, each modified STEPS times
+const int STEPS = 30;
+const int QUERIES = 20;         // patterns searched for after each step
+const int PERIODIC_STEPS = 2000;   // times a period is prepended, one 
+const double PERIODIC_SECONDS = 10;   //   call each, and the time allowed
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// naiveSearch:  the positions of 'pattern' in 'text' by strstr, numbered
+//  from the right end as the heap numbers them, in ascending order
+static vector<long long> naiveSearch(const string &text,
+                                     const string &pattern)
+{
+    vector<long long> positions;
+    long long n = text.size();
+    const char *found = strstr (text.c_str(), pattern.c_str());
+    while (found)
+    {
+        positions.push_back (n - 1 - (found - text.c_str()));
+        found = strstr (found + 1, pattern.c_str());
+    }
+    sort (positions.begin(), positions.end());
+    return positions;
+}
+
+// failure:  report what the heap got wrong and give up
+static void failure(int trial, int step, const char *what,
+                    const string &text, const string &pattern)
+{
+    cout << "checkDynamic:  " << what << " wrong in trial " << trial
+         << ", step " << step << ", for pattern \"" << pattern
+         << "\" in text \"" << text << "\"\n";
+    exit(1);
+}
+
+// checkQueries:  search, count and contains for patterns copied from
+//  'text' and random ones
+static void checkQueries(const heap *H, const string &text, int sigma,
+                         int trial, int step)
+{
+    for (int q = 0; q < QUERIES; q++)
+    {
+        string pattern;
+        if (q % 2 == 0)
+        {
+            int start = rand() % text.size();
+            int length = 1 + rand() % min ((int) text.size() - start, 8);
+            pattern = text.substr (start, length);
+        }
+        else
+            pattern = randomLetters (1 + rand() % 4, sigma);
+        vector<long long> expected = naiveSearch (text, pattern);
+
+        mylist *found = H->search (pattern.c_str(), pattern.size());
+        vector<long long> positions (found->getArray(),
+                                     found->getArray() + found->size());
+        delete found;
+        sort (positions.begin(), positions.end());
+        if (positions != expected)
+            failure (trial, step, "search", text, pattern);
+        if (H->count (pattern.c_str(), pattern.size())
+                != (long long) expected.size())
+            failure (trial, step, "count", text, pattern);
+        if (H->contains (pattern.c_str(), pattern.size())
+                != !expected.empty())
+            failure (trial, step, "contains", text, pattern);
+    }
+}
+
+// checkPeriodic:  prepend 'period' PERIODIC_STEPS times, a letter at a
+//  time if 'letters' is true, and the whole of it at once if not
+static void checkPeriodic(const string &period, bool letters, int trial)
+{
+    string text = "b";
+    heap *H = heap::create (text.c_str(), text.size());
+    clock_t start = clock();
+    for (int step = 0; step < PERIODIC_STEPS; step++)
+    {
+        if (letters)
+            for (int i = period.size() - 1; i >= 0; i--)
+                H->prepend (period.c_str() + i, 1);
+        else
+            H->prepend (period.c_str(), period.size());
+        text = period + text;
+    }
+    double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    if (seconds > PERIODIC_SECONDS)
+    {
+        cout << "checkDynamic:  prepending \"" << period << "\" "
+             << PERIODIC_STEPS << " times took " << seconds << " seconds\n";
+        exit(1);
+    }
+    checkQueries (H, text, period.size(), trial, PERIODIC_STEPS);
+    delete H;
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+
+    // an empty text has no position for the root
+    cout.setstate (ios::failbit);
+    heap *empty = heap::create ("", 0);
+    cout.clear();
+    if (empty)
+    {
+        cout << "checkDynamic:  create took an empty text\n";
+        return 1;
+    }
+    checkPeriodic ("ac", false, -1);
+    checkPeriodic ("aaaaa", true, -2);
+    checkPeriodic ("abcab", false, -3);
+
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 6;
+        string original = randomLetters (1 + rand() % 300, sigma);
+        string text = original;
+        heap *H = heap::create (original.c_str(), original.size());
+        for (int step = 0; step < STEPS; step++)
+        {
+            int cut = 1 + rand() % (text.size() / 3 + 1);
+            if (cut >= (int) text.size()) cut = text.size() - 1;
+            switch (rand() % 4)
+            {
+                case 0:
+                case 1:
+                {
+                    string added = randomLetters (1 + rand() % 40, sigma);
+                    H->prepend (added.c_str(), added.size());
+                    text = added + text;
+                    break;
+                }
+                case 2:
+                    if (cut < 1) break;
+                    H->deletePrefix (cut);
+                    text.erase (0, cut);
+                    break;
+                case 3:
+                    if (cut < 1) break;
+                    H->deleteSuffix (cut);
+                    text.erase (text.size() - cut);
+                    break;
+            }
+            if (rand() % 5 == 0) H->layOutSubtrees();
+            checkQueries (H, text, sigma, trial, step);
+        }
+        delete H;
+    }
+    cout << "checkDynamic:  ok\n";
+    return 0;
+}
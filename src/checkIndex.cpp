@@ -0,0 +1,175 @@
+/****************************
+ * checkIndex.cpp:  checks save and load (see heap.cpp).  A heap loaded
+ * from its index file must give the answers of a naive search; an index
+ * file must be turned away when the text has changed, and, when load is
+ * asked to verify, when a byte of the header or of the arrays has been
+ * damaged.  Run by 'make check'; exits with status 1 at the first wrong
+ * answer.
+ * ***************************/
+#include <iostream>
+#include <fstream>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "heap.h"
+#include "mylist.h"
+
+const int TRIALS = 60;          // texts, each saved and loaded
+const int QUERIES = 30;         // patterns searched for in each loaded heap
+const int DAMAGES = 20;         // random bytes damaged in each index file
+const char *INDEX_FILE = "checkIndex.idx";
+
+// bytes that are always in the header or an array:  an array offset in
+//  the header, and the first bytes of the first two aligned blocks
+const long long DAMAGED_BYTES[] = {98, 4096, 8192};
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// naiveSearch:  the positions of 'pattern' in 'text' by strstr, numbered
+//  from the right end as the heap numbers them, in ascending order
+static vector<long long> naiveSearch(const string &text,
+                                     const string &pattern)
+{
+    vector<long long> positions;
+    long long n = text.size();
+    const char *found = strstr (text.c_str(), pattern.c_str());
+    while (found)
+    {
+        positions.push_back (n - 1 - (found - text.c_str()));
+        found = strstr (found + 1, pattern.c_str());
+    }
+    sort (positions.begin(), positions.end());
+    return positions;
+}
+
+// failure:  report what went wrong and give up
+static void failure(int trial, const char *what, const string &text)
+{
+    cout << "checkIndex:  " << what << " in trial " << trial
+         << ", for text \"" << text << "\"\n";
+    remove (INDEX_FILE);
+    exit(1);
+}
+
+// quietLoad:  heap::load, without the message it gives when it turns an
+//  index file away
+static heap *quietLoad(const string &text, bool verify)
+{
+    cout.setstate (ios::failbit);
+    heap *H = heap::load (text.c_str(), text.size(), INDEX_FILE, verify);
+    cout.clear();
+    return H;
+}
+
+// answersRight:  whether search and count agree with a naive search for
+//  patterns copied from 'text' and random ones
+static bool answersRight(const heap *H, const string &text, int sigma)
+{
+    for (int q = 0; q < QUERIES; q++)
+    {
+        string pattern;
+        if (q % 2 == 0)
+        {
+            int start = rand() % text.size();
+            int length = 1 + rand() % min ((int) text.size() - start, 8);
+            pattern = text.substr (start, length);
+        }
+        else
+            pattern = randomLetters (1 + rand() % 4, sigma);
+        vector<long long> expected = naiveSearch (text, pattern);
+        mylist *found = H->search (pattern.c_str(), pattern.size());
+        vector<long long> positions (found->getArray(),
+                                     found->getArray() + found->size());
+        delete found;
+        sort (positions.begin(), positions.end());
+        if (positions != expected
+                || H->count (pattern.c_str(), pattern.size())
+                       != (long long) expected.size())
+            return false;
+    }
+    return true;
+}
+
+// fileBytes:  the whole of the index file
+static string fileBytes()
+{
+    ifstream in (INDEX_FILE, ios::in | ios::binary);
+    return string ((istreambuf_iterator<char> (in)),
+                   istreambuf_iterator<char> ());
+}
+
+// writeBytes:  replace the index file with 'bytes'
+static void writeBytes(const string &bytes)
+{
+    ofstream out (INDEX_FILE, ios::out | ios::binary | ios::trunc);
+    out.write (bytes.data(), bytes.size());
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 6;
+        string text = randomLetters (1 + rand() % 600, sigma);
+        heap *built = heap::create (text.c_str(), text.size());
+        if (trial % 2) built->prepend ("ab", 2);
+        if (trial % 2) text = "ab" + text;
+        built->save (INDEX_FILE);
+        delete built;
+
+        for (int verify = 0; verify < 2; verify++)
+        {
+            heap *H = quietLoad (text, verify);
+            if (!H) failure (trial, "load turned away a good index", text);
+            if (!answersRight (H, text, sigma))
+                failure (trial, "a loaded heap answered wrongly", text);
+            delete H;
+        }
+
+        // the same length with one letter changed, and a shorter text
+        string changed = text;
+        changed[rand() % changed.size()] ^= 0x20;
+        if (quietLoad (changed, true))
+            failure (trial, "load took an index for a changed text", text);
+        string shorter = text.substr (0, text.size() - 1);
+        if (quietLoad (shorter, false))
+            failure (trial, "load took an index for a shorter text", text);
+
+        // damage one byte at a time:  always turned away at the bytes
+        //  that are known to be used, and, at any other byte, either
+        //  turned away or still answering rightly
+        string bytes = fileBytes();
+        int places = sizeof(DAMAGED_BYTES) / sizeof(DAMAGED_BYTES[0]);
+        for (int d = 0; d < places + DAMAGES; d++)
+        {
+            long long at = d < places ? DAMAGED_BYTES[d]
+                                      : rand() % bytes.size();
+            string damaged = bytes;
+            damaged[at] ^= 1 + rand() % 255;
+            writeBytes (damaged);
+            heap *H = quietLoad (text, true);
+            if (H && (d < places || !answersRight (H, text, sigma)))
+            {
+                cout << "checkIndex:  damage at byte " << at
+                     << " not caught;";
+                failure (trial, "load took a damaged index", text);
+            }
+            delete H;
+        }
+        remove (INDEX_FILE);
+    }
+    cout << "checkIndex:  ok\n";
+    return 0;
+}
@@ -0,0 +1,125 @@
+/****************************
+ * checkMatching.cpp:  checks matchingStatistics (see heap.cpp) against a
+ * naive search for the longest match at each offset of the query, and
+ * that each position it gives really holds the match.  The queries are
+ * random, copied from the text, or copied from it with letters changed,
+ * and half the heaps have been added to at the left.  A last text is 
+ * made of copies of one string followed by longer and longer pieces of
+ * another, where the occurrence followed gives out again and again.  Run
+ * by 'make check'; exits with status 1 at the first wrong answer.
+ * ***************************/
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+using namespace std;
+#include "heap.h"
+
+const int TRIALS = 60;          // texts
+const int QUERIES = 20;         // queries for each text
+const int COPIES = 60;          // copies in the last text
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// naiveLength:  the length of the longest match in 'text' of the query
+//  from offset i on, found by trying longer and longer ones
+static long long naiveLength(const string &text, const string &query,
+                             long long i)
+{
+    long long length = 0;
+    while (i + length < (long long) query.size()
+               && text.find (query.substr (i, length + 1)) != string::npos)
+        length++;
+    return length;
+}
+
+// checkQuery:  whether matchingStatistics gives the naive lengths for
+//  'query', and positions that hold them
+static bool checkQuery(const heap *H, const string &text,
+                       const string &query)
+{
+    long long n = text.size(), m = query.size();
+    vector<long long> lengths (m + 1), positions (m + 1);
+    H->matchingStatistics (query.c_str(), m, &lengths[0], &positions[0]);
+    for (long long i = 0; i < m; i++)
+    {
+        if (lengths[i] != naiveLength (text, query, i))
+        {
+            cout << "checkMatching:  length " << lengths[i] 
+                 << " at offset " << i;
+            return false;
+        }
+        if (lengths[i] == 0 ? positions[i] != -1
+                : positions[i] < 0 || positions[i] >= n
+                      || text.compare (n - 1 - positions[i], lengths[i],
+                                       query, i, lengths[i]) != 0)
+        {
+            cout << "checkMatching:  position " << positions[i] 
+                 << " at offset " << i;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 5;
+        string text = randomLetters (1 + rand() % 500, sigma);
+        heap *H = heap::create (text.c_str(), text.size());
+        if (trial % 2)   // a heap that has been added to at the left
+        {
+            string added = randomLetters (1 + rand() % 50, sigma);
+            H->prepend (added.c_str(), added.size());
+            text = added + text;
+        }
+        for (int q = 0; q < QUERIES; q++)
+        {
+            string query;
+            if (q % 3 == 0)
+                query = randomLetters (rand() % 60, sigma + 1);
+            else
+            {
+                int start = rand() % text.size();
+                query = text.substr (start, rand() % 80);
+                if (q % 3 == 2)
+                    query += text.substr (rand() % text.size(), rand() % 40);
+                for (int e = rand() % 4; e > 0 && query.size() > 0; e--)
+                    query[rand() % query.size()] = 'a' + rand() % (sigma + 1);
+            }
+            if (!checkQuery (H, text, query))
+            {
+                cout << " in trial " << trial << " for query \"" << query
+                     << "\", in text \"" << text << "\"\n";
+                return 1;
+            }
+        }
+        delete H;
+    }
+
+    // copies of s followed by the first c letters of tail, for c = ..., 
+    //  1, 0, and a query of s followed by the whole of tail
+    string s = randomLetters (40, 2), tail = randomLetters (COPIES, 2);
+    string text;
+    for (int c = COPIES - 1; c >= 0; c--)
+        text += s + tail.substr (0, c) + "#";
+    heap *H = heap::create (text.c_str(), text.size());
+    if (!checkQuery (H, text, s + tail))
+    {
+        cout << " for copies of \"" << s << "\"\n";
+        return 1;
+    }
+    delete H;
+    cout << "checkMatching:  ok\n";
+    return 0;
+}
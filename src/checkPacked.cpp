@@ -0,0 +1,118 @@
+/****************************
+ * checkPacked.cpp:  checks packedDna (see packedDna.cpp), that it gives
+ * back every letter of texts of bases with runs of N, other letters,
+ * soft-masked stretches and stray bytes, and that a heap built over it
+ * answers as a naive search of the text of bytes does.  Run by 'make
+ * check'; exits with status 1 at the first wrong answer.
+ * ***************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "heap.h"
+#include "packedDna.h"
+#include "mylist.h"
+
+const int TRIALS = 80;          // texts
+const int QUERIES = 40;         // patterns searched for in each
+const char OTHERS[] = "NRYKMSWBDHV-*x\x7f\xe9";   // letters that are not bases
+
+// randomDna:  'length' bases with runs of other letters and lower-case
+//  stretches, both of random lengths, put in here and there
+static string randomDna(int length)
+{
+    string text (length, 'A');
+    for (int i = 0; i < length; i++)
+        text[i] = "ACGT"[rand() % 4];
+    for (int runs = rand() % 6; runs > 0 && length > 0; runs--)
+    {
+        int start = rand() % length;
+        int end = min (length, start + 1 + rand() % 20);
+        char c = OTHERS[rand() % (sizeof(OTHERS) - 1)];
+        for (int i = start; i < end; i++)
+            text[i] = rand() % 8 ? c : OTHERS[rand() % (sizeof(OTHERS) - 1)];
+    }
+    for (int runs = rand() % 4; runs > 0 && length > 0; runs--)
+    {
+        int start = rand() % length;
+        int end = min (length, start + 1 + rand() % 50);
+        for (int i = start; i < end; i++)
+            text[i] = tolower ((unsigned char) text[i]);
+    }
+    return text;
+}
+
+// naiveSearch:  the positions of 'pattern' in 'text' by strstr, numbered
+//  from the right end as the heap numbers them, in ascending order
+static vector<long long> naiveSearch(const string &text,
+                                     const string &pattern)
+{
+    vector<long long> positions;
+    long long n = text.size();
+    const char *found = strstr (text.c_str(), pattern.c_str());
+    while (found)
+    {
+        positions.push_back (n - 1 - (found - text.c_str()));
+        found = strstr (found + 1, pattern.c_str());
+    }
+    sort (positions.begin(), positions.end());
+    return positions;
+}
+
+// failure:  report what went wrong and give up
+static void failure(int trial, const char *what, const string &text,
+                    const string &pattern)
+{
+    cout << "checkPacked:  " << what << " wrong in trial " << trial
+         << ", for pattern \"" << pattern << "\" in text \"" << text
+         << "\"\n";
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        string text = randomDna (1 + rand() % 2000);
+        long long n = text.size();
+        packedDna dna (text.c_str(), n);
+        if (dna.getLength() != n)
+            failure (trial, "getLength", text, "");
+        for (long long i = 0; i < n; i++)
+            if (dna.letter(i) != text[i] || dna[i] != text[i])
+                failure (trial, "letter", text, "");
+
+        heap *H = heap::create (&dna);
+        for (int q = 0; q < QUERIES; q++)
+        {
+            string pattern;
+            if (q % 2 == 0)
+            {
+                int start = rand() % n;
+                pattern = text.substr (start, 1 + rand() % min (n - start,
+                                                                 12LL));
+            }
+            else
+                pattern = randomDna (1 + rand() % 4);
+            vector<long long> expected = naiveSearch (text, pattern);
+            mylist *found = H->search (pattern.c_str(), pattern.size());
+            vector<long long> positions (found->getArray(),
+                                         found->getArray() + found->size());
+            delete found;
+            sort (positions.begin(), positions.end());
+            if (positions != expected)
+                failure (trial, "search", text, pattern);
+            if (H->count (pattern.c_str(), pattern.size())
+                    != (long long) expected.size())
+                failure (trial, "count", text, pattern);
+        }
+        delete H;
+    }
+    cout << "checkPacked:  ok\n";
+    return 0;
+}
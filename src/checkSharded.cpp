@@ -0,0 +1,97 @@
+/****************************
+ * checkSharded.cpp:  checks search, count and contains of a shardedHeap
+ * (see shardedHeap.cpp) against a naive search of the whole text, for
+ * patterns up to the maximum length the shards were built for, which may
+ * lie across the boundary between two shards, and for longer ones.  Run
+ * by 'make check'; exits with status 1 at the first wrong answer.
+ * ***************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "shardedHeap.h"
+#include "mylist.h"
+
+const int TRIALS = 60;          // texts, each cut into shards
+const int QUERIES = 60;         // patterns searched for in each
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// naiveSearch:  the positions of 'pattern' in 'text' by strstr, numbered
+//  from the right end as the heap numbers them, in ascending order
+static vector<long long> naiveSearch(const string &text,
+                                     const string &pattern)
+{
+    vector<long long> positions;
+    long long n = text.size();
+    const char *found = strstr (text.c_str(), pattern.c_str());
+    while (found)
+    {
+        positions.push_back (n - 1 - (found - text.c_str()));
+        found = strstr (found + 1, pattern.c_str());
+    }
+    sort (positions.begin(), positions.end());
+    return positions;
+}
+
+// failure:  report what the shardedHeap got wrong and give up
+static void failure(int trial, const char *what, const shardedHeap &S,
+                    const string &text, const string &pattern)
+{
+    cout << "checkSharded:  " << what << " wrong in trial " << trial
+         << ", with " << S.getShardCount() << " shards for patterns of "
+         << S.getMaxPatternLength() << ", for pattern \"" << pattern
+         << "\" in text \"" << text << "\"\n";
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 4;
+        string text = randomLetters (1 + rand() % 500, sigma);
+        int maxLength = 1 + rand() % 8;
+        shardedHeap S (text.c_str(), text.size(), 1 + rand() % 6, maxLength,
+                       1 + rand() % 3);
+        for (int q = 0; q < QUERIES; q++)
+        {
+            // patterns up to twice the maximum, copied from the text or not
+            int length = 1 + rand() % (2 * maxLength);
+            string pattern;
+            if (q % 2 == 0 && length <= (int) text.size())
+                pattern = text.substr (rand() % (text.size() - length + 1),
+                                       length);
+            else
+                pattern = randomLetters (length, sigma);
+            vector<long long> expected = naiveSearch (text, pattern);
+
+            mylist *found = S.search (pattern.c_str(), pattern.size());
+            vector<long long> positions (found->getArray(),
+                                         found->getArray() + found->size());
+            delete found;
+            sort (positions.begin(), positions.end());
+            if (positions != expected)
+                failure (trial, "search", S, text, pattern);
+            if (S.count (pattern.c_str(), pattern.size())
+                    != (long long) expected.size())
+                failure (trial, "count", S, text, pattern);
+            if (S.contains (pattern.c_str(), pattern.size())
+                    != !expected.empty())
+                failure (trial, "contains", S, text, pattern);
+        }
+    }
+    cout << "checkSharded:  ok\n";
+    return 0;
+}
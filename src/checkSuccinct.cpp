@@ -0,0 +1,154 @@
+/****************************
+ * checkSuccinct.cpp:  checks a succinctHeap (see succinctHeap.cpp), copied
+ * from a heap as built and from one that prepend has modified, against a
+ * naive search of the text, and its isDescendant against the names of
+ * the nodes, found by building the heap naively.  Run by 'make check';
+ * exits with status 1 at the first wrong answer.
+ * ***************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+using namespace std;
+#include "heap.h"
+#include "succinctHeap.h"
+#include "mylist.h"
+#include "queryContext.h"
+
+const int TRIALS = 60;          // texts
+const int QUERIES = 40;         // patterns searched for in each
+const int PAIRS = 200;          // pairs of nodes compared by isDescendant
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// naiveSearch:  the positions of 'pattern' in 'text' by strstr, numbered
+//  from the right end as the heap numbers them, in ascending order
+static vector<long long> naiveSearch(const string &text,
+                                     const string &pattern)
+{
+    vector<long long> positions;
+    long long n = text.size();
+    const char *found = strstr (text.c_str(), pattern.c_str());
+    while (found)
+    {
+        positions.push_back (n - 1 - (found - text.c_str()));
+        found = strstr (found + 1, pattern.c_str());
+    }
+    sort (positions.begin(), positions.end());
+    return positions;
+}
+
+// nodeNames:  the name of the node of each position, which is the
+//  shortest prefix of the text from that position on that is not the
+//  name of a position to its right; position 0, the root, has the empty
+//  name
+static vector<string> nodeNames(const string &text)
+{
+    long long n = text.size();
+    vector<string> names (n);
+    set<string> taken;
+    taken.insert ("");
+    for (long long position = 1; position < n; position++)
+    {
+        long long start = n - 1 - position;
+        int length = 1;
+        while (taken.count (text.substr (start, length)))
+            length++;
+        names[position] = text.substr (start, length);
+        taken.insert (names[position]);
+    }
+    return names;
+}
+
+// failure:  report what the succinctHeap got wrong and give up
+static void failure(int trial, const char *what, const string &text,
+                    const string &pattern)
+{
+    cout << "checkSuccinct:  " << what << " wrong in trial " << trial
+         << ", for \"" << pattern << "\" in text \"" << text << "\"\n";
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 5;
+        string text = randomLetters (1 + rand() % 600, sigma);
+        heap *H = heap::create (text.c_str(), text.size());
+        if (trial % 2)
+        {
+            string added = randomLetters (1 + rand() % 100, sigma);
+            H->prepend (added.c_str(), added.size());
+            text = added + text;
+        }
+        succinctHeap<char> U (H);
+        delete H;
+        long long n = text.size();
+        if (U.getTextLength() != n)
+            failure (trial, "getTextLength", text, "");
+
+        queryContext context;
+        for (int q = 0; q < QUERIES; q++)
+        {
+            string pattern;
+            if (q % 2 == 0)
+            {
+                int start = rand() % n;
+                pattern = text.substr (start, 1 + rand() % min (n - start,
+                                                                 10LL));
+            }
+            else
+                pattern = randomLetters (1 + rand() % 5, sigma);
+            vector<long long> expected = naiveSearch (text, pattern);
+
+            mylist *found = U.search (pattern.c_str(), pattern.size());
+            vector<long long> positions (found->getArray(),
+                                         found->getArray() + found->size());
+            delete found;
+            sort (positions.begin(), positions.end());
+            if (positions != expected)
+                failure (trial, "search", text, pattern);
+            U.search (pattern.c_str(), pattern.size(), context);
+            positions.assign (context.getOccurrences(),
+                              context.getOccurrences() + context.size());
+            sort (positions.begin(), positions.end());
+            if (positions != expected)
+                failure (trial, "search with a queryContext", text, pattern);
+            if (U.count (pattern.c_str(), pattern.size())
+                    != (long long) expected.size())
+                failure (trial, "count", text, pattern);
+            if (U.contains (pattern.c_str(), pattern.size())
+                    != !expected.empty())
+                failure (trial, "contains", text, pattern);
+        }
+
+        // a node is in the subtree of another if the other's name is a
+        //  prefix of its own
+        vector<string> names = nodeNames (text);
+        for (int p = 0; p < PAIRS; p++)
+        {
+            long long position1 = rand() % n, position2 = rand() % n;
+            if (p % 4 == 0) position2 = 0;
+            const string &name1 = names[position1], &name2 = names[position2];
+            bool expected = name1.compare (0, name2.size(), name2) == 0;
+            if (U.isDescendant (position1, position2) != expected)
+                failure (trial, "isDescendant", text,
+                         name1 + "\" under \"" + name2);
+        }
+    }
+    cout << "checkSuccinct:  ok\n";
+    return 0;
+}
@@ -0,0 +1,104 @@
+/****************************
+ * checkWindow.cpp:  checks search within a window of the text (see
+ * heap.cpp), without rangeIndex and with it (see buildRangeIndex), and
+ * after prepend has dropped it, against a naive comparison at every offset
+ * of the window.  Run by 'make check'; exits with status 1 at the first
+ * wrong answer.
+ * ***************************/
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "heap.h"
+#include "mylist.h"
+
+const int TRIALS = 60;          // texts
+const int QUERIES = 40;         // windowed searches for each use of a heap
+
+// randomLetters:  'length' letters drawn from the first 'sigma' of a-z
+static string randomLetters(int length, int sigma)
+{
+    string letters (length, 'a');
+    for (int i = 0; i < length; i++)
+        letters[i] = 'a' + rand() % sigma;
+    return letters;
+}
+
+// naiveWindow:  the offsets from the left of the occurrences of 'pattern'
+//  that lie wholly within text[left .. right], in ascending order
+static vector<long long> naiveWindow(const string &text,
+                                     const string &pattern,
+                                     long long left, long long right)
+{
+    vector<long long> offsets;
+    long long n = text.size(), m = pattern.size();
+    for (long long s = max (left, 0LL); s < n; s++)
+        if (s + max (m, 1LL) - 1 <= right 
+                && s + m <= n && text.compare (s, m, pattern) == 0)
+            offsets.push_back (s);
+    return offsets;
+}
+
+// checkSearches:  windowed searches for patterns copied from 'text' and
+//  random ones, in random windows, some reaching past either end
+static void checkSearches(const heap *H, const string &text, int sigma,
+                          int trial, const char *heapKind)
+{
+    long long n = text.size();
+    for (int q = 0; q < QUERIES; q++)
+    {
+        string pattern;
+        if (q % 2 == 0)
+        {
+            int start = rand() % n;
+            pattern = text.substr (start, rand() % min (n - start + 1,
+                                                         6LL));
+        }
+        else
+            pattern = randomLetters (rand() % 4, sigma);
+        long long left = rand() % (n + 4) - 2;
+        long long right = left + rand() % (n + 2) - 1;
+        vector<long long> expected = naiveWindow (text, pattern, left, 
+                                                  right);
+
+        mylist *found = H->search (pattern.c_str(), pattern.size(), left, 
+                                   right);
+        vector<long long> offsets (found->getArray(),
+                                   found->getArray() + found->size());
+        delete found;
+        if (offsets != expected)
+        {
+            cout << "checkWindow:  search " << heapKind << " wrong in trial "
+                 << trial << ", for pattern \"" << pattern
+                 << "\" in the window " << left << ", " << right
+                 << " of text \"" << text << "\"\n";
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        int sigma = 1 + rand() % 4;
+        string text = randomLetters (1 + rand() % 500, sigma);
+        heap *H = heap::create (text.c_str(), text.size());
+        checkSearches (H, text, sigma, trial, "without rangeIndex");
+        H->buildRangeIndex();
+        checkSearches (H, text, sigma, trial, "with rangeIndex");
+
+        string added = randomLetters (1 + rand() % 50, sigma);
+        H->prepend (added.c_str(), added.size());
+        text = added + text;
+        checkSearches (H, text, sigma, trial, "after prepend");
+        H->buildRangeIndex();
+        checkSearches (H, text, sigma, trial, "with rangeIndex rebuilt");
+        delete H;
+    }
+    cout << "checkWindow:  ok\n";
+    return 0;
+}
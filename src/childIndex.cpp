@@ -0,0 +1,478 @@
+/****************************
+ * childIndex.cpp:  finds the child of a node on a given letter without
+ * scanning a list of siblings, for the nodes of a position heap that have
+ * many children.
+ * **************************/
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "childIndex.h"
+using std::cout;
+
+//  Most nodes of a position heap have few children, and heap::childOnLetter
+//  finds the child it wants by scanning the list of siblings, comparing
+//  the edge label kept in each sibling's downNode.  A node with many
+//  children, such as the root when the alphabet is large, would make that
+//  scan long, so once a node has INDEXED_FANOUT children the heap also
+//  records them here, and childOnLetter looks them up here instead.
+//
+//  A node's children are kept in one of two ways, depending on how many it
+//  has.  Up to TABLE_FANOUT children are kept as an array of edge labels
+//  with a parallel array of children.  Byte labels are compared 16 at a
+//  time with SSE2 instructions, so finding a child takes a few
+//  instructions on one or two cache lines.  Beyond that, the node gets a
+//  table.  For a byte alphabet it is a direct table of TABLE_SIZE 
+//  children indexed by the letter.  Wider letters (see heap.h) cannot 
+//  index a table directly, so theirs is open-addressed:  the letter is 
+//  hashed to an entry, and the labels are compared from there on until 
+//  one matches or an entry is empty.  It starts with TABLE_SIZE entries 
+//  and doubles whenever it is half full, since the root of the heap of a 
+//  token stream may have a child for each of tens of thousands of 
+//  tokens.  Only a few nodes near the root ever get that wide.
+//
+//  All of the labels and children live in two parallel pools, and the
+//  slot that says where a node's part of the pools starts is found with an
+//  open-addressed hash table, so the whole index is a handful of flat
+//  arrays that can be written to an index file and mapped back in.  When a
+//  label array fills up, a larger one is allocated at the end of the pools
+//  and the old one is abandoned, as is a table that is replaced by a 
+//  larger one; the pools at most double because of this.
+//
+//  Node ids and pool offsets are of the heap's Index type, and labels of 
+//  its Symbol type (see heap.h).
+
+const int ARRAY_CAPACITY = 16;   // initial capacity of a label array; a
+                                 //   multiple of 16 for the SSE2 loop
+
+template <class Index, class Symbol>
+childIndex<Index, Symbol>::childIndex()
+{
+    owned = true;
+    hashCapacity = 0;
+    hashNodes = hashSlots = NULL;
+    slotCount = slotCapacity = 0;
+    slotArray = NULL;
+    poolLength = poolCapacity = 0;
+    labelPool = NULL;
+    childPool = NULL;
+}
+
+template <class Index, class Symbol>
+childIndex<Index, Symbol>::~childIndex()
+{
+    freeArrays();
+}
+
+template <class Index, class Symbol>
+void childIndex<Index, Symbol>::freeArrays()
+{
+    if (owned)
+    {
+        delete []hashNodes;
+        delete []hashSlots;
+        delete []slotArray;
+        delete []labelPool;
+        delete []childPool;
+    }
+    owned = true;
+    hashNodes = hashSlots = NULL;
+    slotArray = NULL;
+    labelPool = NULL;
+    childPool = NULL;
+}
+
+// clear:  forget all of the nodes
+template <class Index, class Symbol>
+void childIndex<Index, Symbol>::clear()
+{
+    freeArrays();
+    hashCapacity = 0;
+    slotCount = slotCapacity = 0;
+    poolLength = poolCapacity = 0;
+}
+
+// lookup:  the slot of 'node', which must have been added with addNode
+template <class Index, class Symbol>
+Index childIndex<Index, Symbol>::lookup(Index node) const
+{
+    int shift = 64 - __builtin_ctzll(hashCapacity);
+    Index i = (Index) (((unsigned long long) node * 0x9E3779B97F4A7C15ULL)
+                       >> shift);
+    while (hashNodes[i] != node)
+        i = (i + 1) & (hashCapacity - 1);
+    return hashSlots[i];
+}
+
+// isTable:  whether a node's children are kept in a table, rather than a
+//  label array
+static inline bool isTable(int capacity)
+{
+    return capacity > TABLE_FANOUT;
+}
+
+/****************************
+ * tableEntry:  the entry of the table in 'slot' that holds the child on
+ * 'c', or that would hold it, if there is none, which is then empty.
+ * **************************/
+template <class Index, class Symbol>
+inline Index childIndex<Index, Symbol>::tableEntry(const childSlot<Index> &slot,
+                                                  Symbol c) const
+{
+    if (sizeof(Symbol) == 1)
+        return slot.offset + (unsigned char) c;
+    Index entry = tableHome (slot, c);
+    while (childPool[entry] != NOCHILD && labelPool[entry] != c)
+        entry = entry + 1 == slot.offset + slot.capacity ? slot.offset 
+                                                         : entry + 1;
+    return entry;
+}
+
+// tableHome:  the entry that 'c' hashes to in an open-addressed table
+template <class Index, class Symbol>
+inline Index childIndex<Index, Symbol>::tableHome(const childSlot<Index> &slot,
+                                                 Symbol c) const
+{
+    int shift = 64 - __builtin_ctz(slot.capacity);
+    return slot.offset + (Index) (((unsigned long long) c 
+                                   * 0x9E3779B97F4A7C15ULL) >> shift);
+}
+
+/****************************
+ * find:  the child of 'node' whose edge label is 'c', or NOCHILD
+ * **************************/
+template <class Index, class Symbol>
+Index childIndex<Index, Symbol>::find(Index node, Symbol c) const
+{
+    const childSlot<Index> &slot = slotArray[lookup(node)];
+    if (isTable(slot.capacity))
+        return childPool[tableEntry(slot, c)];
+
+    const Symbol *labels = labelPool + slot.offset;
+#ifdef __SSE2__
+    if (sizeof(Symbol) == 1)
+    {
+        __m128i letter = _mm_set1_epi8(c);
+        for (int i = 0; i < slot.count; i += 16)
+        {
+            __m128i chunk = _mm_loadu_si128((const __m128i *) (labels + i));
+            int matches = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, letter));
+            if (slot.count - i < 16)   // ignore the unused end of the array
+                matches &= (1 << (slot.count - i)) - 1;
+            if (matches)
+                return childPool[slot.offset + i + __builtin_ctz(matches)];
+        }
+        return NOCHILD;
+    }
+#endif
+    for (int i = 0; i < slot.count; i++)
+        if (labels[i] == c)
+            return childPool[slot.offset + i];
+    return NOCHILD;
+}
+
+/****************************
+ * addNode:  start keeping the children of 'node' here.  It has none yet,
+ * as far as the index knows; the caller adds them.
+ * **************************/
+template <class Index, class Symbol>
+void childIndex<Index, Symbol>::addNode(Index node)
+{
+    makeWritable();
+    if (2 * (slotCount + 1) > hashCapacity)
+        growHash();
+    if (slotCount == slotCapacity)
+    {
+        Index newCapacity = slotCapacity ? 2 * slotCapacity : 16;
+        childSlot<Index> *newSlots = new childSlot<Index>[newCapacity];
+        if (!newSlots) {cout << "Memory allocation failure in childIndex\n"; exit(1);}
+        for (Index i = 0; i < slotCount; i++)
+            newSlots[i] = slotArray[i];
+        delete []slotArray;
+        slotArray = newSlots;
+        slotCapacity = newCapacity;
+    }
+    childSlot<Index> &slot = slotArray[slotCount];
+    slot.offset = allocate(ARRAY_CAPACITY);
+    slot.count = 0;
+    slot.capacity = ARRAY_CAPACITY;
+
+    int shift = 64 - __builtin_ctzll(hashCapacity);
+    Index i = (Index) (((unsigned long long) node * 0x9E3779B97F4A7C15ULL)
+                       >> shift);
+    while (hashNodes[i] != NOCHILD)   // an unused entry
+        i = (i + 1) & (hashCapacity - 1);
+    hashNodes[i] = node;
+    hashSlots[i] = slotCount++;
+}
+
+// growHash:  double the hash table, reinserting the nodes
+template <class Index, class Symbol>
+void childIndex<Index, Symbol>::growHash()
+{
+    Index oldCapacity = hashCapacity;
+    Index *oldNodes = hashNodes;
+    Index *oldSlots = hashSlots;
+    hashCapacity = hashCapacity ? 2 * hashCapacity : 64;
+    hashNodes = new Index[hashCapacity];
+    hashSlots = new Index[hashCapacity];
+    if (!hashNodes || !hashSlots)
+        {cout << "Memory allocation failure in childIndex\n"; exit(1);}
+    for (Index i = 0; i < hashCapacity; i++)
+        hashNodes[i] = NOCHILD;
+    int shift = 64 - __builtin_ctzll(hashCapacity);
+    for (Index j = 0; j < oldCapacity; j++)
+        if (oldNodes[j] != NOCHILD)
+        {
+            Index i = (Index) (((unsigned long long) oldNodes[j]
+                                * 0x9E3779B97F4A7C15ULL) >> shift);
+            while (hashNodes[i] != NOCHILD)
+                i = (i + 1) & (hashCapacity - 1);
+            hashNodes[i] = oldNodes[j];
+            hashSlots[i] = oldSlots[j];
+        }
+    delete []oldNodes;
+    delete []oldSlots;
+}
+
+// allocate:  reserve 'entries' entries at the end of the pools
+template <class Index, class Symbol>
+Index childIndex<Index, Symbol>::allocate(Index entries)
+{
+    if (poolLength + entries > poolCapacity)
+    {
+        Index newCapacity = poolCapacity ? 2 * poolCapacity : 1024;
+        while (newCapacity < poolLength + entries)
+            newCapacity *= 2;
+        Symbol *newLabels = new Symbol[newCapacity];
+        Index *newChildren = new Index[newCapacity];
+        if (!newLabels || !newChildren)
+            {cout << "Memory allocation failure in childIndex\n"; exit(1);}
+        for (Index i = 0; i < poolLength; i++)
+        {
+            newLabels[i] = labelPool[i];
+            newChildren[i] = childPool[i];
+        }
+        delete []labelPool;
+        delete []childPool;
+        labelPool = newLabels;
+        childPool = newChildren;
+        poolCapacity = newCapacity;
+    }
+    Index offset = poolLength;
+    poolLength += entries;
+    return offset;
+}
+
+/****************************
+ * moveToTable:  move the children in 'slot', in a label array or a table,
+ * to a new table of 'capacity' entries at the end of the pools.
+ * **************************/
+template <class Index, class Symbol>
+void childIndex<Index, Symbol>::moveToTable(childSlot<Index> *slot, 
+                                            int capacity)
+{
+    childSlot<Index> old = *slot;
+    slot->offset = allocate(capacity);
+    slot->capacity = capacity;
+    for (int i = 0; i < capacity; i++)
+        childPool[slot->offset + i] = NOCHILD;
+    int entries = isTable(old.capacity) ? old.capacity : old.count;
+    for (int i = 0; i < entries; i++)
+        if (childPool[old.offset + i] != NOCHILD)
+        {
+            Symbol c = isTable(old.capacity) && sizeof(Symbol) == 1
+                           ? (Symbol) i : labelPool[old.offset + i];
+            Index entry = tableEntry(*slot, c);
+            labelPool[entry] = c;
+            childPool[entry] = childPool[old.offset + i];
+        }
+}
+
+/****************************
+ * add:  record that 'child' is the child of 'node' on letter 'c'.  A full
+ * label array is moved to a larger one, or replaced by a table once the
+ * node has TABLE_FANOUT children; an open-addressed table that is half 
+ * full is replaced by one twice as large.
+ * **************************/
+template <class Index, class Symbol>
+void childIndex<Index, Symbol>::add(Index node, Symbol c, Index child)
+{
+    makeWritable();
+    childSlot<Index> *slot = &slotArray[lookup(node)];
+    if (!isTable(slot->capacity) && slot->count == slot->capacity)
+    {
+        int capacity = 2 * slot->capacity;
+        if (isTable(capacity))
+            moveToTable(slot, TABLE_SIZE);
+        else
+        {
+            Index oldOffset = slot->offset;
+            Index offset = allocate(capacity);
+            for (int i = 0; i < slot->count; i++)
+            {
+                labelPool[offset + i] = labelPool[oldOffset + i];
+                childPool[offset + i] = childPool[oldOffset + i];
+            }
+            slot->offset = offset;
+            slot->capacity = capacity;
+        }
+    }
+    else if (sizeof(Symbol) > 1 && isTable(slot->capacity)
+                 && 2 * (slot->count + 1) > slot->capacity)
+        moveToTable(slot, 2 * slot->capacity);
+
+    if (isTable(slot->capacity))
+    {
+        Index entry = tableEntry(*slot, c);
+        labelPool[entry] = c;
+        childPool[entry] = child;
+    }
+    else
+    {
+        labelPool[slot->offset + slot->count] = c;
+        childPool[slot->offset + slot->count] = child;
+    }
+    slot->count++;
+}
+
+/****************************
+ * remove:  forget the child of 'node' on letter 'c'.  In an open-addressed
+ * table, the entries after it are moved back into the gap where they can
+ * be, so that no search stops early at it.
+ * **************************/
+template <class Index, class Symbol>
+void childIndex<Index, Symbol>::remove(Index node, Symbol c)
+{
+    makeWritable();
+    childSlot<Index> &slot = slotArray[lookup(node)];
+    if (isTable(slot.capacity))
+    {
+        Index gap = tableEntry(slot, c);
+        if (childPool[gap] == NOCHILD) return;
+        childPool[gap] = NOCHILD;
+        slot.count--;
+        if (sizeof(Symbol) == 1) return;
+        Index mask = slot.capacity - 1;
+        for (Index i = (gap - slot.offset + 1) & mask; 
+                 childPool[slot.offset + i] != NOCHILD; i = (i + 1) & mask)
+        {
+            // entries from its home up to i are all full, so it can move
+            //  to the gap if the gap is among them
+            Index home = tableHome(slot, labelPool[slot.offset + i]) 
+                         - slot.offset;
+            Index hole = gap - slot.offset;
+            if (((hole - home) & mask) < ((i - home) & mask))
+            {
+                labelPool[gap] = labelPool[slot.offset + i];
+                childPool[gap] = childPool[slot.offset + i];
+                childPool[slot.offset + i] = NOCHILD;
+                gap = slot.offset + i;
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < slot.count; i++)
+        if (labelPool[slot.offset + i] == c)  // move the last one here
+        {
+            slot.count--;
+            labelPool[slot.offset + i] = labelPool[slot.offset + slot.count];
+            childPool[slot.offset + i] = childPool[slot.offset + slot.count];
+            return;
+        }
+}
+
+// memoryUsage:  bytes allocated for the arrays; none if they are mapped
+template <class Index, class Symbol>
+long long childIndex<Index, Symbol>::memoryUsage() const
+{
+    if (!owned) return 0;
+    return (long long) hashCapacity * 2 * sizeof(Index)
+           + (long long) slotCapacity * sizeof(childSlot<Index>)
+           + (long long) poolCapacity * (sizeof(Symbol) + sizeof(Index));
+}
+
+/****************************
+ * Index files:  getSizes and getArrays tell heap::save what to write, and
+ * attach makes the index use arrays that heap::load has mapped from the
+ * file.  makeWritable copies mapped arrays before they are changed.
+ * **************************/
+template <class Index, class Symbol>
+childIndexSizes childIndex<Index, Symbol>::getSizes() const
+{
+    childIndexSizes sizes;
+    sizes.hashCapacity = hashCapacity;
+    sizes.slotCount = slotCount;
+    sizes.poolLength = poolLength;
+    return sizes;
+}
+
+template <class Index, class Symbol>
+void childIndex<Index, Symbol>::getArrays(const Index *&hashNodes, 
+                                  const Index *&hashSlots,
+                                  const childSlot<Index> *&slotArray, 
+                                  const Symbol *&labelPool,
+                                  const Index *&childPool) const
+{
+    hashNodes = this->hashNodes;
+    hashSlots = this->hashSlots;
+    slotArray = this->slotArray;
+    labelPool = this->labelPool;
+    childPool = this->childPool;
+}
+
+template <class Index, class Symbol>
+void childIndex<Index, Symbol>::attach(childIndexSizes sizes, Index *hashNodes, 
+                               Index *hashSlots, childSlot<Index> *slotArray, 
+                               Symbol *labelPool, Index *childPool)
+{
+    freeArrays();
+    owned = false;
+    hashCapacity = sizes.hashCapacity;
+    slotCount = slotCapacity = sizes.slotCount;
+    poolLength = poolCapacity = sizes.poolLength;
+    this->hashNodes = hashNodes;
+    this->hashSlots = hashSlots;
+    this->slotArray = slotArray;
+    this->labelPool = labelPool;
+    this->childPool = childPool;
+}
+
+template <class Index, class Symbol>
+void childIndex<Index, Symbol>::makeWritable()
+{
+    if (owned) return;
+    Index *newNodes = new Index[hashCapacity];
+    Index *newSlots = new Index[hashCapacity];
+    childSlot<Index> *newSlotArray = new childSlot<Index>[slotCapacity];
+    Symbol *newLabels = new Symbol[poolCapacity];
+    Index *newChildren = new Index[poolCapacity];
+    for (Index i = 0; i < hashCapacity; i++)
+    {
+        newNodes[i] = hashNodes[i];
+        newSlots[i] = hashSlots[i];
+    }
+    for (Index i = 0; i < slotCount; i++)
+        newSlotArray[i] = slotArray[i];
+    for (Index i = 0; i < poolLength; i++)
+    {
+        newLabels[i] = labelPool[i];
+        newChildren[i] = childPool[i];
+    }
+    owned = true;
+    hashNodes = newNodes;
+    hashSlots = newSlots;
+    slotArray = newSlotArray;
+    labelPool = newLabels;
+    childPool = newChildren;
+}
+
+template class childIndex<uint32_t, char>;
+template class childIndex<uint64_t, char>;
+template class childIndex<uint32_t, uint16_t>;
+template class childIndex<uint64_t, uint16_t>;
+template class childIndex<uint32_t, uint32_t>;
+template class childIndex<uint64_t, uint32_t>;
@@ -0,0 +1,75 @@
+/*************************
+  childIndex.h:  see childIndex.cpp
+ ************************/
+#ifndef CHILDINDEX_H
+#define CHILDINDEX_H
+
+// Sizes of the arrays of a childIndex, as recorded in an index file
+struct childIndexSizes
+{
+    long long hashCapacity;    // entries in hashNodes and hashSlots
+    long long slotCount;       // entries in slotArray
+    long long poolLength;      // entries in labelPool and childPool
+};
+
+// Where a node's labels and children are kept in the pools
+template <class Index>
+struct childSlot
+{
+    Index offset;        // first entry in labelPool and childPool
+    int count;           // number of children
+    int capacity;        // entries reserved; more than TABLE_FANOUT for a
+                         //   table (see childIndex.cpp)
+};
+
+const int TABLE_SIZE = 256;   // entries in a node's first table; one per
+                              //   letter for a byte alphabet
+const int TABLE_FANOUT = 64;  // children at which a table is used
+const int INDEXED_FANOUT = 8; // children at which a node is indexed here
+
+template <class Index, class Symbol>
+class childIndex
+{
+    public:
+        static const Index NOCHILD = (Index) -1;  // as in positionHeap
+
+        childIndex ();
+        ~childIndex ();
+        Index find (Index node, Symbol c) const;
+        void addNode (Index node);
+        void add (Index node, Symbol c, Index child);
+        void remove (Index node, Symbol c);
+        void clear ();
+        long long memoryUsage () const;
+        childIndexSizes getSizes () const;
+        void getArrays (const Index *&hashNodes, const Index *&hashSlots,
+                        const childSlot<Index> *&slotArray, 
+                        const Symbol *&labelPool, 
+                        const Index *&childPool) const;
+        void attach (childIndexSizes sizes, Index *hashNodes, 
+                     Index *hashSlots, childSlot<Index> *slotArray, 
+                     Symbol *labelPool, Index *childPool);
+        void makeWritable ();
+    private:
+        bool owned;          // false if the arrays are mapped from a file
+        Index hashCapacity;  // power of two, at least twice slotCount
+        Index *hashNodes;    // open-addressed table of indexed nodes ...
+        Index *hashSlots;    //   and the slot of each
+        Index slotCount;
+        Index slotCapacity;
+        childSlot<Index> *slotArray;
+        Index poolLength;
+        Index poolCapacity;
+        Symbol *labelPool;   // edge labels of the children
+        Index *childPool;    // the children, parallel to labelPool
+
+        Index lookup (Index node) const;
+        Index allocate (Index entries);
+        Index tableEntry (const childSlot<Index> &slot, Symbol c) const;
+        Index tableHome (const childSlot<Index> &slot, Symbol c) const;
+        void moveToTable (childSlot<Index> *slot, int capacity);
+        void growHash ();
+        void freeArrays ();
+};
+
+#endif
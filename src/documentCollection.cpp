@@ -0,0 +1,364 @@
+/****************************
+ * documentCollection.cpp:  a position heap of many documents, which
+ * reports the documents that contain a pattern, rather than its positions
+ * **************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include "documentCollection.h"
+#include "heap.h"
+#include "mylist.h"
+using std::cout;
+
+//  The documents are copied into one text, each followed by SEPARATOR,
+//  which no document may contain, and the heap of that text is built.  A
+//  pattern without SEPARATOR then occurs only within documents, and each
+//  position of the text belongs to the document it starts in.
+//
+//  A common pattern may occur millions of times in only a few documents,
+//  so listing the documents must not look at every occurrence.  All but
+//  at most m of the occurrences are the positions of a range of DFS
+//  ranks (see heap::findOccurrenceRanks), and this is the setting of
+//  Muthukrishnan's document listing algorithm [SODA 2002], with the
+//  heap's DFS order in place of a suffix array.  For each rank r,
+//  previousRank[r] records the last rank before r in the same document.
+//  The documents of the range [first, last] are those of the ranks in it
+//  whose previous rank is before 'first':  the rank with the minimum
+//  previousRank in the range is one of them, unless none is, and then
+//  the ranks on either side of it are searched in the same way.  Each
+//  search finds a new document or stops, so with a range-minimum query in
+//  O(1) time, or here O(RMQ_BLOCK), listing takes O(m + d) time for d
+//  documents, however many occurrences there are.
+//
+//  For the top k documents by frequency, the number of occurrences of
+//  each listed document in the range is found by binary search of its
+//  ranks, which are kept in order in documentRanks, in O(d log n) time.
+//
+//  The ranks are 32 bits, so the documents, with their separators, may
+//  have at most MAX_COMPACT_LENGTH characters in all.  The extra arrays
+//  take about 9 bytes per character, besides the heap.
+
+/****************************
+ * documentCollection:  index the 'documentCount' documents, where
+ * documents[i] points to the lengths[i] characters of document i.  The
+ * documents are copied, so the caller need not keep them.
+ * **************************/
+documentCollection::documentCollection(const char **documents,
+                                       const long long *lengths,
+                                       int documentCount)
+{
+    this->documentCount = documentCount;
+    textLength = 0;
+    for (int d = 0; d < documentCount; d++)
+    {
+        if (memchr (documents[d], SEPARATOR, lengths[d]))
+        {
+            cout << "documentCollection:  document " << d
+                 << " contains the separator character\n";
+            exit(1);
+        }
+        textLength += lengths[d] + 1;
+    }
+    if (documentCount < 1 || textLength > MAX_COMPACT_LENGTH)
+    {
+        cout << "documentCollection:  there must be at least one document, "
+                "and at most " << MAX_COMPACT_LENGTH << " characters\n";
+        exit(1);
+    }
+
+    text = new char[textLength];
+    documentStart = new long long[documentCount + 1];
+    if (!text || !documentStart)
+       {cout << "Memory allocation failure in documentCollection\n"; exit(1);}
+    long long start = 0;
+    for (int d = 0; d < documentCount; d++)
+    {
+        documentStart[d] = start;
+        memcpy (text + start, documents[d], lengths[d]);
+        start += lengths[d];
+        text[start++] = SEPARATOR;
+    }
+    documentStart[documentCount] = textLength;
+    H = heap::create (text, textLength);
+
+    // previousRank, and the ranks of each document, by counting sort ...
+    previousRank = new uint32_t[textLength];
+    documentRanks = new uint32_t[textLength];
+    rankStart = new uint32_t[documentCount + 1];
+    uint32_t *lastRank = new uint32_t[documentCount];
+    if (!previousRank || !documentRanks || !rankStart || !lastRank)
+       {cout << "Memory allocation failure in documentCollection\n"; exit(1);}
+    for (int d = 0; d <= documentCount; d++)
+        rankStart[d] = 0;
+    for (int d = 0; d < documentCount; d++)
+        lastRank[d] = 0;
+    for (long long rank = 0; rank < textLength; rank++)
+    {
+        int d = documentAtRank (rank);
+        previousRank[rank] = lastRank[d];
+        lastRank[d] = rank + 1;
+        rankStart[d + 1]++;
+    }
+    for (int d = 0; d < documentCount; d++)
+    {
+        rankStart[d + 1] += rankStart[d];
+        lastRank[d] = rankStart[d];   // next free entry of document d
+    }
+    for (long long rank = 0; rank < textLength; rank++)
+        documentRanks[lastRank[documentAtRank (rank)]++] = rank;
+    delete []lastRank;
+
+    buildRangeMinimum();
+}
+
+documentCollection::~documentCollection()
+{
+    delete H;
+    delete []text;
+    delete []documentStart;
+    delete []previousRank;
+    delete []documentRanks;
+    delete []rankStart;
+    delete []blockMinimum;
+}
+
+/****************************
+ * documentOf:  the document that the occurrence at 'position' of the
+ * text lies in, with 'offset' set to where in the document it starts.
+ * Positions are numbered from the right end of the text, as in a heap.
+ * **************************/
+int documentCollection::documentOf(long long position,
+                                   long long &offset) const
+{
+    long long start = textLength - 1 - position;
+    int d = std::upper_bound (documentStart,
+                              documentStart + documentCount + 1, start)
+            - documentStart - 1;
+    offset = start - documentStart[d];
+    return d;
+}
+
+// documentAtRank:  the document of the position with DFS rank 'rank'
+int documentCollection::documentAtRank(long long rank) const
+{
+    long long offset;
+    return documentOf (H->positionAtRank (rank), offset);
+}
+
+/****************************
+ * Range minimum of previousRank.  The ranks are cut into blocks of
+ * RMQ_BLOCK.  blockMinimum[j * blockCount + b] is the rank of the minimum
+ * in the 2^j blocks starting at block b, so the blocks wholly inside a
+ * range are covered by two runs of them; the parts of blocks at its ends
+ * are scanned.  The table has about n/RMQ_BLOCK * log(n/RMQ_BLOCK)
+ * entries.
+ * **************************/
+void documentCollection::buildRangeMinimum()
+{
+    blockCount = (textLength + RMQ_BLOCK - 1) / RMQ_BLOCK;
+    levels = 1;
+    while ((1LL << levels) <= blockCount)
+        levels++;
+    blockMinimum = new uint32_t[levels * blockCount];
+    if (!blockMinimum)
+       {cout << "Memory allocation failure in buildRangeMinimum\n"; exit(1);}
+    for (long long b = 0; b < blockCount; b++)
+    {
+        long long last = (b + 1) * RMQ_BLOCK - 1;
+        if (last >= textLength) last = textLength - 1;
+        blockMinimum[b] = scanMinimum (b * RMQ_BLOCK, last);
+    }
+    for (int j = 1; j < levels; j++)
+    {
+        uint32_t *level = blockMinimum + j * blockCount;
+        uint32_t *below = level - blockCount;
+        long long half = 1LL << (j - 1);
+        for (long long b = 0; b < blockCount; b++)
+            level[b] = b + half < blockCount
+                           ? lowerRank (below[b], below[b + half])
+                           : below[b];
+    }
+}
+
+// lowerRank:  whichever rank has the smaller previousRank
+long long documentCollection::lowerRank(long long rank1,
+                                        long long rank2) const
+{
+    return previousRank[rank2] < previousRank[rank1] ? rank2 : rank1;
+}
+
+// scanMinimum:  the rank of the minimum in [first, last], by looking
+long long documentCollection::scanMinimum(long long first,
+                                          long long last) const
+{
+    long long minimum = first;
+    for (long long rank = first + 1; rank <= last; rank++)
+        minimum = lowerRank (minimum, rank);
+    return minimum;
+}
+
+// minimumRank:  the rank of the minimum of previousRank in [first, last]
+long long documentCollection::minimumRank(long long first,
+                                          long long last) const
+{
+    long long firstBlock = first / RMQ_BLOCK + 1;  // blocks wholly inside
+    long long lastBlock = last / RMQ_BLOCK - 1;
+    if (firstBlock > lastBlock)
+        return scanMinimum (first, last);
+    long long minimum = lowerRank (scanMinimum (first,
+                                                firstBlock * RMQ_BLOCK - 1),
+                                   scanMinimum ((lastBlock + 1) * RMQ_BLOCK,
+                                                last));
+    int j = 0;
+    while ((2LL << j) <= lastBlock - firstBlock + 1)
+        j++;
+    const uint32_t *level = blockMinimum + j * blockCount;
+    minimum = lowerRank (minimum, level[firstBlock]);
+    return lowerRank (minimum, level[lastBlock - (1LL << j) + 1]);
+}
+
+/****************************
+ * listRange:  add the documents of the ranks in [firstRank, lastRank] to
+ * 'documents', once each (see above).
+ * **************************/
+void documentCollection::listRange(long long firstRank, long long lastRank,
+                                   mylist *documents) const
+{
+    mylist stack;   // ranges still to search, as pairs of ranks
+    stack.add (firstRank);
+    stack.add (lastRank);
+    while (stack.size() > 0)
+    {
+        long long last = stack.removeLast();
+        long long first = stack.removeLast();
+        if (first > last) continue;
+        long long rank = minimumRank (first, last);
+        if (previousRank[rank] > firstRank)  // its document is listed
+            continue;
+        documents->add (documentAtRank (rank));
+        stack.add (first);
+        stack.add (rank - 1);
+        stack.add (rank + 1);
+        stack.add (last);
+    }
+}
+
+// hasSeparator:  a pattern containing SEPARATOR occurs in no document
+bool documentCollection::hasSeparator(const char *pattern,
+                                      int patternLength) const
+{
+    return memchr (pattern, SEPARATOR, patternLength) != NULL;
+}
+
+/****************************
+ * search:  the positions of the pattern, in a list the caller must
+ * delete, as with heap::search; see documentOf for which document each
+ * is in.
+ * **************************/
+mylist *documentCollection::search(const char *pattern,
+                                   int patternLength) const
+{
+    if (hasSeparator (pattern, patternLength))
+        return new mylist();
+    return H->search (pattern, patternLength);
+}
+
+/****************************
+ * listDocuments:  the documents that contain the pattern, in ascending
+ * order, in a list the caller must delete.  Takes O(m + d log d) time
+ * for d documents.
+ * **************************/
+mylist *documentCollection::listDocuments(const char *pattern,
+                                          int patternLength) const
+{
+    mylist *documents = new mylist();
+    if (!documents)
+       {cout << "Memory allocation failure in listDocuments\n"; exit(1);}
+    if (hasSeparator (pattern, patternLength))
+        return documents;
+    mylist others;
+    long long firstRank, lastRank;
+    H->findOccurrenceRanks (pattern, patternLength, &others,
+                            firstRank, lastRank);
+    listRange (firstRank, lastRank, documents);
+    long long offset;
+    for (long long i = 0; i < others.size(); i++)
+        documents->add (documentOf (others.getElement(i), offset));
+
+    long long *array = documents->getArray();
+    std::sort (array, array + documents->size());
+    documents->truncate (std::unique (array, array + documents->size())
+                         - array);
+    return documents;
+}
+
+/****************************
+ * topDocuments:  the (up to) 'k' documents with the most occurrences of
+ * the pattern, most first, in documents[0 .. k-1], with their numbers of
+ * occurrences in frequencies[0 .. k-1].  Returns how many there are;
+ * fewer than 'k' if fewer documents contain the pattern.  Takes
+ * O(m + d log n) time for d documents.
+ * **************************/
+int documentCollection::topDocuments(const char *pattern, int patternLength,
+                                     int k, long long *documents,
+                                     long long *frequencies) const
+{
+    if (k <= 0 || hasSeparator (pattern, patternLength))
+        return 0;
+    mylist others;
+    mylist listed;
+    long long firstRank, lastRank;
+    H->findOccurrenceRanks (pattern, patternLength, &others,
+                            firstRank, lastRank);
+    listRange (firstRank, lastRank, &listed);
+
+    // (frequency, document) pairs; a document with an occurrence among
+    //  the others may appear twice, and is merged below
+    std::vector<std::pair<long long, long long> > counts;
+    for (long long i = 0; i < listed.size(); i++)
+    {
+        long long d = listed.getElement(i);
+        const uint32_t *ranks = documentRanks + rankStart[d];
+        const uint32_t *ranksEnd = documentRanks + rankStart[d + 1];
+        long long frequency = std::upper_bound (ranks, ranksEnd, lastRank)
+                              - std::lower_bound (ranks, ranksEnd, firstRank);
+        counts.push_back (std::make_pair (d, frequency));
+    }
+    long long offset;
+    for (long long i = 0; i < others.size(); i++)
+        counts.push_back (std::make_pair (documentOf (others.getElement(i),
+                                                      offset), 1LL));
+    std::sort (counts.begin(), counts.end());
+    unsigned merged = 0;
+    for (unsigned i = 0; i < counts.size(); i++)
+        if (merged > 0 && counts[merged - 1].first == counts[i].first)
+            counts[merged - 1].second += counts[i].second;
+        else
+            counts[merged++] = counts[i];
+    counts.resize (merged);
+
+    // (-frequency, document), so that the most occurrences come first,
+    //  and the lower document first among equals
+    for (unsigned i = 0; i < counts.size(); i++)
+        counts[i] = std::make_pair (-counts[i].second, counts[i].first);
+    int found = counts.size() < (unsigned) k ? counts.size() : k;
+    std::partial_sort (counts.begin(), counts.begin() + found, counts.end());
+    for (int i = 0; i < found; i++)
+    {
+        documents[i] = counts[i].second;
+        frequencies[i] = -counts[i].first;
+    }
+    return found;
+}
+
+int documentCollection::getDocumentCount() const
+{
+    return documentCount;
+}
+
+long long documentCollection::getTextLength() const
+{
+    return textLength;
+}
@@ -0,0 +1,49 @@
+/*************************
+  documentCollection.h:  see documentCollection.cpp
+ ************************/
+#include <stdint.h>
+
+template <class Symbol> class basicHeap;
+typedef basicHeap<char> heap;
+class mylist;
+const char SEPARATOR = '\0';   // follows each document in the text
+const int RMQ_BLOCK = 32;      // ranks per block of the range-minimum table
+
+class documentCollection
+{
+    public:
+        documentCollection (const char **documents, const long long *lengths,
+                            int documentCount);
+        ~documentCollection ();
+        mylist *search (const char *pattern, int patternLength) const;
+        mylist *listDocuments (const char *pattern, int patternLength) const;
+        int topDocuments (const char *pattern, int patternLength, int k,
+                          long long *documents, long long *frequencies) const;
+        int documentOf (long long position, long long &offset) const;
+        int getDocumentCount () const;
+        long long getTextLength () const;
+    private:
+        char *text;              // the documents, each followed by
+        long long textLength;    //   SEPARATOR
+        int documentCount;
+        long long *documentStart;  // where each document starts in 'text',
+                                   //   counted from the left; the last
+                                   //   entry is textLength
+        const heap *H;           // the heap of 'text'
+        uint32_t *previousRank;  // for each rank, 1 + the last smaller rank
+                                 //   in the same document, or 0 if none
+        uint32_t *documentRanks; // the ranks of each document, in order, ...
+        uint32_t *rankStart;     //   starting at rankStart[document]
+        uint32_t *blockMinimum;  // sparse table of the ranks of the minima
+        long long blockCount;    //   of previousRank over runs of 2^j
+        int levels;              //   blocks, for j < levels
+
+        int documentAtRank (long long rank) const;
+        long long lowerRank (long long rank1, long long rank2) const;
+        long long scanMinimum (long long first, long long last) const;
+        long long minimumRank (long long first, long long last) const;
+        void buildRangeMinimum ();
+        bool hasSeparator (const char *pattern, int patternLength) const;
+        void listRange (long long firstRank, long long lastRank,
+                        mylist *documents) const;
+};
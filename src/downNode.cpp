@@ -4,39 +4,70 @@
  * can be labeled with a discovery and finishing time during a depth-first
  * search, as well as a "maximal reach pointer" to a descendant downNode.
  * See heap.cpp for more details.
+ *
+ * Each downNode also keeps the letter on the edge from its parent, so that
+ * scanning a list of siblings for a letter touches only the siblings'
+ * downNodes and not the text, and a count of its children, so that the
+ * heap can tell when a node has enough of them to be worth indexing (see 
+ * childIndex.cpp).
+ *
+ * Node ids are of type Index, the same type the heap uses for positions,
+ * and letters are of type Symbol, the heap's letter type (see heap.h); 
+ * only the types instantiated at the end of this file can be used.
  * **************************/
 #include <iostream>
+#include <stdint.h>
 #include "downNode.h"
 using std::cout;
 
-downNode::downNode()
+const int MAX_FANOUT = 255;   // the count of children stops here
+
+template <class Index, class Symbol>
+downNode<Index, Symbol>::downNode()
 {
-   child = -1;
-   sibling = -1;
+   clear();
 }
 
-int downNode::getChild ()
+// clear:  make this a node with no children or siblings
+template <class Index, class Symbol>
+void downNode<Index, Symbol>::clear ()
 {
-   return child;
+   child = (Index) -1;     // NOCHILD
+   sibling = (Index) -1;
+   label = 0;
+   fanout = 0;
+   indexed = false;
 }
 
-int downNode::getSibling ()
+template <class Index, class Symbol>
+void downNode<Index, Symbol>::setIndexed (bool i)
 {
-   return sibling;
+   indexed = i;
 }
 
-
-void downNode::setChild (int c)
+template <class Index, class Symbol>
+void downNode<Index, Symbol>::addChildCount ()
 {
-   child = c;
+   if (fanout < MAX_FANOUT) fanout++;
 }
 
-void downNode::setSibling (int s)
+// the count is only approximate once it has reached MAX_FANOUT
+template <class Index, class Symbol>
+void downNode<Index, Symbol>::removeChildCount ()
 {
-   sibling = s;
+   if (fanout > 0 && fanout < MAX_FANOUT) fanout--;
 }
 
-void downNode::print()
+template <class Index, class Symbol>
+void downNode<Index, Symbol>::print()
 {
-   cout << " child: " << getChild() << " sibling: " << getSibling();
+   cout << " child: " << getChild() << " sibling: " << getSibling()
+        << " label: " << getLabel();
 }
+
+template class downNode<uint32_t, char>;
+template class downNode<uint64_t, char>;
+template class downNode<uint32_t, uint16_t>;
+template class downNode<uint64_t, uint16_t>;
+template class downNode<uint32_t, uint32_t>;
+template class downNode<uint64_t, uint32_t>;
@@ -1,18 +1,31 @@
 /******************************
  * downNode.h:  see downNode.cpp
  * ****************************/
+template <class Index, class Symbol>
 class downNode
 {
    private:
-     int child;
-     int sibling;
+     Index child;
+     Index sibling;
+     Symbol label;             // letter on the edge from the parent
+     unsigned char fanout;     // number of children, up to MAX_FANOUT
+     bool indexed;             // children are also kept in a childIndex
 	
    public:
      downNode();
-     void setChild (int c);
-     void setSibling (int s);
-     int getChild ();
-     int getSibling ();
+     // the accessors are defined here so that the loops that walk sibling
+     //  lists, in the build above all, inline them
+     void setChild (Index c) {child = c;}
+     void setSibling (Index s) {sibling = s;}
+     void setLabel (Symbol c) {label = c;}
+     void setIndexed (bool i);
+     void addChildCount ();
+     void removeChildCount ();
+     void clear ();
+     Index getChild () const {return child;}
+     Index getSibling () const {return sibling;}
+     Symbol getLabel () const {return label;}
+     int getFanout () const {return fanout;}
+     bool isIndexed () const {return indexed;}
      void print();
 };
-
@@ -1,22 +1,765 @@
 /****************************
- * driver.cpp:  menu for experimenting with the algorithms in heap.cpp
+ * driver.cpp:  menu for experimenting with the algorithms in heap.cpp,
+ * and a batch mode for answering many patterns from the command line
  * ***************************/
 #include <iostream>
 #include <time.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <vector>
 using namespace std;
 #include "mylist.h"
 #include "heap.h"
 #include "file.h"
 #include "generic.h"
+#include "queryPool.h"
+#include "occurrenceCursor.h"
+#include "queryContext.h"
+#include "shardedHeap.h"
+#include "documentCollection.h"
+#include "packedDna.h"
+#include "succinctHeap.h"
 
-int main ()
+// mapFile:  fileMap, saying how long the file is, or why it cannot be
+//  used and exiting
+static char *mapFile(const char *filename, long &length, bool privateCopy)
 {
+    char *mapped = fileMap (filename, length, privateCopy);
+    if (!mapped && length == 0)
+    {
+        cout << "The file " << filename << " is empty.\n";
+        exit(1);
+    }
+    if (!mapped)
+    {
+        cout << "Attempt to map " << filename << " failed:  " 
+             << strerror (errno) << ".\n";
+        exit(1);
+    }
+    cout << "That file has length: " << length << endl;
+    return mapped;
+}
+
+// showProgress:  the progressCallback the driver builds heaps with
+static void showProgress(const char *phase, long long done, long long total,
+                         void *)
+{
+    cout << "Building (" << phase << "): " << done << " of " << total 
+         << " positions\n";
+}
+
+// printBuildStats:  show what building a heap cost
+static void printBuildStats(const buildStats &stats)
+{
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+        cout << PHASE_NAMES[phase] << ": " << stats.phases[phase].seconds 
+             << " s, " << stats.phases[phase].climbSteps << " climb steps, "
+             << stats.phases[phase].bytesAllocated << " bytes allocated\n";
+    cout << "sibling scans of length 0:  " << stats.scanHistogram[0] << '\n';
+    for (int bucket = 1; bucket < SCAN_BUCKETS; bucket++)
+    {
+        cout << "sibling scans of length " << (1LL << (bucket - 1));
+        if (bucket == SCAN_BUCKETS - 1)
+            cout << '+';
+        else if (bucket > 1)
+            cout << '-' << (1LL << bucket) - 1;
+        cout << ":  " << stats.scanHistogram[bucket] << '\n';
+    }
+    cout << "indexed lookups:  " << stats.indexedLookups << '\n';
+    cout << "maximum depth:  " << stats.maxDepth << '\n';
+    cout << "bytes allocated:  " << stats.bytesAllocated << '\n';
+    cout << "peak bytes:  " << stats.peakBytes << '\n';
+}
+
+// printMemoryUsage:  show the bytes a heap holds, by structure
+static void printMemoryUsage(const heapMemory &usage)
+{
+    cout << "nodes:  " << usage.nodes << " bytes\n";
+    cout << "maxReach:  " << usage.maxReach << " bytes\n";
+    cout << "DFS times:  " << usage.dfsTimes << " bytes\n";
+    cout << "DFS order:  " << usage.dfsOrder << " bytes\n";
+    cout << "range index:  " << usage.rangeIndex << " bytes\n";
+    cout << "child index:  " << usage.children << " bytes\n";
+    cout << "text copy:  " << usage.text << " bytes\n";
+    cout << "total:  " << usage.total << " bytes\n";
+    cout << "mapped index:  " << usage.mapped << " bytes\n";
+}
+
+// printCacheStats:  show what a heap's result cache has done
+static void printCacheStats(const cacheStats &stats)
+{
+    long long lookups = stats.hits + stats.misses;
+    cout << "cache hits:  " << stats.hits << " of " << lookups;
+    if (lookups > 0)
+        cout << " (" << 100.0 * stats.hits / lookups << "%)";
+    cout << "\n";
+    cout << "cache insertions:  " << stats.insertions << ", evictions:  "
+         << stats.evictions << "\n";
+    cout << "cache held:  " << stats.entries << " answers in " 
+         << stats.bytes << " bytes\n";
+}
+
+/****************************
+ * Batch mode.  Given any command-line arguments, the driver builds or 
+ * loads one heap, answers every pattern in a file (or on standard input,
+ * one per line) and exits, instead of showing the menu:
+ *
+ *   driver -t text [-n] [-i index [-z]] [-w index] [-p patterns] [-o output]
+ *          [-c] [-b] [-l] [-v] [-s shards -m length] [-d [-k count]]
+ *          [-y width] [-a] [-r megabytes] [-u] [-g left,right]
+ *          [-x errors | -e errors] [-q] [-h megabytes [-f]] [-j]
+ *
+ *   -t  the text file to index
+ *   -n  remove newlines from the text, as the menu offers to
+ *   -i  load this index file, saved for the same text; if it cannot be
+ *       loaded, or the text has changed since it was saved, the heap is 
+ *       built
+ *   -z  with -i, skip reading the whole text to check that it has not
+ *       changed; only its length and a sample of its letters are checked
+ *   -w  save the heap to this index file
+ *   -p  the pattern file, or - for standard input (the default)
+ *   -o  the output file (standard output by default)
+ *   -c  report only the number of occurrences of each pattern
+ *   -b  write binary output:  for each pattern, a 64-bit count followed,
+ *       unless -c is given, by that many 64-bit positions, all in the
+ *       machine's byte order
+ *   -l  report positions counted from the left end of the text, as
+ *       offsets of the first character of each occurrence, instead of 
+ *       the heap's positions, which are counted from the right end
+ *   -v  show what building the heap cost (see heap::getBuildStats) and
+ *       the memory it holds (see heap::memoryUsage)
+ *   -s  build a shardedHeap of this many shards, on as many threads, 
+ *       instead of one heap; patterns of up to the length given with 
+ *       -m take O(m + k) in each shard, and longer ones are checked 
+ *       letter by letter after their first -m letters.  It cannot be 
+ *       loaded or saved
+ *   -d  treat each line of the text as a document, and report the 
+ *       documents, numbered from 0, that contain each pattern, instead of
+ *       its positions (see documentCollection); -c then reports only the
+ *       number of documents
+ *   -k  with -d, report only this many documents, those with the most 
+ *       occurrences, each followed by its number of occurrences
+ *   -y  the text is a stream of binary tokens of this many bytes, 2 or 4,
+ *       in the machine's byte order, such as a tokenizer's ids, and each
+ *       pattern is a line of token numbers separated by spaces; positions
+ *       are counted in tokens.  It cannot be used with -n, -s or -d.
+ *   -a  the text is DNA:  keep it packed, two bits per base (see 
+ *       packedDna), rather than mapped, while the heap is built and 
+ *       searched.  It cannot be used with -s, -d or -y.
+ *   -r  build the heap in no more than this many megabytes, leaving out
+ *       what it can do without (see heap::create), or fail if it cannot.
+ *       It cannot be used with -s or -d.
+ *   -u  answer the patterns from a succinctHeap copied from the heap, 
+ *       which is freed, as is the text, before the first pattern is read;
+ *       -v then shows the memory the copy holds.  It cannot be used with
+ *       -s, -d or -y.
+ *   -g  report only the occurrences that lie wholly within this window of
+ *       the text, given as the offsets of its first and last characters
+ *       counted from the left, as offsets counted from the left, in 
+ *       ascending order (see heap::search).  It cannot be used with -s, 
+ *       -d, -y or -u.
+ *   -x  report the positions where each pattern occurs with at most this
+ *       many mismatches (see heap::approximateSearch)
+ *   -e  report the positions where a string within this many edits 
+ *       (mismatches, insertions and deletions) of each pattern begins.
+ *       Neither can be used with -s, -d, -y, -u or -g.
+ *   -q  treat each line as a query document, and report its matching 
+ *       statistics (see heap::matchingStatistics):  the number of letters,
+ *       then for each, the length of the longest string that begins there
+ *       and occurs in the text, a colon and one position where it does, 
+ *       or -1 (in binary output, two 64-bit numbers).  It cannot be used
+ *       with -c, -s, -d, -y, -u, -g, -x or -e.
+ *   -h  keep the answers to recent patterns in a cache of this many 
+ *       megabytes (see heap::setCache), for pattern files in which a few
+ *       patterns come up again and again; -v then shows, after the last
+ *       pattern, how often the cache had the answer.  It cannot be used 
+ *       with -s, -d, -y or -u.
+ *   -f  let the cache keep the patterns used most often, rather than
+ *       those used most recently
+ *   -j  read all of the patterns, then search for them together (see 
+ *       heap::searchDictionary), which is faster when many share long 
+ *       prefixes, as in a blocklist; the output is the same.  It cannot
+ *       be used with -s, -d, -y, -u, -g, -x, -e, -q or -h.
+ *
+ * In text output, each pattern gets one line:  the number of occurrences, 
+ * a tab, and the positions separated by spaces, in no particular order.
+ * Output is buffered and written in large blocks, and the searches 
+ * reuse one queryContext, so neither output nor allocation limits the 
+ * rate of lookups.  Messages, such as the progress of the build, go to
+ * the standard error.  With -d, the documents are in ascending order, or
+ * with -k, most occurrences first, each written as the document, a colon
+ * and its number of occurrences (in binary output, two 64-bit numbers).
+ * ***************************/
+const int OUTPUT_BUFFER = 1 << 16;
+static char outputBuffer[OUTPUT_BUFFER];
+static int outputUsed = 0;
+static FILE *outputFile;
+
+// flushOutput:  write out what is in outputBuffer
+static void flushOutput()
+{
+    if (fwrite (outputBuffer, 1, outputUsed, outputFile) 
+            != (size_t) outputUsed)
+       {cerr << "driver:  writing the output failed\n"; exit(1);}
+    outputUsed = 0;
+}
+
+// writeBytes:  add 'length' bytes to the output
+static void writeBytes(const void *bytes, int length)
+{
+    if (outputUsed + length > OUTPUT_BUFFER) flushOutput();
+    memcpy (outputBuffer + outputUsed, bytes, length);
+    outputUsed += length;
+}
+
+// writeNumber:  add a number, in decimal or binary, to the output
+static void writeNumber(long long number, bool binary)
+{
+    if (binary)
+    {
+        writeBytes (&number, sizeof(number));
+        return;
+    }
+    char digits[24];
+    int start = sizeof(digits);
+    do
+    {
+        digits[--start] = '0' + number % 10;
+        number /= 10;
+    } while (number > 0);
+    writeBytes (digits + start, sizeof(digits) - start);
+}
+
+static void batchUsage()
+{
+    cerr << "usage: driver -t text [-n] [-i index [-z]] [-w index]"
+            " [-p patterns]"
+            " [-o output] [-c] [-b] [-l] [-v] [-s shards -m length]"
+            " [-d [-k count]] [-y width] [-a] [-r megabytes] [-u]"
+            " [-g left,right] [-x errors | -e errors] [-q]"
+            " [-h megabytes [-f]] [-j]\n";
+    exit(1);
+}
+
+// writePositions:  the output for the 'hits' positions of one pattern in a
+//  text of 'textLength' letters
+static void writePositions(long long hits, const long long *positions,
+                           long long textLength, bool leftToRight, 
+                           bool binary)
+{
+    writeNumber (hits, binary);
+    for (long long i = 0; i < hits; i++)
+    {
+        if (!binary) writeBytes (i == 0 ? "\t" : " ", 1);
+        writeNumber (leftToRight ? textLength - 1 - positions[i]
+                                 : positions[i], binary);
+    }
+}
+
+// writeStatistics:  the output for one query document with -q
+static void writeStatistics(const heap *H, const char *query, 
+                            long long queryLength, long long textLength,
+                            bool leftToRight, bool binary)
+{
+    long long *lengths = new long long[queryLength + 1];
+    long long *positions = new long long[queryLength + 1];
+    H->matchingStatistics (query, queryLength, lengths, positions);
+    writeNumber (queryLength, binary);
+    for (long long i = 0; i < queryLength; i++)
+    {
+        if (!binary) writeBytes (i == 0 ? "\t" : " ", 1);
+        writeNumber (lengths[i], binary);
+        if (!binary) writeBytes (":", 1);
+        if (positions[i] < 0 && !binary)
+            writeBytes ("-1", 2);
+        else
+            writeNumber (leftToRight && positions[i] >= 0 
+                             ? textLength - 1 - positions[i] : positions[i],
+                         binary);
+    }
+    delete []lengths;
+    delete []positions;
+}
+
+// openBatchFiles:  open the pattern file, which is returned, and the 
+//  output file, which goes in outputFile
+static FILE *openBatchFiles(const char *patternFilename, 
+                            const char *outputFilename, bool binary)
+{
+    FILE *patternFile = stdin;
+    if (strcmp (patternFilename, "-") != 0)
+        patternFile = fopen (patternFilename, "r");
+    outputFile = stdout;
+    if (outputFilename)
+        outputFile = fopen (outputFilename, binary ? "wb" : "w");
+    if (!patternFile || !outputFile)
+    {
+        cerr << "Attempt to open " << (patternFile ? outputFilename 
+                                                   : patternFilename)
+             << " failed.\n";
+        exit(1);
+    }
+    return patternFile;
+}
+
+// closeBatchFiles:  write out the rest of the output, and close the files
+static void closeBatchFiles(FILE *patternFile)
+{
+    flushOutput();
+    if (patternFile != stdin) fclose (patternFile);
+    if (outputFile != stdout && fclose (outputFile) != 0)
+       {cerr << "driver:  writing the output failed\n"; exit(1);}
+}
+
+/****************************
+ * tokenBatch:  batch mode for a text of tokens of type Symbol (see -y), 
+ * which is the 'mappedLength' bytes at 'mappedText'.  The heap is loaded,
+ * built and saved as for a text of bytes, and the patterns are answered
+ * the same way, once each line's numbers are read into tokens.
+ * ***************************/
+template <class Symbol>
+static void tokenBatch(const char *mappedText, long mappedLength, 
+                       const char *loadFilename, bool verifyIndex,
+                       const char *saveFilename, long long memoryBudget, 
+                       bool showStats, FILE *patternFile, bool countOnly, 
+                       bool binary, bool leftToRight)
+{
+    if (mappedLength % sizeof(Symbol) != 0)
+    {
+        cerr << "driver:  the text is not a whole number of " 
+             << sizeof(Symbol) << "-byte tokens\n";
+        exit(1);
+    }
+    const Symbol *text = (const Symbol *) mappedText;
+    long long textLength = mappedLength / sizeof(Symbol);
+    basicHeap<Symbol> *H = NULL;
+    if (loadFilename)
+        H = basicHeap<Symbol>::load (text, textLength, loadFilename, 
+                                     verifyIndex);
+    if (!H)
+        H = basicHeap<Symbol>::create (text, textLength, showProgress, NULL,
+                                       memoryBudget);
+    if (!H) exit(1);
+    if (showStats)
+    {
+        printBuildStats (H->getBuildStats());
+        printMemoryUsage (H->memoryUsage());
+    }
+    if (saveFilename)
+        H->save (saveFilename);
+
+    queryContext context;
+    vector<Symbol> pattern;
+    char *line = NULL;       // the current line, grown by getline
+    size_t lineCapacity = 0;
+    while (getline (&line, &lineCapacity, patternFile) >= 0)
+    {
+        pattern.clear();
+        char *next = line;
+        for (;;)
+        {
+            char *end;
+            unsigned long long token = strtoull (next, &end, 10);
+            if (end == next) break;
+            pattern.push_back ((Symbol) token);
+            next = end;
+        }
+        const Symbol *tokens = pattern.empty() ? NULL : &pattern[0];
+        if (countOnly)
+            writeNumber (H->count (tokens, pattern.size()), binary);
+        else
+        {
+            long long hits = H->search (tokens, pattern.size(), context);
+            writePositions (hits, context.getOccurrences(), textLength, 
+                            leftToRight, binary);
+        }
+        if (!binary) writeBytes ("\n", 1);
+    }
+    free (line);
+    delete H;
+}
+
+// lineDocuments:  a documentCollection with each line of 'text' as a 
+//  document; a newline at the very end does not begin another
+static documentCollection *lineDocuments(const char *text, long length)
+{
+    int documentCount = 0;
+    for (long start = 0; start < length; documentCount++)
+    {
+        const char *newline = (const char *) memchr (text + start, '\n',
+                                                     length - start);
+        start = newline ? newline - text + 1 : length;
+    }
+    if (documentCount == 0) documentCount = 1;   // one empty document
+    const char **documents = new const char *[documentCount];
+    long long *lengths = new long long[documentCount];
+    documents[0] = text;
+    lengths[0] = 0;
+    long start = 0;
+    for (int d = 0; start < length; d++)
+    {
+        const char *newline = (const char *) memchr (text + start, '\n',
+                                                     length - start);
+        long end = newline ? newline - text : length;
+        documents[d] = text + start;
+        lengths[d] = end - start;
+        start = end + 1;
+    }
+    documentCollection *C = new documentCollection (documents, lengths,
+                                                    documentCount);
+    delete []documents;
+    delete []lengths;
+    return C;
+}
+
+// writeDocuments:  the output for one pattern with -d (see above)
+static void writeDocuments(const documentCollection *C, const char *pattern,
+                           int patternLength, int topCount, bool countOnly,
+                           bool binary)
+{
+    if (topCount > 0)
+    {
+        long long *documents = new long long[topCount];
+        long long *frequencies = new long long[topCount];
+        int found = C->topDocuments (pattern, patternLength, topCount,
+                                     documents, frequencies);
+        writeNumber (found, binary);
+        for (int i = 0; i < found && !countOnly; i++)
+        {
+            if (!binary) writeBytes (i == 0 ? "\t" : " ", 1);
+            writeNumber (documents[i], binary);
+            if (!binary) writeBytes (":", 1);
+            writeNumber (frequencies[i], binary);
+        }
+        delete []documents;
+        delete []frequencies;
+        return;
+    }
+    mylist *documents = C->listDocuments (pattern, patternLength);
+    writeNumber (documents->size(), binary);
+    for (long long i = 0; i < documents->size() && !countOnly; i++)
+    {
+        if (!binary) writeBytes (i == 0 ? "\t" : " ", 1);
+        writeNumber (documents->getElement(i), binary);
+    }
+    delete documents;
+}
+
+// dictionaryBatch:  the output for every pattern in 'patternFile' with -j
+static void dictionaryBatch(const heap *H, FILE *patternFile, 
+                            long long textLength, bool countOnly, 
+                            bool leftToRight, bool binary)
+{
+    vector<char> text;           // the patterns, one after another
+    vector<long> starts;
+    vector<int> lengths;
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t lineLength;
+    while ((lineLength = getline (&line, &lineCapacity, patternFile)) >= 0)
+    {
+        if (lineLength > 0 && line[lineLength - 1] == '\n')
+            lineLength--;
+        starts.push_back (text.size());
+        lengths.push_back (lineLength);
+        text.insert (text.end(), line, line + lineLength);
+    }
+    free (line);
+
+    int patternCount = lengths.size();
+    vector<const char *> patterns (patternCount);
+    for (int i = 0; i < patternCount; i++)
+        patterns[i] = text.data() + starts[i];
+    vector<mylist *> results (patternCount);
+    H->searchDictionary (patterns.data(), lengths.data(), patternCount, 
+                         results.data());
+    for (int i = 0; i < patternCount; i++)
+    {
+        if (countOnly)
+            writeNumber (results[i]->size(), binary);
+        else
+            writePositions (results[i]->size(), results[i]->getArray(), 
+                            textLength, leftToRight, binary);
+        if (!binary) writeBytes ("\n", 1);
+        delete results[i];
+    }
+}
+
+static int batchMain(int argc, char **argv)
+{
+    const char *textFilename = NULL;
+    const char *loadFilename = NULL;
+    bool verifyIndex = true;
+    const char *saveFilename = NULL;
+    const char *patternFilename = "-";
+    const char *outputFilename = NULL;
+    bool strip = false, countOnly = false, binary = false;
+    bool leftToRight = false, showStats = false, byDocument = false;
+    bool packed = false, succinct = false;
+    int shardCount = 0, maxPatternLength = 0, topCount = 0, tokenWidth = 1;
+    long long memoryBudget = 0;
+    long long windowLeft = 0, windowRight = -1;   // none unless -g
+    bool windowed = false;
+    int maxErrors = -1;                 // exact search unless -x or -e
+    errorModel model = MISMATCHES;
+    bool statistics = false;
+    long long cacheBytes = 0;
+    cachePolicy policy = RECENCY_EVICTION;
+    bool dictionary = false;
+    int option;
+    while ((option = getopt (argc, argv, 
+                             "t:ni:zw:p:o:cblvs:m:dk:y:ar:ug:x:e:qh:fj")) 
+               != -1)
+    {
+        switch (option)
+        {
+            case 't':  textFilename = optarg; break;
+            case 'n':  strip = true; break;
+            case 'i':  loadFilename = optarg; break;
+            case 'z':  verifyIndex = false; break;
+            case 'w':  saveFilename = optarg; break;
+            case 'p':  patternFilename = optarg; break;
+            case 'o':  outputFilename = optarg; break;
+            case 'c':  countOnly = true; break;
+            case 'b':  binary = true; break;
+            case 'l':  leftToRight = true; break;
+            case 'v':  showStats = true; break;
+            case 's':  shardCount = atoi (optarg); break;
+            case 'm':  maxPatternLength = atoi (optarg); break;
+            case 'd':  byDocument = true; break;
+            case 'k':  topCount = atoi (optarg); break;
+            case 'y':  tokenWidth = atoi (optarg); break;
+            case 'a':  packed = true; break;
+            case 'r':  memoryBudget = atoll (optarg) << 20; break;
+            case 'u':  succinct = true; break;
+            case 'g':  
+                windowed = true;
+                if (sscanf (optarg, "%lld,%lld", &windowLeft, &windowRight)
+                        != 2)
+                    batchUsage();
+                break;
+            case 'x':  maxErrors = atoi (optarg); model = MISMATCHES; break;
+            case 'e':  maxErrors = atoi (optarg); model = EDITS; break;
+            case 'q':  statistics = true; break;
+            case 'h':  cacheBytes = atoll (optarg) << 20; break;
+            case 'f':  policy = FREQUENCY_EVICTION; break;
+            case 'j':  dictionary = true; break;
+            default:   batchUsage();
+        }
+    }
+    if (!textFilename || optind < argc || (!verifyIndex && !loadFilename)) 
+        batchUsage();
+    if ((shardCount > 0) != (maxPatternLength > 0)
+            || (shardCount > 0 && (loadFilename || saveFilename || showStats)))
+        batchUsage();
+    if ((topCount > 0 && !byDocument) || (byDocument && (strip || loadFilename
+            || saveFilename || leftToRight || showStats || shardCount > 0)))
+        batchUsage();
+    if ((tokenWidth != 1 && tokenWidth != 2 && tokenWidth != 4)
+            || (tokenWidth > 1 && (strip || shardCount > 0 || byDocument)))
+        batchUsage();
+    if ((packed || succinct) 
+            && (shardCount > 0 || byDocument || tokenWidth > 1))
+        batchUsage();
+    if (windowed && (windowRight < windowLeft || shardCount > 0 
+                         || byDocument || tokenWidth > 1 || succinct))
+        batchUsage();
+    if (maxErrors >= 0 && (shardCount > 0 || byDocument || tokenWidth > 1
+                               || succinct || windowed))
+        batchUsage();
+    if (statistics && (countOnly || shardCount > 0 || byDocument 
+                           || tokenWidth > 1 || succinct || windowed 
+                           || maxErrors >= 0))
+        batchUsage();
+    if (memoryBudget < 0 
+            || (memoryBudget > 0 && (shardCount > 0 || byDocument)))
+        batchUsage();
+    if (cacheBytes < 0 || (policy == FREQUENCY_EVICTION && cacheBytes == 0)
+            || (cacheBytes > 0 && (shardCount > 0 || byDocument 
+                                       || tokenWidth > 1 || succinct)))
+        batchUsage();
+    if (dictionary && (shardCount > 0 || byDocument || tokenWidth > 1 
+                           || succinct || windowed || maxErrors >= 0 
+                           || statistics || cacheBytes > 0))
+        batchUsage();
+    cout.rdbuf (cerr.rdbuf());   // keep messages out of the output
+
+    if (tokenWidth > 1)
+    {
+        long mappedLength;
+        char *mappedText = mapFile (textFilename, mappedLength, false);
+        FILE *patternFile = openBatchFiles (patternFilename, outputFilename,
+                                            binary);
+        if (tokenWidth == 2)
+            tokenBatch<uint16_t> (mappedText, mappedLength, loadFilename, 
+                                  verifyIndex, saveFilename, memoryBudget, 
+                                  showStats, patternFile, countOnly, binary,
+                                  leftToRight);
+        else
+            tokenBatch<uint32_t> (mappedText, mappedLength, loadFilename, 
+                                  verifyIndex, saveFilename, memoryBudget, 
+                                  showStats, patternFile, countOnly, binary,
+                                  leftToRight);
+        closeBatchFiles (patternFile);
+        fileUnmap (mappedText, mappedLength);
+        return 0;
+    }
+
+    long mappedLength;
+    char *mappedText = mapFile (textFilename, mappedLength, strip);
+    long textLength = mappedLength;
+    if (strip)
+        textLength = stripNewlines (mappedText, mappedLength);
+    packedDna *dna = NULL;
+    if (packed)
+    {
+        dna = new packedDna (mappedText, textLength);
+        fileUnmap (mappedText, mappedLength);
+        mappedText = NULL;
+    }
+    heap *H = NULL;
+    shardedHeap *S = NULL;
+    documentCollection *C = NULL;
+    if (byDocument)
+        C = lineDocuments (mappedText, textLength);
+    else if (shardCount > 0)
+        S = new shardedHeap (mappedText, textLength, shardCount, 
+                             maxPatternLength, shardCount);
+    else if (loadFilename)
+        H = dna ? heap::load (dna, loadFilename, verifyIndex)
+                : heap::load (mappedText, textLength, loadFilename, 
+                              verifyIndex);
+    if (!H && !S && !C)
+    {
+        H = dna ? heap::create (dna, showProgress, NULL, memoryBudget)
+                : heap::create (mappedText, textLength, showProgress, NULL,
+                                memoryBudget);
+        if (!H) exit(1);
+    }
+    if (showStats)
+    {
+        printBuildStats (H->getBuildStats());
+        printMemoryUsage (H->memoryUsage());
+    }
+    if (saveFilename)
+        H->save (saveFilename);
+    if (cacheBytes > 0)
+        H->setCache (cacheBytes, policy);
+    if (windowed)
+        H->buildRangeIndex ();
+    succinctHeap<char> *U = NULL;
+    if (succinct)
+    {
+        U = new succinctHeap<char> (H);
+        delete H;
+        H = NULL;
+        delete dna;
+        dna = NULL;
+        if (mappedText) fileUnmap (mappedText, mappedLength);
+        mappedText = NULL;
+        if (showStats)
+            cout << "succinct heap:  " << U->memoryUsage() << " bytes\n";
+    }
+
+    FILE *patternFile = openBatchFiles (patternFilename, outputFilename, 
+                                        binary);
+    if (dictionary)    // reads every pattern, leaving none for the loop
+        dictionaryBatch (H, patternFile, textLength, countOnly, leftToRight,
+                         binary);
+    queryContext context;
+    char *pattern = NULL;    // the current line, grown by getline
+    size_t patternCapacity = 0;
+    ssize_t lineLength;
+    while ((lineLength = getline (&pattern, &patternCapacity, patternFile)) 
+               >= 0)
+    {
+        if (lineLength > 0 && pattern[lineLength - 1] == '\n')
+            lineLength--;
+        if (C)
+            writeDocuments (C, pattern, lineLength, topCount, countOnly, 
+                            binary);
+        else if (statistics)
+            writeStatistics (H, pattern, lineLength, textLength, 
+                             leftToRight, binary);
+        else if (maxErrors >= 0)
+        {
+            mylist *approximate = H->approximateSearch (pattern, lineLength,
+                                                        maxErrors, model);
+            if (countOnly)
+                writeNumber (approximate->size(), binary);
+            else
+                writePositions (approximate->size(), 
+                                approximate->getArray(), textLength, 
+                                leftToRight, binary);
+            delete approximate;
+        }
+        else if (windowed)
+        {
+            mylist *inWindow = H->search (pattern, lineLength, windowLeft,
+                                          windowRight);
+            if (countOnly)
+                writeNumber (inWindow->size(), binary);
+            else
+                writePositions (inWindow->size(), inWindow->getArray(), 
+                                textLength, false, binary);
+            delete inWindow;
+        }
+        else if (countOnly)
+            writeNumber (S ? S->count (pattern, lineLength)
+                           : U ? U->count (pattern, lineLength)
+                           : H->count (pattern, lineLength), binary);
+        else
+        {
+            long long hits;
+            const long long *positions;
+            mylist *shardHits = NULL;
+            if (S)
+            {
+                shardHits = S->search (pattern, lineLength);
+                hits = shardHits->size();
+                positions = shardHits->getArray();
+            }
+            else
+            {
+                hits = U ? U->search (pattern, lineLength, context)
+                         : H->search (pattern, lineLength, context);
+                positions = context.getOccurrences();
+            }
+            writePositions (hits, positions, textLength, leftToRight, binary);
+            delete shardHits;
+        }
+        if (!binary) writeBytes ("\n", 1);
+    }
+    closeBatchFiles (patternFile);
+    free (pattern);
+    if (cacheBytes > 0 && showStats)
+        printCacheStats (H->getCacheStats());
+    delete H;
+    delete U;
+    delete S;
+    delete C;
+    delete dna;
+    if (mappedText) fileUnmap (mappedText, mappedLength);
+    return 0;
+}
+
+int main (int argc, char **argv)
+{
+   if (argc > 1)
+       return batchMain (argc, argv);
+
    char filename [256];
+   char indexFilename [256];
    char typeInput[256];
    int choice = 1;
 
    heap *H = NULL;
+   char *mappedText = NULL;  // file the heap was built from, if any; the
+   long mappedLength = 0;    //   heap indexes it in place, so it must stay
+                             //   mapped for as long as H is in use
    while (choice != 0) {
       cout<<"\n----------------------------------------------\n";
       cout<<"0. Quit\n";
@@ -24,19 +767,28 @@ int main ()
       cout<<"2. Import a text from a file\n";
       cout<<"3. Find positions of a pattern string, indexed from right to left\n";
       cout<<"4. Print shape of heap in indented preorder\n";
+      cout<<"5. Save the position heap to an index file\n";
+      cout<<"6. Find positions of each line of a file of patterns, in parallel\n";
+      cout<<"7. Add typed text to the left end of the text\n";
+      cout<<"8. Delete characters from the left end of the text\n";
+      cout<<"9. Delete characters from the right end of the text\n";
+      cout<<"10. Count the occurrences of a pattern string\n";
+      cout<<"11. Find the first few positions of a pattern string\n";
+      cout<<"12. Show what building the heap cost\n";
       cout<<"----------------------------------------------\n";
       cout<<"Select : ";
 
       cin >> choice;
       if (choice == 1)
       {
+          if (H) {delete H; H = NULL;}  // H indexes typeInput in place
+          if (mappedText) {fileUnmap (mappedText, mappedLength); mappedText = NULL;}
 	  cout << " Type your text : ";
 	  cin>>typeInput;
           // Unused variable commented out for now.
           // int inputLength = strlen(typeInput);
    	  cout << "\n\nBuilding position heap ...\n\n";
-          if (H) delete H;
-	  H = new heap (typeInput);
+	  H = heap::create (typeInput, strlen(typeInput), showProgress);
           if (!H) {cout << "Memory allocation failure on heap H\n"; exit(1);}
       }
 
@@ -44,12 +796,29 @@ int main ()
       {
 	  cout << "Enter the name of the input file : ";
 	  cin >> filename;
+          char strip;
+          cout << "Remove newlines from the text (y/n) : ";
+          cin >> strip;
+          cout << "Enter the name of a saved index file, or - to build one : ";
+          cin >> indexFilename;
 	  cout << "\n\nReading input file ...\n";
-	  char *text = fileRead (filename);
-   	  cout << "\nBuilding position heap ...\n\n";
-          if (H) delete H;
-	  H = new heap(text);
-          if (!H) {cout << "Memory allocation failure on heap H\n"; exit(1);}
+          if (H) {delete H; H = NULL;}
+          if (mappedText) fileUnmap (mappedText, mappedLength);
+	  mappedText = mapFile (filename, mappedLength, strip == 'y');
+          long textLength = mappedLength;
+          if (strip == 'y')
+              textLength = stripNewlines (mappedText, mappedLength);
+          if (strcmp (indexFilename, "-") != 0)
+          {
+              cout << "\nLoading position heap ...\n\n";
+              H = heap::load (mappedText, textLength, indexFilename, true);
+          }
+          if (!H)
+          {
+   	      cout << "\nBuilding position heap ...\n\n";
+	      H = heap::create(mappedText, textLength, showProgress);
+              if (!H) exit(1);   // an empty file
+          }
       }
       else if (choice == 3)
       {
@@ -66,6 +835,97 @@ int main ()
       {
 	  H->preorderPrint();
       }
+      else if (choice == 5) 
+      {
+          cout << "Enter the name of the index file : ";
+          cin >> indexFilename;
+          H->save (indexFilename);
+      }
+      else if (choice == 6)
+      {
+          cout << "Enter the name of the pattern file : ";
+          cin >> filename;
+          long fileLength;
+          char *patternFile = mapFile (filename, fileLength, false);
+
+          // split the file into lines, which are the patterns ...
+          int patternCount = 0;
+          for (long i = 0; i < fileLength; i++)
+              if (patternFile[i] == '\n' || i == fileLength - 1)
+                  patternCount++;
+          const char **patterns = new const char *[patternCount];
+          int *patternLengths = new int[patternCount];
+          mylist **results = new mylist *[patternCount];
+          long start = 0;
+          for (int p = 0; p < patternCount; p++)
+          {
+              long end = start;
+              while (end < fileLength && patternFile[end] != '\n')
+                  end++;
+              patterns[p] = patternFile + start;
+              patternLengths[p] = end - start;
+              start = end + 1;
+          }
+
+          queryPool pool (H, 0);
+          cout << "\nSearching with " << pool.getThreadCount() 
+               << " threads ...\n";
+          pool.searchBatch (patterns, patternLengths, patternCount, results);
+          for (int p = 0; p < patternCount; p++)
+          {
+              cout.write (patterns[p], patternLengths[p]);
+              cout << ": "; results[p]->print();
+              delete results[p];
+          }
+          delete [] patterns;
+          delete [] patternLengths;
+          delete [] results;
+          fileUnmap (patternFile, fileLength);
+      }
+      else if (choice == 7)
+      {
+          char addition[256];
+	  cout << " Type the text to add : ";
+	  cin >> addition;
+          H->prepend (addition, strlen(addition));
+      }
+      else if (choice == 8 || choice == 9)
+      {
+          int count;
+	  cout << " Number of characters to delete : ";
+	  cin >> count;
+          if (choice == 8)
+              H->deletePrefix (count);
+          else
+              H->deleteSuffix (count);
+      }
+      else if (choice == 10)
+      {
+          char pattern[256];
+	  cout<<"Enter the pattern string : ";
+	  cin>>pattern;
+          cout << "\noccurrences: " << H->count(pattern, strlen(pattern)) 
+               << '\n';
+      }
+      else if (choice == 11)
+      {
+          char pattern[256];
+          int limit;
+	  cout<<"Enter the pattern string : ";
+	  cin>>pattern;
+	  cout<<"Number of positions to show : ";
+	  cin>>limit;
+          occurrenceCursor cursor (H, pattern, strlen(pattern), limit);
+          long long position;
+          cout << "\npositions: ";
+          while (cursor.next(position))
+              cout << position << ' ';
+          cout << '\n';
+      }
+      else if (choice == 12)
+      {
+          printBuildStats (H->getBuildStats());
+      }
    }
    return 0;
 }
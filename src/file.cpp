@@ -5,41 +5,99 @@
 #include <iostream>
 using namespace std;
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-// Reads the contents of a file into a null-terminated character array,
-//   which the function allocates.  The user is responsible for deallocating
-//   the array ...
-char *fileRead(char *filename)
-{
-    ifstream inStream;
+/*****************************
+fileMap:  map the contents of a file into memory and return a pointer to
+its first byte; 'length' is set to the number of bytes in the file.  No
+copy of the file is made:  the pages are read in by the operating system
+as the heap touches them, so the peak memory cost of loading is the text
+itself, and the text can be shared with other processes that map the
+same file.
+
+If 'privateCopy' is false, the mapping is read-only.  If it is true, the
+mapping is copy-on-write, so that a filter such as stripNewlines can
+modify it in place; only the pages it actually writes to get copied, and
+the file itself is never changed.
 
-    // LOOK UP HOW TO QUERY A FILE ABOUT ITS LENGTH ...
-    //  (In the meantime, here's a hack to do it.)
-    inStream.open (filename);
-    if (inStream.fail())
+The array is not null-terminated; use 'length'.  Call fileUnmap with the
+same 'length' when the text is no longer needed.
+
+Nothing is printed.  If the file cannot be opened or mapped, NULL is
+returned, 'length' is -1 and errno tells why; if it is empty, which
+cannot be mapped, NULL is returned and 'length' is 0.  The caller decides
+what to say and whether to go on.
+*****************************/
+char *fileMap(const char *filename, long &length, bool privateCopy)
+{
+    length = -1;
+    int fd = open (filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat status;
+    if (fstat (fd, &status) < 0)
     {
-        cout << "Attempt to open " << filename << " failed.\n";
-        exit(1);
+        close (fd);
+        return NULL;
     }
-    int length;
-    char chr;
-    for (length = 0; !inStream.eof(); length++)
+    if (status.st_size == 0)
     {
-        inStream.get(chr);
-	if (chr == '\n')
-	   length--;
+        close (fd);
+        length = 0;
+        return NULL;
     }
 
-    //length -= 2;
-    cout << "That file has length: " << length << endl;
-    inStream.close();
+    int protection = privateCopy ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *mapped = mmap (NULL, status.st_size, protection, MAP_PRIVATE, fd, 0);
+    close (fd);  // the mapping keeps its own reference to the file
+    if (mapped == MAP_FAILED) return NULL;
+    length = status.st_size;
+
+    // The heap is built from right to left and queried at random, so
+    //   neither access pattern benefits from readahead ...
+    madvise (mapped, length, MADV_RANDOM);
+    return (char *) mapped;
+}
+
+/*****************************
+fileUnmap:  release a text that was mapped with fileMap.  'length' must be
+the length fileMap reported, even if the text was filtered since then.
+*****************************/
+void fileUnmap(char *text, long length)
+{
+    munmap (text, length);
+}
+
+/*****************************
+stripNewlines:  remove the '\n' characters from the first 'length'
+characters of 'text', in place, and return the new length.  This is an
+optional filter; nothing else in the program requires the text to be
+free of newlines.
+*****************************/
+long stripNewlines(char *text, long length)
+{
+    long to = 0;
+    for (long from = 0; from < length; from++)
+        if (text[from] != '\n')
+            text[to++] = text[from];
+    return to;
+}
+
+// Reads the contents of a file into a character array, which the function
+//   allocates, and sets 'length' to its length.  Every byte is kept, 
+//   including newlines and null characters, so the array must be used with
+//   its length, as the heap does; call stripNewlines to remove newlines.
+//   The array is also null-terminated, for convenience.  The user is
+//   responsible for deallocating the array ...  Prefer fileMap, which does
+//   not copy the file.  Returns NULL, as fileMap does, if the file cannot
+//   be read.
+char *fileRead(const char *filename, long &length)
+{
+    char *mapped = fileMap (filename, length, false);
+    if (!mapped) return NULL;
 
-    inStream.open (filename);
-    if (inStream.fail())
-    {
-        cout << "Attempt to open " << filename << " failed.\n";
-        exit(1);
-    }
     char *text = new char [length+1];
     if (!text)
     {
@@ -47,18 +105,10 @@ char *fileRead(char *filename)
         cout << "from input file.\n";
         exit (1);
     }
-    for (int i = 0; i < length; i++)
-    {
-        inStream.get(chr);	
-        if (chr!='\n')
-	{
-	    text[i] = chr;
-	}
-	else 
-	    i--;
-
-    }
-    //text[length] = '\0';
+    for (long i = 0; i < length; i++)
+        text[i] = mapped[i];
+    fileUnmap (mapped, length);
+    text[length] = '\0';
 
     return text;
 }
@@ -1,4 +1,7 @@
 /*****************************
   file.h:  see file.cpp for comments
 *******************************/
-char *fileRead(char *filename);
+char *fileRead(const char *filename, long &length);
+char *fileMap(const char *filename, long &length, bool privateCopy);
+void fileUnmap(char *text, long length);
+long stripNewlines(char *text, long length);
@@ -18,3 +18,18 @@ void reverse (char *string, int stringLength)
     string[stringLength] = '\0';
 }
 
+
+//  Hash the first 'stringLength' characters of 'string' with the 64-bit
+//   FNV-1a hash, starting from 'seed' so that a checksum of several pieces
+//   can be computed by chaining calls.
+unsigned long long checksum (const char *string, long stringLength,
+                             unsigned long long seed)
+{
+    unsigned long long hash = seed;
+    for (long i = 0; i < stringLength; i++)
+    {
+        hash ^= (unsigned char) string[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -6,3 +6,6 @@
 using std::cout;
 void reverse (char *string, int stringLength);
 
+const unsigned long long CHECKSUM_SEED = 14695981039346656037ULL;
+unsigned long long checksum (const char *string, long stringLength,
+                             unsigned long long seed = CHECKSUM_SEED);
@@ -3,12 +3,27 @@
 //   heap.cpp:  The heap class implements the position heap
 /**********************************************/
 #include <iostream>
+#include <fstream>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <math.h>
+#include <algorithm>
 #include "heap.h"
 #include "downNode.h"
 #include "generic.h"
 #include "mylist.h"
+#include "file.h"
+#include "childIndex.h"
+#include "queryContext.h"
+#include "occurrenceCursor.h"
+#include "packedDna.h"
+#include "waveletMatrix.h"
+#include "resultCache.h"
 using std::cout;
 using std::cin;
 using std::endl;
@@ -61,12 +76,23 @@ max-reach pointers, we store the position heap as an upwardly-directed tree
 (one parent pointer for each node) and the dual heap as a downwardly-directed 
 tree (a list of children for each node).  When we are finished, we
 delete the dual, convert the position heap from an upwardly directed tree
-to a downwardly-directed heap.  Then we delete the upwardly directed tree.
-We then create space for DFS discovery- and finishing-time labels,
-and run DFS on the downwardly-directed tree to create these labels.
-At each point in time, the space requirement is at most words per position
-in the text: a left child and right sibling label, a maximal-reach label, 
-and either a parent label or a discovery- and finishing-time label.
+to a downwardly-directed heap.  The conversion overwrites each parent 
+pointer with the depth of its node, and the array of depths then becomes 
+the DFS discovery times, so the upwardly directed tree is not deleted but
+reused.  We then create space for DFS finishing-time labels, and run DFS 
+on the downwardly-directed tree to create both labels.
+The DFS also lists the positions in the order it discovers them, which
+takes one more integer per position of text, so that the positions of a 
+subtree can be reported by copying a contiguous part of the list (see
+setDiscoveryFinishing).
+At each point in time, the space requirement is at most six integers per
+position of text:  the downNode (a left child, a right sibling and a 
+label), a maximal-reach label, and either a parent label or a discovery- 
+and finishing-time label and the DFS order, plus the childIndex.  Given a
+memory budget (see create), the build leaves out the DFS order if it
+would not fit; the heap then reports a subtree by walking it, as it does
+once it has been modified.  getBuildStats reports the peak, and 
+memoryUsage what the finished heap holds.
 
 By contrast, the O(n) construction algorithm with naive find
 operations, which requires only the left child, right sibling, and parent 
@@ -83,74 +109,282 @@ T.
 
 ***************************************************************/
 
+/****************************************
+Index width.  Node ids, positions and DFS times are all stored as Index,
+so the arrays take 4*sizeof(Index) bytes per position, plus the downNode.
+A 32-bit Index halves the space of a 64-bit one, but serves only texts of
+up to MAX_COMPACT_LENGTH characters, since the largest value is NOCHILD.
+The DFS times count the nodes in preorder, so they are below n, and fit 
+in the same width as positions.  'create' and 'load' choose the width, 
+so the rest of the program sees only the abstract class 'heap', and 
+reports positions as long longs whatever the width.  The code is the same
+for both; it is compiled once for each, at the end of this file.
+
+Letter type.  The letters of the text are of type Symbol:  char, for a
+text of bytes, which may be any bytes at all, or uint16_t or uint32_t, for
+a stream of tokens.  Letters are only compared for equality, and the only
+place the width of a letter matters is a node with many children, which
+the childIndex finds in a direct table for bytes and in a hash table for
+wider letters (see childIndex.cpp).  Each letter type is compiled with 
+both index widths; the abstract class for a letter type is basicHeap, and
+'heap' is the one for bytes.
+
+Packed DNA.  A genome may be given as a packedDna (see packedDna.cpp), 
+two bits per base, instead of a string of bytes, so that the text takes a
+quarter of the space while the heap is built and searched.  Only letter()
+and the code that checksums the text when the index is saved or loaded 
+read the text; the search compares patterns with the edge labels kept in
+the nodes, so it is the same for both.
+****************************************/
+
+/****************************************/
+// create:  Build the position heap for the 'length' letters pointed to
+//  by 'str', which need not be null-terminated, and may be a read-only
+//  mapping of a file (see fileMap in file.cpp), with the narrowest index 
+//  that can hold its positions.  If 'progress' is not NULL, it is called 
+//  every PROGRESS_INTERVAL positions of each phase of the build, and at 
+//  the end of each phase, with 'progressData'.  If 'memoryBudget' is not 
+//  0, the build leaves out what it can (see above) to hold no more than
+//  that many bytes at once; only the childIndex, whose size cannot be 
+//  foreseen, may take it over.  It returns NULL, after saying so, if the 
+//  text is empty, which leaves no position for the root, or if the budget
+//  is less than leastBuildMemory.
+/****************************************/
+template <class Symbol>
+basicHeap<Symbol> *basicHeap<Symbol>::create(const Symbol *str, 
+                                             long long length, 
+                                             progressCallback progress, 
+                                             void *progressData,
+                                             long long memoryBudget)
+{
+    return newHeap (str, NULL, length, progress, progressData, 
+                    memoryBudget);
+}
+
+// create:  the same, for the letters of 'dna', which the caller must keep
+//  for as long as the heap is in use
+template <class Symbol>
+basicHeap<Symbol> *basicHeap<Symbol>::create(const packedDna *dna,
+                                             progressCallback progress, 
+                                             void *progressData,
+                                             long long memoryBudget)
+{
+    return newHeap (NULL, dna, dna->getLength(), progress, progressData, 
+                    memoryBudget);
+}
+
+// newHeap:  'create', for the text 'str' or, if that is NULL, 'dna'
+template <class Symbol>
+basicHeap<Symbol> *basicHeap<Symbol>::newHeap(const Symbol *str, 
+                                              const packedDna *dna,
+                                              long long length,
+                                              progressCallback progress, 
+                                              void *progressData,
+                                              long long memoryBudget)
+{
+    if (length < 1)
+    {
+        cout << "heap:  cannot index an empty text\n";
+        return NULL;
+    }
+    bool compact = length <= MAX_COMPACT_LENGTH;
+    long long least = compact 
+                    ? positionHeap<uint32_t, Symbol>::leastBuildMemory (length)
+                    : positionHeap<uint64_t, Symbol>::leastBuildMemory (length);
+    if (memoryBudget > 0 && memoryBudget < least)
+    {
+        cout << "heap:  building this heap takes at least " << least 
+             << " bytes\n";
+        return NULL;
+    }
+    basicHeap<Symbol> *H;
+    if (compact && str)
+        H = new positionHeap<uint32_t, Symbol> (str, length, progress, 
+                                                progressData, memoryBudget);
+    else if (compact)
+        H = new positionHeap<uint32_t, Symbol> (dna, length, progress, 
+                                                progressData, memoryBudget);
+    else if (str)
+        H = new positionHeap<uint64_t, Symbol> (str, length, progress, 
+                                                progressData, memoryBudget);
+    else
+        H = new positionHeap<uint64_t, Symbol> (dna, length, progress, 
+                                                progressData, memoryBudget);
+    if (!H) {cout << "Memory allocation failure in heap::create\n"; exit(1);}
+    return H;
+}
+
+template <class Symbol>
+basicHeap<Symbol>::~basicHeap()
+{
+}
+
+const char *PHASE_NAMES[PHASE_COUNT] = {"construct", "maxReach", "convert",
+                                        "dfs"};
+
+// seconds on a clock that does not jump, for timing the phases of a build
+static double wallClock()
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/****************************************/
+// position heap constructor.  Builds the position heap for the 'length'
+//  characters pointed to by 'str'; see 'create'.
+/****************************************/
+template <class Index, class Symbol>
+positionHeap<Index, Symbol>::positionHeap(const Symbol *str, Index length,
+                                          progressCallback progress, 
+                                          void *progressData,
+                                          long long memoryBudget)
+{
+    initialize (str, NULL, length, progress, progressData, memoryBudget);
+}
+
+template <class Index, class Symbol>
+positionHeap<Index, Symbol>::positionHeap(const packedDna *dna, Index length,
+                                          progressCallback progress, 
+                                          void *progressData,
+                                          long long memoryBudget)
+{
+    initialize (NULL, dna, length, progress, progressData, memoryBudget);
+}
+
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::initialize(const Symbol *str, 
+                                             const packedDna *dna,
+                                             Index length,
+                                             progressCallback progress, 
+                                             void *progressData,
+                                             long long memoryBudget)
+{
+    textLength = length;    // length of text
+    this->progress = progress;
+    this->progressData = progressData;
+    this->memoryBudget = memoryBudget;
+    indexMap = NULL;        // the arrays are built here, not loaded
+    indexMapLength = 0;
+    textBuffer = NULL;      // the text belongs to the caller until it is
+    textBufferLength = 0;   //   modified (see prepend)
+    rangeIndex = NULL;      // built by the first search of a window
+    cache = NULL;
+    
+    // There is no private copy of the text.  The positions are indexed from
+    //  right to left, so position i is the character str[textLength-1-i];
+    //  rather than reversing the text into a new array, we keep a pointer to 
+    //  its rightmost character and index backwards from it.  The caller
+    //  must keep the text in place for as long as the heap is in use.
+    //  A packed text is indexed backwards from dnaEnd in the same way.
+    text = str;
+    textEnd = str ? str + textLength - 1 : NULL;
+    this->dna = dna;
+    dnaEnd = textLength - 1;
+
+    children = new childIndex<Index, Symbol>();
+    allocateArrays();
+    build();                       // build the position heap for the string
+}
+
+// letter:  the character at position 'position'.  The text is indexed 
+//  backwards from textEnd; this is written as a subtraction, since negating
+//  an unsigned Index would not give a negative offset.
+template <class Index, class Symbol>
+inline Symbol positionHeap<Index, Symbol>::letter(Index position) const
+{
+    if (dna) return dna->letter(dnaEnd - (long long) position);
+    return *(textEnd - position);
+}
+
 /****************************************/
-// position heap constructor.  Builds the position heap
-//  for the text pointed to by 'str'
+// allocateArrays:  allocate the arrays that build() fills in, with room
+//  for one node per position of the text
 /****************************************/
-heap::heap(char *str)
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::allocateArrays()
 {
-    textLength = strlen (str);    // length of text
+    nodeCapacity = textLength;
 
     // upwardly-directed rooted tree for holding the (primal) position
     // heap during construction ...
-    parent = new int [textLength]; 
+    parent = new Index [textLength]; 
 
     // downwardly-directed rooted tree for holding the dual heap during
     //   construction, and also the primal heap when it's been constructed
     //   and is ready for use ...
-    downArray = new downNode[textLength];
+    downArray = new downNode<Index, Symbol>[textLength];
 
     // array of maximal-reach pointers; maxReach[i] tells the node
     //   pointed to by node i
-    maxReach = new int[textLength];
+    maxReach = new Index[textLength];
 
-    // Private version of text.  If you want to keep storage cost down to two 
-    //  integers per character of text, you should use the text pointed to 
-    //  by *str, rather than keeping a private copy of the text.  
-    text = new char[textLength];   
-    if (! downArray || !maxReach || !text) 
+    if (! downArray || !maxReach) 
          {cout << "Memory allocation failure in heap constructor\n"; exit(1);}
-    
-    char *p1 = str;  char *p2 = text + textLength - 1;
-    while (*p1 != '\0') // reverse the indexing order to be from
-        *p2-- = *p1++;   //    right to left in private copy of 'text'
-
-    build();                       // build the position heap for the string
 }
 
 // position heap destructor ...
-heap::~heap()
+template <class Index, class Symbol>
+positionHeap<Index, Symbol>::~positionHeap()
+{
+    freeArrays();
+    delete children;
+    delete cache;
+    delete []textBuffer;
+}
+
+// freeArrays:  release the node arrays, wherever they came from
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::freeArrays()
 {
-    delete []downArray; 
-    delete []parent;
-    delete []text;
+    if (indexMap)  // the arrays live in the mapped index file
+        fileUnmap (indexMap, indexMapLength);
+    else
+    {
+        delete []downArray; 
+        delete []parent;
+        delete []maxReach;
+        delete []discoveryTime;
+        delete []finishingTime;
+        delete []dfsOrder;
+    }
+    delete rangeIndex;
+    indexMap = NULL;
+    parent = NULL;
+    dfsOrder = NULL;
+    rangeIndex = NULL;
 }
 
 /*******************************************/
-// build:  Build the position heap.  Assume text has been reversed in its 
-// array so that the indices are in ascending order from right to left.
+// build:  Build the position heap.  Positions are numbered in ascending
+// order from right to left, so position i is letter(i).
 /*******************************************/
-void heap::build ()
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::build ()
 {
-    int pathNode, child;  // current node on path up, potential parent of 
-                          //   new node
-    int prevPathNode;  // child of pathNode on way up
-    for (int arrayIndex = 1; arrayIndex < textLength; arrayIndex++)
+    Index pathNode, child;  // current node on path up, potential parent of 
+                            //   new node
+    Index prevPathNode;  // child of pathNode on way up
+    pathNode = ROOT;     // (set by the first iteration; this quiets -O2)
+    memset (&stats, 0, sizeof(stats));
+    double phaseStart = wallClock();
+    children->clear();  // the dual heap starts out with no children
+    for (Index arrayIndex = 1; arrayIndex < textLength; arrayIndex++)
     {
-        if ((arrayIndex % 100000) == 0) 
-               cout << "Text position: " << arrayIndex << '\n';
-        char *textptr = text + arrayIndex; // Next character on indexing path
+        if (arrayIndex % PROGRESS_INTERVAL == 0) 
+            reportProgress (CONSTRUCT_PHASE, arrayIndex);
+        Symbol next = letter(arrayIndex); // Next character on indexing path
         
-        if (childOnLetter(ROOT, 0, *textptr) == NOCHILD)
+        if (countedChildOnLetter(ROOT, next) == NOCHILD)
         {
             
             parent[arrayIndex] = ROOT;
-            insertChild(arrayIndex, ROOT);
+            insertChild(arrayIndex, ROOT, next);
             pathNode = arrayIndex;
         }
         else
         {
-            char c = text[arrayIndex];
+            Symbol c = next;
 
             // Starting at the most recently added node, climb in the primal 
             // position heap until you find a child on the new letter c in 
@@ -166,51 +400,185 @@ void heap::build ()
             {
                 prevPathNode = pathNode;
                 pathNode = parent[pathNode];
-                child = childOnLetter(pathNode, 0, c);
+                child = countedChildOnLetter(pathNode, c);
+                stats.phases[CONSTRUCT_PHASE].climbSteps++;
             } while (child == NOCHILD);  
            
             // add new node to primal heap
             parent[arrayIndex] = child;
 
-            // add new node to dual heap
-            insertChild(arrayIndex, prevPathNode);
+            // add new node to dual heap; its name there ends in 'c'
+            insertChild(arrayIndex, prevPathNode, c);
 
             // record new node in preparation for next iteration
             pathNode = arrayIndex;
             /*-------------------*/
         }
     }
+    endPhase (CONSTRUCT_PHASE, phaseStart,
+              textLength * (2 * sizeof(Index) + sizeof(downNode<Index, Symbol>))
+              + children->memoryUsage());
+    stats.peakBytes = heldBytes (2);
+
     installMaxReaches();
+    endPhase (MAX_REACH_PHASE, phaseStart, 0);
 
     // Turn heap from an upwardly directed tree in parent array to a downwardly
-    //  directed tree in downArray, discarding the dual heap ...
-    downArray[0].setSibling(NOCHILD);
-    downArray[0].setChild(NOCHILD);
-    for (int arrayIndex = 1; arrayIndex < textLength; arrayIndex++)
+    //  directed tree in downArray, discarding the dual heap.  A parent 
+    //  always precedes its children in the text, so its depth is known, 
+    //  and its parent pointer has already been replaced by its depth.
+    //  The depth of a node gives the label on the edge from its parent.
+    children->clear();
+    downArray[0].clear();
+    Index *depth = parent;
+    depth[0] = 0;
+    for (Index arrayIndex = 1; arrayIndex < textLength; arrayIndex++)
     {
-        downArray[arrayIndex].setSibling(NOCHILD);
-        downArray[arrayIndex].setChild(NOCHILD);
-        insertChild(arrayIndex, parent[arrayIndex]);
+        if (arrayIndex % PROGRESS_INTERVAL == 0) 
+            reportProgress (CONVERT_PHASE, arrayIndex);
+        Index up = parent[arrayIndex];
+        downArray[arrayIndex].clear();
+        depth[arrayIndex] = depth[up] + 1;
+        if ((long long) depth[arrayIndex] > stats.maxDepth) 
+            stats.maxDepth = depth[arrayIndex];
+        insertChild(arrayIndex, up, 
+                    letter(arrayIndex + 1 - depth[arrayIndex]));
     }
-
-    delete [] parent;   // needed only for building and installing max reaches
-
-    // now that the parent array has been deleted, allocate space for
-    //   discovery/finishing times
-    discoveryTime = new int[textLength]; 
-    finishingTime = new int[textLength];
-    if (!discoveryTime || !finishingTime)
+    endPhase (CONVERT_PHASE, phaseStart, children->memoryUsage());
+    if (heldBytes (2) > stats.peakBytes) stats.peakBytes = heldBytes (2);
+
+    // The depths are no longer needed, and their array holds the discovery
+    //  times from here on.  The DFS order is left out if it would break 
+    //  the budget.
+    discoveryTime = parent;
+    parent = NULL;
+    finishingTime = new Index[textLength];
+    if (!finishingTime)
        {cout << "Memory allocation failure in build\n"; exit(1);}
+    long long dfsBytes = textLength * sizeof(Index);
+    dfsOrder = NULL;
+    if (memoryBudget == 0 || heldBytes (3) + dfsBytes <= memoryBudget)
+    {
+        dfsOrder = new Index[textLength];
+        if (!dfsOrder)
+           {cout << "Memory allocation failure in build\n"; exit(1);}
+    }
     setDiscoveryFinishing();
+    endPhase (DFS_PHASE, phaseStart, dfsOrder ? 2 * dfsBytes : dfsBytes);
+    if (heldBytes (dfsOrder ? 4 : 3) > stats.peakBytes) 
+        stats.peakBytes = heldBytes (dfsOrder ? 4 : 3);
+}
+
+// heldBytes:  the bytes of the node arrays, with 'indexArrays' arrays of 
+//  Index besides the downArray, and of the childIndex
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::heldBytes(int indexArrays) const
+{
+    return (long long) nodeCapacity 
+               * (sizeof(downNode<Index, Symbol>) + indexArrays * sizeof(Index))
+           + children->memoryUsage();
+}
+
+// leastBuildMemory:  the fewest bytes a heap of a text of 'length' 
+//  letters can be built in, not counting its childIndex
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::leastBuildMemory(long long length)
+{
+    return length * (sizeof(downNode<Index, Symbol>) + 3 * sizeof(Index));
+}
+
+// countedChildOnLetter:  childOnLetter, counted in the build's statistics,
+//  for the dual heap, where the label of each node x is letter(x).  The
+//  text is compared rather than the label, so the node of the child found
+//  is not read; the text is far smaller than downArray, and more of it is
+//  in the cache.
+template <class Index, class Symbol>
+Index positionHeap<Index, Symbol>::countedChildOnLetter(Index node, Symbol c)
+{
+   if (downArray[node].isIndexed())
+   {
+      stats.indexedLookups++;
+      return children->find(node, c);
+   }
+   long long scanned = 0;
+   Index child = downArray[node].getChild();
+   for ( ; child != NOCHILD && letter(child) != c; scanned++)
+      child = downArray[child].getSibling();
+   int bucket = 0;
+   while (scanned > 0 && bucket < SCAN_BUCKETS - 1)
+   {
+      bucket++;
+      scanned >>= 1;
+   }
+   stats.scanHistogram[bucket]++;
+   return child;
+}
+
+// reportProgress:  tell the caller's callback, if any, how far 'phase' is
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::reportProgress(buildPhase phase, 
+                                                  Index done) const
+{
+    if (progress)
+        progress (PHASE_NAMES[phase], done, textLength, progressData);
+}
+
+// endPhase:  record the time 'phase' took since 'phaseStart', which is 
+//  then set to now for the next phase, and the bytes it allocated
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::endPhase(buildPhase phase, double &phaseStart,
+                                           long long bytesAllocated)
+{
+    reportProgress (phase, textLength);
+    double end = wallClock();
+    stats.phases[phase].seconds = end - phaseStart;
+    stats.phases[phase].bytesAllocated = bytesAllocated;
+    stats.bytesAllocated += bytesAllocated;
+    phaseStart = end;
 }
 
 /**************************************/
-// insertChild:  insert 'child' as a child of 'parent' 
+// insertChild:  insert 'child' as a child of 'parent', on an edge labeled
+//   'label'.  A parent that reaches INDEXED_FANOUT children is entered in 
+//   the childIndex, which keeps track of its children from then on.
 /**************************************/
-void heap::insertChild(int child, int parent)
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::insertChild(Index child, Index parent, 
+                                               Symbol label)
 {
+    downArray[child].setLabel(label);
     downArray[child].setSibling(downArray[parent].getChild());
     downArray[parent].setChild(child);
+    downArray[parent].addChildCount();
+    if (downArray[parent].isIndexed())
+        children->add(parent, label, child);
+    else if (downArray[parent].getFanout() == INDEXED_FANOUT)
+    {
+        children->addNode(parent);
+        for (Index c = child; c != NOCHILD; c = downArray[c].getSibling())
+            children->add(parent, downArray[c].getLabel(), c);
+        downArray[parent].setIndexed(true);
+    }
+}
+
+/**************************************/
+// removeChild:  remove 'child' from the children of 'parent' 
+/**************************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::removeChild(Index child, Index parent)
+{
+    if (downArray[parent].getChild() == child)
+        downArray[parent].setChild(downArray[child].getSibling());
+    else
+    {
+        Index sibling = downArray[parent].getChild();
+        while (downArray[sibling].getSibling() != child)
+            sibling = downArray[sibling].getSibling();
+        downArray[sibling].setSibling(downArray[child].getSibling());
+    }
+    downArray[parent].removeChildCount();
+    if (downArray[parent].isIndexed())
+        children->remove(parent, downArray[child].getLabel());
 }
 
 /**************************************
@@ -220,21 +588,23 @@ heap for the text has been constructed.  For a node corresponding at
 position i, find the maximal prefix of T[i, i-1, ... , 0] that is a path in
 the heap.  Make the node's maximal reach pointer point to that node.
 **************************************/
-void heap::installMaxReaches()
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::installMaxReaches()
 {
-    int pathNode, child;  // current node on path up, potential parent of 
-                          //   new node
-    int prevPathNode;  // child of pathNode on way up
+    Index pathNode, child;  // current node on path up, potential parent of 
+                            //   new node
+    Index prevPathNode;  // child of pathNode on way up
     int depth;    // dummy parameter for indexIntoTrie
+    Symbol first = letter(0);
 
-    pathNode = indexIntoTrie (text, 1, depth);
+    pathNode = indexIntoTrie (&first, 1, depth);
     maxReach[ROOT] = pathNode;
-    for (int arrayIndex = 1; arrayIndex < textLength; arrayIndex++)
+    for (Index arrayIndex = 1; arrayIndex < textLength; arrayIndex++)
     {
-        if ((arrayIndex % 100000) == 0) 
-               cout << "Text position: " << arrayIndex << '\n';
+        if (arrayIndex % PROGRESS_INTERVAL == 0) 
+            reportProgress (MAX_REACH_PHASE, arrayIndex);
         
-       char c = text[arrayIndex];
+       Symbol c = letter(arrayIndex);
 
        // Starting at the most recently added node, climb in the primal 
        // position heap until you find a child on the new letter c in 
@@ -246,12 +616,13 @@ void heap::installMaxReaches()
        // child on letter 'c'.
 
        // climb ...
-       child = childOnLetter(pathNode, 0, c);
+       child = countedChildOnLetter(pathNode, c);
        while (child == NOCHILD)
        {
            prevPathNode = pathNode;
            pathNode = parent[pathNode];
-           child = childOnLetter(pathNode, 0, c);
+           child = countedChildOnLetter(pathNode, c);
+           stats.phases[MAX_REACH_PHASE].climbSteps++;
        }
            
        pathNode = child;
@@ -379,329 +750,2732 @@ that is an occurrence of X_j.
 The total time is therefore O(|X_1X_2...X_j|) which is O(m), yielding
 all O(m) occurrences of the pattern in the case where the pattern falls
 off the tree.
+
+The search does not modify the heap or the caller's pattern, so any number
+of threads may search the same heap at once (see queryPool.cpp).  The
+candidates are pruned in place, in the list that is returned.
 **************************************/
 
-mylist *heap::search(char *pattern, int patternLength)
+template <class Index, class Symbol>
+mylist *positionHeap<Index, Symbol>::search(const Symbol *pattern, 
+                                            int patternLength) const
 {
-    //  observe convention of making indices descend from left to right
-    reverse (pattern, patternLength); 
-
-    int pathEndDepth; // end of indexing path for X_1
-    // Get the positions of X_1 if it does not fall off the tree; otherwise
-    //  get its candidate positions ...
-    mylist *candidates = genCandidates (pattern, patternLength, pathEndDepth);
-    bool fellOffTree = (pathEndDepth < patternLength);
-    
-    // If X_1 fell off the tree, we are done ...
-    if (!fellOffTree) 
-        candidates->compact();
-    else 
-    {
-        // Cycle through X_2, X_3, ... X_j, pruning candidates as
-        //  described above ...
-        int offset = pathEndDepth;    
-        while (offset < patternLength && candidates->size() > 0)
-            candidates = pruneCandidates(pattern, patternLength-offset, 
-                                          candidates, offset);
-    }
-   
-    // un-reverse the user's pattern string to leave it in its original state
-    reverse (pattern, patternLength); 
-    return candidates;
+    mylist *Occurrences = new mylist();
+    if (! Occurrences) {cout << "Memory allocation failure in search\n"; exit(1);}
+    findOccurrences (pattern, patternLength, Occurrences);
+    return Occurrences;
 }
 
 /**************************************
-genCandidates:  (See heap::search for terminology.)  Return the set of 
-positions of the pattern string if it doesn't fall off the tree; find 
-the maximal prefix X1 and its candidate positions otherwise.  Indexing 
-on X_1 leads to a node, 'pathEndNode'.  Set 'pathEndDepth' to record the 
-depth of 'pathEndNode', since this is |X_1|, which the caller needs to know.
-
-If the pattern does not fall off the tree, then the set of positions of the 
-pattern are the descendants of 'pathEndNode' and the ancestors whose 
-maximal-reach pointers point to a (not necessarily proper) descendant 
-of 'pathEndNode'.  As we have seen in the naive search algorithm,
-every occurrence of the pattern is either an ancestor or a descendant
-of 'pathEndNode', so that finishes the search.
-
-Otherwise, X_1 is maximal in the pattern string.  The candidates of X_1 are
-those ancestors of 'pathEndNode' that are occurrences of X_1.
-
-The procedure allocates the 'mylist' structure for returning the list
-of positions; this must be deleted by the caller to avoid a memory leak.  
-It also sets the parameter 'pathEndDepth' to be the depth of 'pathEndNode', 
-since this is also |X_1|, and the caller needs to know |X_1|.  
+search:  the same search, with the positions left in 'context' instead of 
+a list that is allocated for them.  Returns the number of positions; see
+queryContext.cpp for how to get them.  The context's list keeps its space
+from one search to the next, so once it is as large as the largest result,
+a search allocates no memory at all.
 **************************************/
-mylist *heap::genCandidates(char *pattern, int patternLength, int &pathEndDepth)
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::search(const Symbol *pattern, 
+                                              int patternLength, 
+                                              queryContext &context) const
 {
-
-   // index as far as possible on 'pattern' ...
-   int pathEndNode = indexIntoTrie(pattern, patternLength, pathEndDepth);
-
-   // Find all *proper* ancestors of pathEndNode that are occurrences of X_1
-   mylist *candidates = pathOccurrences(pattern, patternLength, pathEndNode);
-
-   // If didn't fall off tree during indexing, append all *not necessarily
-   //  proper* descendants of pathEndNode
-   if (pathEndDepth == patternLength) 
-       appendSubtreeOccurrences(pathEndNode, candidates);
-
-   // pathEndNode is a non-proper descendant of itself that is an occurrence of
-   //  X_1, so it must be reported as a candidate, along with those reported 
-   //  by pathOccurrences
-   else candidates->add(pathEndNode);  
-                                      
-   return candidates;
+    context.occurrences->clear();
+    findOccurrences (pattern, patternLength, context.occurrences);
+    return context.occurrences->size();
 }
 
-/**************************************
-pruneCandidates:  (See heap::search comments for terminology.)  The pattern
-string is X_1X_2...X_j.  The 'suffix' parameter is the string 
-X_iX_{i+1}...X_j for some i > 1.  The 'candidates' parameter is all 
-positions of X_1X_2...X_{i-1} in the text, minus a set of positions that 
-are known not to be be followed by X_iX_{i+1}...X_j.  Since the pattern 
-is X_1X_2...X_j, 'candidates' contains all positions where the pattern 
-occurs, and possibly some where it does not.  The 'offset' parameter is 
-|X_1X_2...X_{i-1}|.  Find X_i by indexing as far as possible into the trie 
-on 'suffix'.  For each h in candidates, if i < j, throw h out of 'candidates' 
-if h-'offset' is not a candidate for X_i, and if i=j, throw h out if 
-h-'offset' is not an occurrence of X_j.  In either of these cases, h cannot 
-be the position of an occurrence of the pattern.  
-
-Therefore, if i < j, the final pruned candidate list is all occurrences 
-X_1X_2...X_i, minus a set of positions that are known not to be followed by
-by X_{i+1}X_{i+2}...X_j.  This differs from the candidate list at the beginning
-of the call, where the candidate list was all occurrences of X_1X_2...X_{i-1}
-that are known not to be followed by X_iX_{i+1}...X_j.  Therefore, the pruned 
-candidate list contains all occurrences of the pattern, and possibly some 
-others.   If i = j, the pruned candidate list is all occurrences of the 
-pattern, X_1X_2...X_j.  
+// One of the searches searchBatch keeps going at once:  how far down the
+//  indexing path of the current X_i it has got, and the node to look at 
+//  next, a child of the deepest node found that may be the one on the 
+//  next letter
+template <class Index>
+struct pathWalk
+{
+    int pattern;          // which pattern of the batch
+    int offset;           // |X_1X_2...X_{i-1}|
+    int candidateCount;   // candidates left, or -1 while finding X_1
+    Index pathNode;       // deepest node found on the indexing path of 
+    int depth;            //   X_i, and its depth
+    Index next;           // child of pathNode to try, or none
+};
 
-The procedure changes the 'offset' from |X_1X_2...X_{i-1}| to |X_1X_2...X_i| 
-in preparation for the next iteration of 'pruneCandidates', where i will be
-one step closer to j.
+/**************************************
+searchBatch:  search for each of the 'patternCount' patterns, setting 
+results[i] to the list 'search' would return for patterns[i], whose 
+length is patternLengths[i].  As with 'search', the caller must delete 
+the lists.
+
+Once the heap is larger than the processor's caches, each step down an 
+indexing path is a cache miss on downArray that the next step must wait 
+for, so one search at a time leaves the memory system nearly idle.  This
+takes INTERLEAVED_SEARCHES patterns down their indexing paths at once, 
+one step of each in turn:  a step looks at the node the walk's last step
+asked the processor to prefetch, and asks for the next one, so the misses
+of the different walks overlap.  When a walk reaches the end of the 
+indexing path for X_1, its candidates are found as 'search' finds them, 
+and it goes on down the path for X_2, and so on; when it has pruned its 
+candidates for the last time, the next pattern takes its place.  With a
+cache (see setCache) the patterns are simply searched one at a time.
 **************************************/
-
-mylist *heap::pruneCandidates(char *suffix, int suffixLength, 
-                              mylist *candidates, int &offset)
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::searchBatch(const Symbol **patterns, 
+                                              const int *patternLengths,
+                                              int patternCount, 
+                                              mylist **results) const
 {
-    int pathEndDepth;  // depth of end node of indexing path
-
-    // index as far as possible into the heap on 'suffix' to find which
-    // of its prefixes is X_i.  Set 'pathEndDepth=|X_i|
-    int pathEndNode = indexIntoTrie(suffix, suffixLength, pathEndDepth);
-
-    //  fellOffTree is true if we have found that i != j ...
-    bool fellOffTree = (pathEndDepth < suffixLength);
-
-    // Prepare a list to hold the positions where PX occurs
-    mylist *newCandidates = new mylist();
+    for (int i = 0; i < patternCount; i++)
+    {
+        results[i] = new mylist();
+        if (! results[i]) 
+           {cout << "Memory allocation failure in searchBatch\n"; exit(1);}
+    }
+    if (cache)
+    {
+        for (int i = 0; i < patternCount; i++)
+            findOccurrences (patterns[i], patternLengths[i], results[i]);
+        return;
+    }
 
-    // If X_i-'pathEndDepth' is the empty string, i != j, the first letter 
-    //  of 'suffix' does not occur in the text, so neither does the pattern.  We
-    //  only need to return a nonempty set of candidates if this doesn't happen
-    if (pathEndDepth > 0)
+    pathWalk<Index> walks[INTERLEAVED_SEARCHES];
+    int walkCount = 0;     // walks under way are walks[0 .. walkCount-1]
+    int nextPattern = 0;
+    while (walkCount > 0 || nextPattern < patternCount)
     {
-        // for each h in 'candidates', keep h if it passes the test ...
-        for (int index = 0; index < candidates->size(); index++)
+        // Start a walk for each pattern there is room for ...
+        while (walkCount < INTERLEAVED_SEARCHES && nextPattern < patternCount)
         {
-            int h = candidates->getElement(index);
-            int offsetNode = h - offset;
-  
-            // if we haven't run off the righthand end of the text ...
-            if (offsetNode >= 0)  
-            {
-                if   (
-                      // h-'offset' is an ancestor of X_i that is an occurrence
-                      //   of X_i
-                      (isDescendant (pathEndNode, offsetNode) 
-                         &&(isDescendant(maxReach[offsetNode], pathEndNode)))
-
-                      //OR i=j and h-'offset' is a descendant of X_j, hence
-                      //  an occurrence of it that isn't an ancestor ...
-                      || (!fellOffTree 
-                         && isDescendant (offsetNode, pathEndNode)))
+            pathWalk<Index> &walk = walks[walkCount++];
+            walk.pattern = nextPattern++;
+            walk.offset = 0;
+            walk.candidateCount = -1;
+            walk.pathNode = ROOT;
+            walk.depth = 0;
+            walk.next = patternLengths[walk.pattern] == 0 ? NOCHILD
+                        : childToTry (ROOT, patterns[walk.pattern][0]);
+        }
 
-                   // THEN keep h ...
-                   newCandidates->add(candidates->getElement(index));
+        // ... and take one step of each
+        for (int w = 0; w < walkCount; )
+        {
+            pathWalk<Index> &walk = walks[w];
+            const Symbol *pattern = patterns[walk.pattern];
+            int patternLength = patternLengths[walk.pattern];
+            if (walk.next != NOCHILD)
+            {
+                const downNode<Index, Symbol> &node = downArray[walk.next];
+                int at = walk.offset + walk.depth;
+                if (node.getLabel() != pattern[at])
+                    walk.next = node.getSibling();
+                else
+                {
+                    walk.pathNode = walk.next;
+                    walk.depth++;
+                    __builtin_prefetch (maxReach + walk.pathNode);
+                    walk.next = at + 1 == patternLength ? NOCHILD
+                                : childToTry (walk.pathNode, pattern[at + 1]);
+                }
+            }
+            if (walk.next == NOCHILD && !finishPath (walk, pattern, 
+                                                     patternLength, 
+                                                     results[walk.pattern]))
+            {
+                walks[w] = walks[--walkCount];
+                continue;
             }
+            if (walk.next != NOCHILD)
+                __builtin_prefetch (downArray + walk.next);
+            w++;
         }
-        // update 'offset' from |X_1X_2...X_{i-1}| to |X_1X_2...X_i| ...
-        offset += pathEndDepth;  
     }
-    delete candidates;
-    return newCandidates;
 }
 
-/**************************************
-indexIntoTrie:  Find the maximal prefix Q of 'pattern' that is the sequence
-of edge labels on a path from the root in the position heap.  The returned
-value is the last node on the indexing path, and the parameter 'endDepth'
-tells the depth of this node, which is also the length of Q.
-
-Recall that the indices of 'pattern' decrease from right to left, so
-it is implemented with a pointer its *rightmost* character.
-**************************************/
-int heap::indexIntoTrie(char *pattern, int patternLength, 
-                        int &endDepth)
+// finishPath:  for searchBatch, use the indexing path 'walk' has found for
+//  X_i to find or prune the candidates in 'Occurrences', and start it down
+//  the path for X_{i+1}; return false if the search is over instead
+template <class Index, class Symbol>
+bool positionHeap<Index, Symbol>::finishPath(pathWalk<Index> &walk, 
+                                             const Symbol *pattern, 
+                                             int patternLength,
+                                             mylist *Occurrences) const
 {
-    int pathNode;      // current node on the indexing path
-    int child = ROOT;  // child of 'pathNode', except at beginning, when
-                       //  it is the root and 'pathNode' is undefined
-    int depth = 0;     // current depth
-    if (patternLength == 0) return ROOT;
+    if (walk.candidateCount < 0)
+    {
+        genCandidates (pattern, patternLength, walk.pathNode, walk.depth,
+                       Occurrences);
+        if (walk.depth == patternLength) return false;
+        walk.offset = walk.depth;
+        walk.candidateCount = Occurrences->size();
+    }
     else
+        walk.candidateCount = keepCandidates (pattern + walk.offset, 
+                                              patternLength - walk.offset,
+                                              walk.pathNode, walk.depth,
+                                              Occurrences->getArray(),
+                                              walk.candidateCount, 
+                                              walk.offset);
+    if (walk.offset >= patternLength || walk.candidateCount == 0)
     {
+        Occurrences->truncate(walk.candidateCount);
+        return false;
+    }
+    walk.pathNode = ROOT;
+    walk.depth = 0;
+    walk.next = childToTry (ROOT, pattern[walk.offset]);
+    return true;
+}
 
-        //  Get a pointer to the leftmost position of 'pattern' 
-        char *patPtr = pattern + patternLength - 1;
-        do
-        {
-            pathNode = child;
-            // get child of pathNode reachable on next letter of 'pattern'
-            child = childOnLetter(pathNode, depth++, *patPtr--);
-        } while (child != NOCHILD && depth < patternLength);
+// Orders the numbers of patterns by the patterns, so that patterns with a 
+//  common prefix come together, in the order of a depth-first walk of the
+//  trie of the patterns
+template <class Symbol>
+struct patternOrder
+{
+    const Symbol **patterns;
+    const int *patternLengths;
+    bool operator()(int a, int b) const
+    {
+        return std::lexicographical_compare (patterns[a], 
+                                             patterns[a] + patternLengths[a],
+                                             patterns[b], 
+                                             patterns[b] + patternLengths[b]);
+    }
+};
 
-        // If we fell off the tree when trying to find 'child', 'pathNode' 
-        //   is the last node of the indexing path
-        if (child == NOCHILD) 
+/**************************************
+searchDictionary:  search for each of the 'patternCount' patterns, setting
+results[i] to the list 'search' would return for patterns[i], whose length
+is patternLengths[i].  As with 'search', the caller must delete the lists.
+
+This is for large sets of patterns, many of which share long prefixes, 
+such as a blocklist.  The patterns are sorted, which takes them in the 
+order of a depth-first walk of their trie, and each is searched as 
+'search' does it, as a series of walks down the heap for X_1, X_2, ...,
+keeping, for each walk, the nodes of its path and the candidates left
+after it.  The next pattern starts from what it shares with the one before
+it rather than from the root:  if the two agree through the letter that 
+X_i fell off the tree on, X_1 ... X_i are the same for both, and so are
+the candidates left after pruning on X_i, so both are kept, and the walk
+for X_{i+1} goes on from the node of the letters the two still share.  So
+a prefix common to many patterns is looked up and pruned on once.  The
+ancestors on a path whose maximal-reach pointers reach the end of it 
+(see pathOccurrences) are found from the nodes kept, without looking up
+the path again.  The cache (see setCache) is not used.
+**************************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::searchDictionary(const Symbol **patterns,
+                                                   const int *patternLengths,
+                                                   int patternCount,
+                                                   mylist **results) const
+{
+    int *order = new int[patternCount];
+    int maxLength = 0;
+    for (int i = 0; i < patternCount; i++)
+    {
+        order[i] = i;
+        if (patternLengths[i] > maxLength) maxLength = patternLengths[i];
+        results[i] = new mylist();
+        if (! results[i]) 
         {
-           endDepth = depth - 1;
-           return pathNode;
+            cout << "Memory allocation failure in searchDictionary\n";
+            exit(1);
         }
-        else // we reached the end of 'pattern, so 'child' is the end of path
+    }
+    patternOrder<Symbol> byPattern = {patterns, patternLengths};
+    std::sort (order, order + patternCount, byPattern);
+
+    // The walks of the last pattern searched:  walk k began at 
+    //  walkStart[k] and went walkDepth[k] letters down the heap, to the
+    //  nodes path[walkStart[k] + 1 .. walkStart[k] + walkDepth[k]], from 
+    //  the root.  walkCandidates[k] holds the candidates left after it, 
+    //  unless it was the last walk, and NULL then.
+    Index *path = new Index[maxLength + 1];
+    int *walkStart = new int[maxLength + 1];
+    int *walkDepth = new int[maxLength + 1];
+    mylist **walkCandidates = new mylist *[maxLength + 1];
+    if (!order || !path || !walkStart || !walkDepth || !walkCandidates)
+       {cout << "Memory allocation failure in searchDictionary\n"; exit(1);}
+    int walkCount = 0;
+    const Symbol *previous = NULL;  // the last pattern searched, and its 
+    int previousLength = 0;         //   length
+
+    for (int i = 0; i < patternCount; i++)
+    {
+        const Symbol *pattern = patterns[order[i]];
+        int patternLength = patternLengths[order[i]];
+        mylist *Occurrences = results[order[i]];
+        int common = 0;
+        while (common < patternLength && common < previousLength 
+                   && pattern[common] == previous[common])
+            common++;
+        previous = pattern;
+        previousLength = patternLength;
+
+        // Keep the walks that fell off the tree on a letter the two share
+        //  (what a walk that got no letter at all leaves depends on 
+        //  whether another letter follows), and the candidates after 
+        //  them ...
+        int walk = 0;
+        bool none = false;    // no candidates are left
+        while (!none && walk < walkCount && walkCandidates[walk]
+                   && walkStart[walk] + walkDepth[walk] < common
+                   && (walkDepth[walk] > 0 || walkStart[walk] + 1 < common))
+            none = walkCandidates[walk++]->size() == 0;
+        if (none) continue;
+        int sharedDepth = 0;  // letters of the next walk the two share
+        if (walk < walkCount)
         {
-           endDepth = depth;
-           return child;
+            sharedDepth = common - walkStart[walk];
+            if (sharedDepth > walkDepth[walk]) sharedDepth = walkDepth[walk];
+        }
+        for (int k = walk; k < walkCount; k++)
+        {
+            delete walkCandidates[k];
+            walkCandidates[k] = NULL;
+        }
+        walkCount = walk;
+
+        // ... and do the rest of the walks
+        int offset = walk == 0 ? 0 : walkStart[walk - 1] + walkDepth[walk - 1];
+        for (;;)
+        {
+            Index node = sharedDepth == 0 ? ROOT : path[offset + sharedDepth];
+            int depth = sharedDepth;
+            while (offset + depth < patternLength)
+            {
+                Index child = childOnLetter (node, pattern[offset + depth]);
+                if (child == NOCHILD) break;
+                node = path[offset + ++depth] = child;
+            }
+            walkStart[walkCount] = offset;
+            walkDepth[walkCount] = depth;
+            walkCandidates[walkCount] = NULL;
+            walkCount++;
+            sharedDepth = 0;
+            bool last = offset + depth == patternLength;
+
+            if (walkCount == 1)   // X_1, as genCandidates finds it
+            {
+                if (last)
+                {
+                    pathOccurrences (path, depth, Occurrences);
+                    appendSubtreeOccurrences (node, Occurrences);
+                    break;
+                }
+                mylist *candidates = walkCandidates[0] = new mylist();
+                pathOccurrences (path, depth, candidates);
+                candidates->add(node);
+                offset = depth;
+                continue;
+            }
+
+            // prune the candidates left after the walk before on X_i
+            mylist *before = walkCandidates[walkCount - 2];
+            mylist *kept = last ? Occurrences : new mylist();
+            int candidateCount = before->size();
+            memcpy (kept->extend (candidateCount), before->getArray(),
+                    candidateCount * sizeof(long long));
+            candidateCount = keepCandidates (pattern + offset, 
+                                             patternLength - offset, node,
+                                             depth, kept->getArray(), 
+                                             candidateCount, offset);
+            kept->truncate(candidateCount);
+            if (!last) walkCandidates[walkCount - 1] = kept;
+            if (last || candidateCount == 0 || offset >= patternLength)
+            {
+                if (!last)
+                    memcpy (Occurrences->extend (candidateCount), 
+                            kept->getArray(), 
+                            candidateCount * sizeof(long long));
+                break;
+            }
         }
     }
+
+    for (int k = 0; k < walkCount; k++)
+        delete walkCandidates[k];
+    delete []walkCandidates;
+    delete []walkDepth;
+    delete []walkStart;
+    delete []path;
+    delete []order;
 }
-/****************************
-// childOnLetter:  Find the child reachable from 'node' on character c; 
-//  'nodeDepth' is the depth of 'node'
-******************************/
-int heap::childOnLetter(int node, int nodeDepth, char c)
+
+// childToTry:  the first child of 'node' that may be the one on letter 
+//  'c', as childOnLetter would look at it:  the one the childIndex gives, 
+//  if the node's children are indexed, or else the first on its list
+template <class Index, class Symbol>
+inline Index positionHeap<Index, Symbol>::childToTry(Index node, 
+                                                     Symbol c) const
 {
-   int child = downArray[node].getChild();
-   while (child != NOCHILD && text[child - nodeDepth] != c)
-      child = downArray[child].getSibling();
-   return child;
+    if (downArray[node].isIndexed())
+        return children->find(node, c);
+    return downArray[node].getChild();
 }
 
-/**************************************
-pathOccurrences:  Report all proper ancestors of pathEndNode whose maximal
-reach pointers point to (not necessarily proper) descendants of 'pathEndNode'.
-
-The method allocates the list of positions; this must be deleted
-when it is no longer needed.
-**************************************/
-mylist *heap::pathOccurrences(char *pattern, int patternLength, int pathEndNode)
+// findOccurrences:  add the positions of the pattern to 'Occurrences', 
+//  which must be empty
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::findOccurrences(const Symbol *pattern, 
+                                                  int patternLength, 
+                                                  mylist *Occurrences) const
 {
-    int pathNode, child;  // parent and child on indexing path
-    int depth;            // depth of pathNode
-    mylist *Occurrences = new mylist(); 
-    if (! Occurrences) {cout << "Memory allocation failure in pathOccurrences\n"; exit(1);}
-    
-    child = depth = 0;
-    // start at "left" end of pattern (right-to-left indexing)
-    char *patPtr = pattern + patternLength - 1;
-                                           
-    do
+    if (cache)   // the answer in the form the cache keeps; see setCache
     {
-        pathNode = child;
-        if (isDescendant (maxReach[pathNode], pathEndNode))
-            Occurrences->add(pathNode);
-        child = childOnLetter(pathNode, depth++, *patPtr--);
-    } while (child != pathEndNode);
-    return Occurrences;
+        int keyBytes = patternLength * sizeof(Symbol);
+        long long subtreeNode, others;
+        if (!cache->lookup(pattern, keyBytes, subtreeNode, others, 
+                           Occurrences))
+        {
+            Index node = compactOccurrences (pattern, patternLength, 
+                                             Occurrences);
+            subtreeNode = node == NOCHILD ? -1 : (long long) node;
+            cache->insert(pattern, keyBytes, subtreeNode, 
+                          Occurrences->getArray(), Occurrences->size());
+        }
+        if (subtreeNode >= 0)
+            appendSubtreeOccurrences (subtreeNode, Occurrences);
+        return;
+    }
+
+    int pathEndDepth; // end of indexing path for X_1
+    Index pathEndNode = indexIntoTrie (pattern, patternLength, pathEndDepth);
+    findOccurrences (pattern, patternLength, pathEndNode, pathEndDepth, 
+                     Occurrences);
+}
+
+// findOccurrences:  the same, once the indexing path for X_1 has been 
+//  found to end at 'pathEndNode', at depth 'pathEndDepth'
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::findOccurrences(const Symbol *pattern, 
+                                                  int patternLength, 
+                                                  Index pathEndNode,
+                                                  int pathEndDepth,
+                                                  mylist *Occurrences) const
+{
+    // Get the positions of X_1 if it does not fall off the tree; otherwise
+    //  get its candidate positions ...
+    genCandidates (pattern, patternLength, pathEndNode, pathEndDepth, 
+                   Occurrences);
+    bool fellOffTree = (pathEndDepth < patternLength);
+    
+    // If X_1 did not fall off the tree, we are done ...
+    if (fellOffTree) 
+    {
+        // Cycle through X_2, X_3, ... X_j, pruning candidates as
+        //  described above ...
+        int offset = pathEndDepth;    
+        int candidateCount = Occurrences->size();
+        while (offset < patternLength && candidateCount > 0)
+            candidateCount = pruneCandidates(pattern + offset, 
+                                             patternLength - offset, 
+                                             Occurrences->getArray(), 
+                                             candidateCount, offset);
+        Occurrences->truncate(candidateCount);
+    }
+}
+
+/**************************************
+count:  the number of occurrences of the pattern in the text, found the 
+same way as by 'search', but without listing them.
+
+If the pattern does not fall off the tree, the occurrences are the 
+descendants of the end of the indexing path, which are counted from its DFS
+labels, and the ancestors that 'search' would report, which are counted as
+they are found.  Otherwise the occurrences are the candidates for X_1 that
+survive pruning, and there are at most |X_1| of those; they are pruned in
+place, in a small array on the stack for any pattern of reasonable length.
+Either way this takes O(m) time however many occurrences there are, 
+provided the heap is laid out (see layOutSubtrees); after the heap has been
+modified, the descendants are counted by walking the subtree.
+**************************************/
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::count(const Symbol *pattern, 
+                                             int patternLength) const
+{
+    if (cache)
+    {
+        int keyBytes = patternLength * sizeof(Symbol);
+        long long subtreeNode, others;
+        if (!cache->lookup(pattern, keyBytes, subtreeNode, others, NULL))
+        {
+            mylist compact;
+            Index node = compactOccurrences (pattern, patternLength, 
+                                             &compact);
+            subtreeNode = node == NOCHILD ? -1 : (long long) node;
+            others = compact.size();
+            cache->insert(pattern, keyBytes, subtreeNode, compact.getArray(),
+                          others);
+        }
+        return others + (subtreeNode >= 0 ? subtreeCount (subtreeNode) : 0);
+    }
+
+    int pathEndDepth;
+    Index pathEndNode = indexIntoTrie (pattern, patternLength, pathEndDepth);
+    if (pathEndDepth == patternLength)
+        return countPathOccurrences (pattern, pathEndNode) 
+               + subtreeCount (pathEndNode);
+
+    long long stackCandidates[CANDIDATE_BUFFER];
+    long long *candidates = stackCandidates;
+    if (pathEndDepth + 1 > CANDIDATE_BUFFER)
+        candidates = new long long[pathEndDepth + 1];
+    int candidateCount = survivingCandidates (pattern, patternLength, 
+                                              pathEndNode, pathEndDepth,
+                                              candidates);
+    if (candidates != stackCandidates) delete []candidates;
+    return candidateCount;
+}
+
+// survivingCandidates:  the occurrences of a pattern that falls off the 
+//  tree after 'pathEndDepth' letters, at 'pathEndNode', found without a
+//  list:  they are left in 'candidates', which has room for 
+//  pathEndDepth+1, and their number is returned
+template <class Index, class Symbol>
+int positionHeap<Index, Symbol>::survivingCandidates(
+                                       const Symbol *pattern, 
+                                       int patternLength, Index pathEndNode,
+                                       int pathEndDepth, 
+                                       long long *candidates) const
+{
+    int candidateCount = 0;
+
+    // the candidates for X_1, as genCandidates finds them ...
+    Index child = ROOT;
+    for (int depth = 0; child != pathEndNode; depth++)
+    {
+        if (isDescendant (maxReach[child], pathEndNode))
+            candidates[candidateCount++] = child;
+        child = childOnLetter(child, pattern[depth]);
+    }
+    candidates[candidateCount++] = pathEndNode;
+
+    // ... pruned as pruneCandidates prunes them
+    int offset = pathEndDepth;
+    while (offset < patternLength && candidateCount > 0)
+        candidateCount = pruneCandidates (pattern + offset, 
+                                          patternLength - offset,
+                                          candidates, candidateCount, offset);
+    return candidateCount;
+}
+
+// locate:  one position where the pattern occurs, or -1 if it does not.
+//  If the pattern does not fall off the tree, the end of the indexing path
+//  is one.
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::locate(const Symbol *pattern,
+                                              int patternLength) const
+{
+    int pathEndDepth;
+    Index pathEndNode = indexIntoTrie (pattern, patternLength, pathEndDepth);
+    if (pathEndDepth == patternLength)
+        return pathEndNode;
+
+    long long stackCandidates[CANDIDATE_BUFFER];
+    long long *candidates = stackCandidates;
+    if (pathEndDepth + 1 > CANDIDATE_BUFFER)
+        candidates = new long long[pathEndDepth + 1];
+    int candidateCount = survivingCandidates (pattern, patternLength, 
+                                              pathEndNode, pathEndDepth,
+                                              candidates);
+    long long position = candidateCount > 0 ? candidates[0] : -1;
+    if (candidates != stackCandidates) delete []candidates;
+    return position;
+}
+
+// The walk of a match, for matchingStatistics:  the match is broken into
+//  X_1X_2... as search breaks a pattern, and the last X_i may still be
+//  going on.  Once X_1 has ended, the candidates are the positions the
+//  match may have, checked against each X_i that has ended.
+template <class Index>
+struct matchWalk
+{
+    long long start;      // the first letter of the match
+    long long walkStart;  // the first letter of the current X_i, ...
+    Index walkNode;       //   the node its letters so far lead to, ...
+    int walkDepth;        //   and their number
+    bool firstWalk;       // whether the current X_i is X_1
+    mylist candidates;
+
+    // restart:  begin an empty match at query[start]
+    void restart(long long start)
+    {
+        this->start = walkStart = start;
+        walkNode = ROOT;
+        walkDepth = 0;
+        firstWalk = true;
+        candidates.clear();
+    }
+};
+
+/**************************************
+matchingStatistics:  for each offset i of the query, the length of the 
+longest string that begins there and occurs in the text, in lengths[i], 
+and a position where it occurs, in positions[i] (-1 if the length is 0).
+
+If the query's letters from i up to j occur at position p, those from i+1
+up to j occur at p-1, so the length at i+1 is at least the length at i,
+less one.  The letters are taken one at a time, extending the current
+match where it is by reading the text, which takes O(1) time.  Alongside,
+the match is broken into X_1X_2... as search breaks a pattern (see 
+heap::search), a letter at a time, in a matchWalk:  a letter takes the 
+current X_i one step down the tree, or, where it falls off, X_i ends and 
+the letter starts X_{i+1}.  When X_1 ends, the candidates for the match 
+are found as genCandidates finds them, and as each later X_i ends, they
+are pruned by it as pruneCandidates prunes them.  Where the occurrence 
+being followed does not match the next letter, another is taken from the
+candidates, one that passes the test for the X_i that is still going on;
+those that fail it are dropped for good.
+
+If no candidate passes, the match at i ends at j, and so do those at the
+offsets after i up to the first, i', from which the letters up to and 
+including j occur.  Those occurrences only grow more likely as i' moves 
+right, so i' is found by searching (see locate) from i+1, i+2, i+4, ...
+until one is found, then by binary search, and the match and its walk are
+rebuilt from i'.
+
+Time.  Each letter costs O(1) to read the text and to take a step of the
+walk.  Each candidate costs O(1) to find, O(1) to test each time the 
+occurrence followed gives out until it is dropped, and O(1) each time an
+X_i ends while it is left.  There are at most |X_1|+1 <= h+1 of them, for
+a heap of height h, so while the match at i goes on, a stretch of L 
+letters that the walk breaks into k strings costs O(L + hk) time, however
+often the occurrence followed gives out; it is no longer O(L) for each 
+such letter, as searching afresh would be.  A match that ends costs 
+O(L log d) more to search for i', where d = i' - i, and O(L + hk) to 
+rebuild.
+**************************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::matchingStatistics(const Symbol *query,
+                                                     long long queryLength,
+                                                     long long *lengths,
+                                                     long long *positions)
+                                                     const
+{
+    long long i = 0, j = 0;   // query[i .. j-1] occurs at 'position'
+    long long position = -1;
+    matchWalk<Index> walk;    // ... and is broken into X_1X_2... here
+    walk.restart(0);
+    while (i < queryLength)
+    {
+        // extend the match at i as far as it goes ...
+        while (j < queryLength)
+        {
+            extendMatch (walk, query, j);
+            long long next = position - (j - i);   // text after the match
+            if (next < 0 || letter (next) != query[j])
+            {
+                long long elsewhere = nextOccurrence (walk, query);
+                if (elsewhere < 0) break;
+                position = elsewhere;
+            }
+            j++;
+        }
+        if (j == queryLength)
+        {
+            for (long long k = i; k < queryLength; k++)
+            {
+                lengths[k] = queryLength - k;
+                positions[k] = position - (k - i);
+            }
+            return;
+        }
+
+        // ... and find the first offset after i from which it can be 
+        //  extended by query[j]; it is j+1 if query[j] does not occur
+        long long low = i + 1, high = j + 1, found = -1;
+        for (long long step = 1; i + step <= j; step *= 2)
+        {
+            long long at = locate (query + i + step, j + 1 - (i + step));
+            if (at >= 0)
+            {
+                high = i + step;
+                found = at;
+                break;
+            }
+            low = i + step + 1;
+        }
+        while (low < high)
+        {
+            long long middle = (low + high) / 2;
+            long long at = locate (query + middle, j + 1 - middle);
+            if (at >= 0)
+            {
+                high = middle;
+                found = at;
+            }
+            else
+                low = middle + 1;
+        }
+        for (long long k = i; k < low; k++)
+        {
+            lengths[k] = j - k;
+            positions[k] = j > k ? position - (k - i) : -1;
+        }
+        i = low;
+        walk.restart(low);
+        for (long long k = low; k <= j; k++)
+            extendMatch (walk, query, k);
+        j++;
+        position = found;   // of query[low .. j-1], unless low == j
+    }
+}
+
+// extendMatch:  add query[j] to the walk of the match query[start .. j-1]
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::extendMatch(matchWalk<Index> &walk,
+                                              const Symbol *query,
+                                              long long j) const
+{
+    Index child = childOnLetter (walk.walkNode, query[j]);
+    if (child != NOCHILD)
+    {
+        walk.walkNode = child;
+        walk.walkDepth++;
+        return;
+    }
+    if (walk.walkDepth > 0)   // X_i falls off here; X_{i+1} starts
+    {
+        endWalk (walk, query);
+        walk.walkStart = j;
+        walk.walkNode = ROOT;
+        walk.walkDepth = 0;
+        child = childOnLetter (ROOT, query[j]);
+        if (child != NOCHILD)
+        {
+            walk.walkNode = child;
+            walk.walkDepth = 1;
+            return;
+        }
+    }
+    // a letter that labels no edge can occur only at position 0 (see 
+    //  keepCandidates); it is an X_i of its own, which ends at once
+    endWalk (walk, query);
+    walk.walkStart = j + 1;
+}
+
+// endWalk:  X_i, the walk's walkDepth letters from walkStart, has fallen
+//  off the tree, or, if there are none, the letter at walkStart labels no
+//  edge:  find the candidates if it is X_1, and prune them if not
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::endWalk(matchWalk<Index> &walk,
+                                          const Symbol *query) const
+{
+    if (walk.firstWalk)
+    {
+        walk.firstWalk = false;
+        if (walk.walkDepth > 0)
+        {
+            pathOccurrences (query + walk.start, walk.walkNode, 
+                             &walk.candidates);
+            walk.candidates.add(walk.walkNode);
+        }
+        else if (query[walk.walkStart] == letter(0))
+            walk.candidates.add(0);
+        return;
+    }
+    int offset = walk.walkStart - walk.start;
+    walk.candidates.truncate(keepCandidates (query + walk.walkStart, 
+                                             walk.walkDepth + 1,
+                                             walk.walkNode, walk.walkDepth,
+                                             walk.candidates.getArray(),
+                                             walk.candidates.size(), 
+                                             offset));
+}
+
+// nextOccurrence:  a position of the match whose walk is 'walk', or -1
+//  if it has none; candidates that are not are dropped on the way
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::nextOccurrence(matchWalk<Index> &walk,
+                                                      const Symbol *query)
+                                                      const
+{
+    if (walk.firstWalk)   // the match is the name of walkNode
+        return walk.walkNode;
+    while (walk.candidates.size() > 0)
+    {
+        long long h = walk.candidates.getElement(walk.candidates.size() - 1);
+        int offset = walk.walkStart - walk.start;
+        if (walk.walkDepth == 0   // every X_i has ended, and h passed them
+                || keepCandidates (query + walk.walkStart, walk.walkDepth,
+                                   walk.walkNode, walk.walkDepth, &h, 1, 
+                                   offset) > 0)
+            return h;
+        walk.candidates.removeLast();
+    }
+    return -1;
+}
+
+/**************************************
+contains:  whether the pattern occurs in the text at all.  If the pattern 
+does not fall off the tree, the end of the indexing path is an occurrence,
+so this takes O(m) time and allocates nothing beyond what 'count' does.
+**************************************/
+template <class Index, class Symbol>
+bool positionHeap<Index, Symbol>::contains(const Symbol *pattern, 
+                                           int patternLength) const
+{
+    int pathEndDepth;
+    indexIntoTrie (pattern, patternLength, pathEndDepth);
+    if (pathEndDepth == patternLength)
+        return true;
+    return count (pattern, patternLength) > 0;
+}
+
+/**************************************
+search:  the occurrences of the pattern that lie wholly within the window
+from 'left' through 'right' of the text, as offsets of their first
+characters counted from the left end, in ascending order, in a new list
+that the caller must delete.
+
+The occurrences in the subtree of the end of the indexing path are a range
+of dfsOrder (see findOccurrenceRanks), and those in the window are the
+positions in that range within a range of values, which rangeIndex lists
+in descending order, which is ascending order of offsets, in O(log n) time
+each.  The at most m others are sorted and merged in.  Only the occurrences
+in the window are listed, so this takes O(m log m + (k + 1) log n) time for
+k of them, however many there are outside it.  This needs rangeIndex (see
+buildRangeIndex); without it, every occurrence is listed and those in the
+window are kept, in time proportional to the number in the whole text.
+**************************************/
+template <class Index, class Symbol>
+mylist *positionHeap<Index, Symbol>::search(const Symbol *pattern,
+                                            int patternLength,
+                                            long long left, 
+                                            long long right) const
+{
+    mylist *Occurrences = new mylist();
+    if (left < 0) left = 0;
+    if (right >= (long long) textLength) right = textLength - 1;
+
+    // an occurrence at offset s, which is position textLength-1-s, is in
+    //  the window if left <= s and s+m-1 <= right (the empty pattern
+    //  occurs at every offset)
+    long long lastStart = right - (patternLength > 0 ? patternLength : 1) + 1;
+    if (lastStart < left) return Occurrences;
+    long long low = textLength - 1 - lastStart;
+    long long high = textLength - 1 - left;
+
+    mylist others;
+    long long firstRank, lastRank;
+    findOccurrenceRanks (pattern, patternLength, &others, firstRank,
+                         lastRank);
+    if (lastRank >= firstRank && rangeIndex)
+        rangeIndex->report(firstRank, lastRank, low, high, Occurrences);
+    else
+        for (long long rank = firstRank; rank <= lastRank; rank++)
+            others.add(dfsOrder[rank]);
+
+    // the others in the window, in ascending order of position ...
+    long long *other = others.getArray();
+    long long kept = 0;
+    for (long long i = 0; i < others.size(); i++)
+        if (low <= other[i] && other[i] <= high)
+            other[kept++] = other[i];
+    std::sort (other, other + kept);
+
+    // ... merged from the back, smallest position last, then turned into
+    //  offsets
+    long long inSubtree = Occurrences->size();
+    Occurrences->extend(kept);
+    long long *merged = Occurrences->getArray();
+    long long i = inSubtree - 1, out = inSubtree + kept - 1;
+    for (long long j = 0; j < kept; )
+        merged[out--] = (i >= 0 && merged[i] < other[j]) ? merged[i--]
+                                                         : other[j++];
+    for (long long k = 0; k < inSubtree + kept; k++)
+        merged[k] = textLength - 1 - merged[k];
+    return Occurrences;
+}
+
+/**************************************
+approximateSearch:  the positions where the pattern occurs with at most
+'maxErrors' errors, in a new list that the caller must delete, each once
+and in no particular order.  With MISMATCHES, an occurrence is m letters
+that differ from the pattern in at most k places.  With EDITS, a position
+is an occurrence if some string that begins there is within edit distance
+k of the pattern.
+
+The label of the node at each position is a prefix of the text that
+begins there, so a depth-first search from the root that follows only the
+edges whose labels keep within the budget of errors meets every position
+that can be an occurrence:
+
+  - Once the labels on the path match the whole pattern, every position in
+    the subtree below is an occurrence, and they are listed as search lists
+    the subtree of the end of the indexing path.
+  - A node above that is only a candidate, since the text at its position
+    goes on past its label, and the rest of the match is checked against
+    the text.  With MISMATCHES, a candidate with no errors left must match
+    the rest of the pattern exactly, and such candidates are checked
+    together, a depth at a time, by pruneCandidates, as search checks the
+    candidates for the pieces of a pattern.
+  - A branch is cut as soon as its errors exceed the budget, and with no
+    errors left only the child on the pattern's next letter is followed,
+    so for small k the search visits only the few paths within k errors of
+    a prefix of the pattern, not the whole text.
+
+With EDITS, each node of the path has a column of the table of edit
+distances between the pattern's prefixes and the node's label, kept only
+for the 2k+1 prefixes whose distance can be at most k; see editSearch.  The
+search keeps its own stack, as setDiscoveryFinishing does.
+**************************************/
+template <class Index, class Symbol>
+mylist *positionHeap<Index, Symbol>::approximateSearch(const Symbol *pattern,
+                                                       int patternLength,
+                                                       int maxErrors,
+                                                       errorModel model) const
+{
+    mylist *Occurrences = new mylist();
+    if (maxErrors < 0) return Occurrences;
+    if (model == MISMATCHES)
+        mismatchSearch (pattern, patternLength, maxErrors, Occurrences);
+    else
+        editSearch (pattern, patternLength, maxErrors, Occurrences);
+    return Occurrences;
+}
+
+// mismatchSearch:  add the positions within 'maxErrors' mismatches of the
+//  pattern to 'Occurrences'
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::mismatchSearch(const Symbol *pattern,
+                                                 int patternLength,
+                                                 int maxErrors,
+                                                 mylist *Occurrences) const
+{
+    // candidates with no errors left, by the depth they were met at
+    mylist **exhausted = new mylist *[patternLength + 1];
+    for (int depth = 0; depth <= patternLength; depth++)
+        exhausted[depth] = NULL;
+
+    mylist stack;   // node, depth and errors of each node still to visit
+    stack.add(ROOT);
+    stack.add(0);
+    stack.add(0);
+    while (stack.size() > 0)
+    {
+        int errors = stack.removeLast();
+        int depth = stack.removeLast();
+        Index node = stack.removeLast();
+        if (depth == patternLength)
+        {
+            appendSubtreeOccurrences (node, Occurrences);
+            continue;
+        }
+        if (errors == maxErrors)
+        {
+            if (!exhausted[depth]) exhausted[depth] = new mylist();
+            exhausted[depth]->add(node);
+            Index child = childOnLetter (node, pattern[depth]);
+            if (child != NOCHILD)
+            {
+                stack.add(child);
+                stack.add(depth + 1);
+                stack.add(errors);
+            }
+            continue;
+        }
+        if (mismatchesWithin (pattern, patternLength, node, depth,
+                              maxErrors - errors))
+            Occurrences->add(node);
+        for (Index child = downArray[node].getChild(); child != NOCHILD;
+                 child = downArray[child].getSibling())
+        {
+            stack.add(child);
+            stack.add(depth + 1);
+            stack.add(errors + (downArray[child].getLabel()
+                                    != pattern[depth]));
+        }
+    }
+
+    for (int depth = 0; depth < patternLength; depth++)
+    {
+        if (!exhausted[depth]) continue;
+        int offset = depth;
+        int candidateCount = exhausted[depth]->size();
+        while (offset < patternLength && candidateCount > 0)
+            candidateCount = pruneCandidates (pattern + offset,
+                                              patternLength - offset,
+                                              exhausted[depth]->getArray(),
+                                              candidateCount, offset);
+        long long *added = Occurrences->extend (candidateCount);
+        for (int i = 0; i < candidateCount; i++)
+            added[i] = exhausted[depth]->getElement(i);
+        delete exhausted[depth];
+    }
+    delete []exhausted;
+}
+
+// mismatchesWithin:  whether the text at 'position', whose first 'depth'
+//  letters have been matched, matches the rest of the pattern with at most
+//  'errorsLeft' mismatches
+template <class Index, class Symbol>
+bool positionHeap<Index, Symbol>::mismatchesWithin(const Symbol *pattern,
+                                                   int patternLength,
+                                                   Index position, int depth,
+                                                   int errorsLeft) const
+{
+    if ((long long) position < patternLength - 1)
+        return false;             // the text ends first
+    for (int i = depth; i < patternLength; i++)
+        if (letter (position - i) != pattern[i] && --errorsLeft < 0)
+            return false;
+    return true;
+}
+
+// nextEditColumn:  the column of edit distances after the letter 'c', in
+//  'next', from 'column', the column after 'depth' letters.  Entry t of
+//  the column after d letters is the distance to the first t+d-k letters
+//  of the pattern, or k+1 if that is more, or if there is no such prefix.
+//  Returns the least entry.
+template <class Symbol>
+static int nextEditColumn(const Symbol *pattern, int patternLength,
+                          int maxErrors, const int *column, int depth,
+                          Symbol c, int *next)
+{
+    int width = 2 * maxErrors + 1, least = maxErrors + 1;
+    for (int t = 0; t < width; t++)
+    {
+        int prefix = t + depth + 1 - maxErrors;
+        int distance = maxErrors + 1;
+        if (prefix == 0)
+            distance = depth + 1;
+        else if (prefix > 0 && prefix <= patternLength)
+        {
+            distance = column[t] + (c != pattern[prefix - 1]);
+            if (t + 1 < width && column[t + 1] + 1 < distance)
+                distance = column[t + 1] + 1;
+            if (t > 0 && next[t - 1] + 1 < distance)
+                distance = next[t - 1] + 1;
+        }
+        if (distance > maxErrors + 1) distance = maxErrors + 1;
+        next[t] = distance;
+        if (distance < least) least = distance;
+    }
+    return least;
+}
+
+// wholePatternEdits:  the distance to the whole pattern in the column
+//  after 'depth' letters, or k+1 if it is more
+static int wholePatternEdits(const int *column, int depth, int patternLength,
+                             int maxErrors)
+{
+    int t = patternLength - depth + maxErrors;
+    return (t >= 0 && t <= 2 * maxErrors) ? column[t] : maxErrors + 1;
+}
+
+/**************************************
+editSearch:  add the positions within edit distance 'maxErrors' of the
+pattern to 'Occurrences'.  The path to a node of depth d has the column
+after d letters at columns + d*(2k+1).  A node's column is made from its
+parent's when it is taken off the stack; every node taken off after the
+parent and before it is a descendant of the parent, at a greater depth,
+so the parent's column is still there.  No path goes deeper than m + k,
+since every entry of a column after that many letters is more than k.
+**************************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::editSearch(const Symbol *pattern,
+                                             int patternLength,
+                                             int maxErrors,
+                                             mylist *Occurrences) const
+{
+    int width = 2 * maxErrors + 1;
+    int maxDepth = patternLength + maxErrors;
+    int *columns = new int[(maxDepth + 1) * width];
+    int *scratch = new int[2 * width];
+    if (!columns || !scratch)
+       {cout << "Memory allocation failure in editSearch\n"; exit(1);}
+    for (int t = 0; t < width; t++)   // the column of the root
+    {
+        int prefix = t - maxErrors;
+        columns[t] = (prefix >= 0 && prefix <= patternLength) ? prefix
+                                                              : maxErrors + 1;
+    }
+
+    mylist stack;   // node and depth of each node still to visit
+    stack.add(ROOT);
+    stack.add(0);
+    while (stack.size() > 0)
+    {
+        int depth = stack.removeLast();
+        Index node = stack.removeLast();
+        int *column = columns + depth * width;
+        if (depth > 0
+                && nextEditColumn (pattern, patternLength, maxErrors,
+                                   column - width, depth - 1,
+                                   downArray[node].getLabel(), column)
+                       > maxErrors)
+            continue;
+        if (wholePatternEdits (column, depth, patternLength, maxErrors)
+                <= maxErrors)
+        {
+            appendSubtreeOccurrences (node, Occurrences);
+            continue;
+        }
+        if (editsWithin (pattern, patternLength, maxErrors, node, depth,
+                         column, scratch))
+            Occurrences->add(node);
+        if (depth == maxDepth) continue;
+        for (Index child = downArray[node].getChild(); child != NOCHILD;
+                 child = downArray[child].getSibling())
+        {
+            stack.add(child);
+            stack.add(depth + 1);
+        }
+    }
+    delete []columns;
+    delete []scratch;
+}
+
+// editsWithin:  whether the text at 'position', whose first 'depth'
+//  letters leave 'column', goes on to a string within 'maxErrors' edits of
+//  the pattern.  'scratch' has room for two columns.
+template <class Index, class Symbol>
+bool positionHeap<Index, Symbol>::editsWithin(const Symbol *pattern,
+                                              int patternLength,
+                                              int maxErrors, Index position,
+                                              int depth, const int *column,
+                                              int *scratch) const
+{
+    int width = 2 * maxErrors + 1;
+    const int *current = column;
+    for (int d = depth; d <= (long long) position; d++)
+    {
+        int *next = (current == scratch) ? scratch + width : scratch;
+        if (nextEditColumn (pattern, patternLength, maxErrors, current, d,
+                            letter (position - d), next) > maxErrors)
+            return false;
+        if (wholePatternEdits (next, d + 1, patternLength, maxErrors)
+                <= maxErrors)
+            return true;
+        current = next;
+    }
+    return false;                 // the text ends first
+}
+
+// compactOccurrences:  the occurrences of the pattern, as findOccurrences 
+//  finds them, but with those in the subtree of the end of the indexing 
+//  path left out:  the others are added to 'others', and the end is 
+//  returned, or NOCHILD if the pattern falls off the tree
+template <class Index, class Symbol>
+Index positionHeap<Index, Symbol>::compactOccurrences(const Symbol *pattern,
+                                                      int patternLength,
+                                                      mylist *others) const
+{
+    int pathEndDepth;
+    Index pathEndNode = indexIntoTrie (pattern, patternLength, pathEndDepth);
+    pathOccurrences (pattern, pathEndNode, others);
+    if (pathEndDepth == patternLength)
+        return pathEndNode;
+    others->add(pathEndNode);
+    int offset = pathEndDepth;
+    int candidateCount = others->size();
+    while (offset < patternLength && candidateCount > 0)
+        candidateCount = pruneCandidates (pattern + offset, 
+                                          patternLength - offset, 
+                                          others->getArray(), 
+                                          candidateCount, offset);
+    others->truncate(candidateCount);
+    return NOCHILD;
+}
+
+// countPathOccurrences:  the number of positions pathOccurrences would list
+template <class Index, class Symbol>
+int positionHeap<Index, Symbol>::countPathOccurrences(const Symbol *pattern, 
+                                                      Index pathEndNode) const
+{
+    int occurrences = 0;
+    Index child = ROOT;
+    for (const Symbol *patPtr = pattern; child != pathEndNode; patPtr++)
+    {
+        if (isDescendant (maxReach[child], pathEndNode))
+            occurrences++;
+        child = childOnLetter(child, *patPtr);
+    }
+    return occurrences;
+}
+
+// subtreeCount:  the number of nodes in the subtree rooted at 'node'
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::subtreeCount(Index node) const
+{
+    if (dfsOrder)
+        return finishingTime[node] - discoveryTime[node] + 1;
+    return subtreeSize(node) + 1;
+}
+
+/**************************************
+genCandidates:  (See heap::search for terminology.)  Return the set of 
+positions of the pattern string if it doesn't fall off the tree; find 
+the maximal prefix X1 and its candidate positions otherwise.  Indexing 
+on X_1 leads to a node, 'pathEndNode', which the caller has found, at 
+depth 'pathEndDepth'; this is |X_1|.
+
+If the pattern does not fall off the tree, then the set of positions of the 
+pattern are the descendants of 'pathEndNode' and the ancestors whose 
+maximal-reach pointers point to a (not necessarily proper) descendant 
+of 'pathEndNode'.  As we have seen in the naive search algorithm,
+every occurrence of the pattern is either an ancestor or a descendant
+of 'pathEndNode', so that finishes the search.
+
+Otherwise, X_1 is maximal in the pattern string.  The candidates of X_1 are
+those ancestors of 'pathEndNode' that are occurrences of X_1.
+
+The positions are added to the caller's list, 'candidates'.
+**************************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::genCandidates(const Symbol *pattern, 
+                                                int patternLength, 
+                                                Index pathEndNode,
+                                                int pathEndDepth, 
+                                                mylist *candidates) const
+{
+   // Find all *proper* ancestors of pathEndNode that are occurrences of X_1
+   pathOccurrences(pattern, pathEndNode, candidates);
+
+   // If didn't fall off tree during indexing, append all *not necessarily
+   //  proper* descendants of pathEndNode
+   if (pathEndDepth == patternLength) 
+       appendSubtreeOccurrences(pathEndNode, candidates);
+
+   // pathEndNode is a non-proper descendant of itself that is an occurrence of
+   //  X_1, so it must be reported as a candidate, along with those reported 
+   //  by pathOccurrences
+   else candidates->add(pathEndNode);  
+}
+
+/**************************************
+pruneCandidates:  (See heap::search comments for terminology.)  The pattern
+string is X_1X_2...X_j.  The 'suffix' parameter is the string 
+X_iX_{i+1}...X_j for some i > 1.  The 'candidates' parameter is all 
+positions of X_1X_2...X_{i-1} in the text, minus a set of positions that 
+are known not to be be followed by X_iX_{i+1}...X_j.  Since the pattern 
+is X_1X_2...X_j, 'candidates' contains all positions where the pattern 
+occurs, and possibly some where it does not.  The 'offset' parameter is 
+|X_1X_2...X_{i-1}|.  Find X_i by indexing as far as possible into the trie 
+on 'suffix'.  For each h in candidates, if i < j, throw h out of 'candidates' 
+if h-'offset' is not a candidate for X_i, and if i=j, throw h out if 
+h-'offset' is not an occurrence of X_j.  In either of these cases, h cannot 
+be the position of an occurrence of the pattern.  
+
+Therefore, if i < j, the final pruned candidate list is all occurrences 
+X_1X_2...X_i, minus a set of positions that are known not to be followed by
+by X_{i+1}X_{i+2}...X_j.  This differs from the candidate list at the beginning
+of the call, where the candidate list was all occurrences of X_1X_2...X_{i-1}
+that are known not to be followed by X_iX_{i+1}...X_j.  Therefore, the pruned 
+candidate list contains all occurrences of the pattern, and possibly some 
+others.   If i = j, the pruned candidate list is all occurrences of the 
+pattern, X_1X_2...X_j.  
+
+The procedure changes the 'offset' from |X_1X_2...X_{i-1}| to |X_1X_2...X_i| 
+in preparation for the next iteration of 'pruneCandidates', where i will be
+one step closer to j.
+
+The 'candidateCount' candidates are in the array 'candidates'.  Those that
+are kept are moved to its front, in the same order, and the procedure 
+returns how many there are, so no new list is needed.
+**************************************/
+
+template <class Index, class Symbol>
+int positionHeap<Index, Symbol>::pruneCandidates(const Symbol *suffix, 
+                                                 int suffixLength, 
+                                                 long long *candidates, 
+                                                 int candidateCount, 
+                                                 int &offset) const
+{
+    int pathEndDepth;  // depth of end node of indexing path
+
+    // index as far as possible into the heap on 'suffix' to find which
+    // of its prefixes is X_i.  Set 'pathEndDepth=|X_i|
+    Index pathEndNode = indexIntoTrie(suffix, suffixLength, pathEndDepth);
+    return keepCandidates (suffix, suffixLength, pathEndNode, pathEndDepth,
+                           candidates, candidateCount, offset);
+}
+
+// keepCandidates:  the rest of pruneCandidates, once the indexing path for
+//  X_i has been found to end at 'pathEndNode', at depth 'pathEndDepth'
+template <class Index, class Symbol>
+int positionHeap<Index, Symbol>::keepCandidates(const Symbol *suffix, 
+                                                int suffixLength, 
+                                                Index pathEndNode,
+                                                int pathEndDepth,
+                                                long long *candidates, 
+                                                int candidateCount, 
+                                                int &offset) const
+{
+    //  fellOffTree is true if we have found that i != j ...
+    bool fellOffTree = (pathEndDepth < suffixLength);
+
+    int kept = 0;  // number of candidates kept so far
+
+    // If X_i-'pathEndDepth' is the empty string, i != j, the first letter 
+    //  of 'suffix' does not occur in the text, so neither does the pattern.  We
+    //  only need to return a nonempty set of candidates if this doesn't happen
+    if (pathEndDepth > 0)
+    {
+        // for each h in 'candidates', keep h if it passes the test ...
+        for (int index = 0; index < candidateCount; index++)
+        {
+            long long h = candidates[index];
+            Index offsetNode = h - offset;
+  
+            // if we haven't run off the righthand end of the text ...
+            if (h >= offset)  
+            {
+                if   (
+                      // h-'offset' is an ancestor of X_i that is an occurrence
+                      //   of X_i
+                      (isDescendant (pathEndNode, offsetNode) 
+                         &&(isDescendant(maxReach[offsetNode], pathEndNode)))
+
+                      //OR i=j and h-'offset' is a descendant of X_j, hence
+                      //  an occurrence of it that isn't an ancestor ...
+                      || (!fellOffTree 
+                         && isDescendant (offsetNode, pathEndNode)))
+
+                   // THEN keep h ...
+                   candidates[kept++] = h;
+            }
+        }
+        // update 'offset' from |X_1X_2...X_{i-1}| to |X_1X_2...X_i| ...
+        offset += pathEndDepth;  
+    }
+
+    // The root is position 0, so a letter that occurs only at position 0
+    //  labels no edge of the heap.  Such a 'suffix' can still occur there 
+    //  if it is that single letter.
+    else if (suffixLength == 1 && suffix[0] == letter(0))
+    {
+        for (int index = 0; index < candidateCount; index++)
+            if (candidates[index] == offset)
+                candidates[kept++] = offset;
+        offset += suffixLength;
+    }
+    return kept;
+}
+
+/**************************************
+indexIntoTrie:  Find the maximal prefix Q of 'pattern' that is the sequence
+of edge labels on a path from the root in the position heap.  The returned
+value is the last node on the indexing path, and the parameter 'endDepth'
+tells the depth of this node, which is also the length of Q.
+
+The pattern is read from its first character forward, which descends
+through the positions of the text, since they are numbered from right 
+to left.
+**************************************/
+template <class Index, class Symbol>
+Index positionHeap<Index, Symbol>::indexIntoTrie(const Symbol *pattern, 
+                                                 int patternLength, 
+                                                 int &endDepth) const
+{
+    Index pathNode;      // current node on the indexing path
+    Index child = ROOT;  // child of 'pathNode', except at beginning, when
+                         //  it is the root and 'pathNode' is undefined
+    int depth = 0;     // current depth
+    endDepth = 0;
+    if (patternLength == 0) return ROOT;
+    else
+    {
+
+        const Symbol *patPtr = pattern;
+        do
+        {
+            pathNode = child;
+            // get child of pathNode reachable on next letter of 'pattern'
+            child = childOnLetter(pathNode, *patPtr++);
+            depth++;
+        } while (child != NOCHILD && depth < patternLength);
+
+        // If we fell off the tree when trying to find 'child', 'pathNode' 
+        //   is the last node of the indexing path
+        if (child == NOCHILD) 
+        {
+           endDepth = depth - 1;
+           return pathNode;
+        }
+        else // we reached the end of 'pattern, so 'child' is the end of path
+        {
+           endDepth = depth;
+           return child;
+        }
+    }
+}
+/****************************
+// childOnLetter:  Find the child reachable from 'node' on character c.  
+//  Each node keeps the label of the edge from its parent, so a short list
+//  of siblings is scanned without looking at the text; the children of a
+//  node with many of them are looked up in the childIndex.
+******************************/
+template <class Index, class Symbol>
+Index positionHeap<Index, Symbol>::childOnLetter(Index node, Symbol c) const
+{
+   if (downArray[node].isIndexed())
+      return children->find(node, c);
+   Index child = downArray[node].getChild();
+   while (child != NOCHILD && downArray[child].getLabel() != c)
+      child = downArray[child].getSibling();
+   return child;
+}
+
+/**************************************
+pathOccurrences:  Report all proper ancestors of pathEndNode whose maximal
+reach pointers point to (not necessarily proper) descendants of 'pathEndNode',
+by adding them to the list 'Occurrences'.
+**************************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::pathOccurrences(const Symbol *pattern, 
+                                                  Index pathEndNode, 
+                                                  mylist *Occurrences) const
+{
+    Index pathNode, child;  // parent and child on indexing path
+    
+    child = 0;
+    const Symbol *patPtr = pattern;
+                                           
+    while (child != pathEndNode)
+    {
+        pathNode = child;
+        if (isDescendant (maxReach[pathNode], pathEndNode))
+            Occurrences->add(pathNode);
+        child = childOnLetter(pathNode, *patPtr++);
+    }
+}
+
+// pathOccurrences:  the same, for an indexing path that the caller has
+//  kept:  the root, then the nodes path[1 .. depth]
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::pathOccurrences(const Index *path, 
+                                                  int depth, 
+                                                  mylist *Occurrences) const
+{
+    Index pathEndNode = depth == 0 ? ROOT : path[depth];
+    for (int d = 0; d < depth; d++)
+        if (isDescendant (maxReach[d == 0 ? ROOT : path[d]], pathEndNode))
+            Occurrences->add(d == 0 ? ROOT : path[d]);
 }
 
 /*****************************
 isDescendant:  tell whether node1 is a (not necessary proper) descendant of 
 node2
 ******************************/
-bool heap::isDescendant(int node1, int node2)
+template <class Index, class Symbol>
+bool positionHeap<Index, Symbol>::isDescendant(Index node1, Index node2) const
+{
+    // The intervals of two nodes are nested or disjoint, so node1 is a 
+    //  descendant exactly when its discovery time lies in node2's interval;
+    //  one unsigned comparison checks both ends of it.
+    Index offset = discoveryTime[node1] - discoveryTime[node2];
+    return offset <= (Index) (finishingTime[node2] - discoveryTime[node2]);
+}
+
+/****************************
+ *  If you didn't fall off the tree while indexing in on the pattern
+ *  string, then all positions corresponding to descendants of the
+ *  last node on the indexing path are also occurrences of the pattern.
+ *  Append them to the list of places where the pattern string occurs.
+ *  They lie together in dfsOrder, unless the heap has been modified 
+ *  since it was laid out, in which case the subtree is walked.
+*****************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::appendSubtreeOccurrences(
+                                       Index node, mylist *Occurrences) const
+{
+    if (dfsOrder)
+    {
+        const Index *first = dfsOrder + discoveryTime[node];
+        long long size = finishingTime[node] - discoveryTime[node] + 1;
+        long long *added = Occurrences->extend (size);
+        for (long long i = 0; i < size; i++)
+            added[i] = first[i];
+        return;
+    }
+    mylist stack;
+    stack.add(node);
+    while (stack.size() > 0)
+    {
+        Index current = stack.removeLast();
+        Occurrences->add(current);
+        for (Index child = downArray[current].getChild(); child != NOCHILD;
+                 child = downArray[child].getSibling())
+            stack.add(child);
+    }
+}
+
+/*************************
+setDiscoveryFinishing:  label all nodes of the heap with their Depth-First 
+Search discovery and finishing times, and list them in dfsOrder, if it is
+allocated (see build).  A node's 
+discovery time is its rank in the order the DFS discovers the nodes, and its 
+finishing time is the rank of the last node discovered in its subtree, so 
+the subtree of x is dfsOrder[discoveryTime[x] .. finishingTime[x]].  The
+DFS keeps its own stack, since the heap of a repetitive text is deep enough
+to overflow the call stack.
+**************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::setDiscoveryFinishing()
+{
+    labelBase = 0;
+    mylist stack;   // path from the root to the current node
+    Index rank = 0;
+    Index current = ROOT;
+    do
+    {
+        if (current != NOCHILD)   // discover 'current'
+        {
+            discoveryTime[current] = rank;
+            if (dfsOrder) dfsOrder[rank] = current;
+            rank++;
+            stack.add(current);
+            current = downArray[current].getChild();
+        }
+        else                      // finish the node on top of the stack
+        {
+            Index finished = stack.removeLast();
+            finishingTime[finished] = rank - 1;
+            current = finished == ROOT ? NOCHILD 
+                                       : downArray[finished].getSibling();
+        }
+    } while (stack.size() > 0);
+}
+
+/*************************
+layOutSubtrees:  relabel the nodes and rebuild dfsOrder after the heap has 
+been modified by prepend or deletePrefix, which drop it.  Until this is 
+called, searches find the occurrences in a subtree by walking it.  This 
+takes O(n) time, so it is worth calling after a batch of modifications 
+that will be followed by searches with many occurrences.
+**************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::layOutSubtrees()
+{
+    makeWritable();
+    if (!dfsOrder)
+    {
+        dfsOrder = new Index[nodeCapacity];
+        if (!dfsOrder) 
+           {cout << "Memory allocation failure in layOutSubtrees\n"; exit(1);}
+    }
+    delete rangeIndex;   // the nodes are about to be relabelled
+    rangeIndex = NULL;
+    setDiscoveryFinishing();
+}
+
+/*************************
+buildRangeIndex:  build rangeIndex over dfsOrder, laying the heap out 
+first if it has been modified, so that searches within a window of the 
+text (see search) take time for the occurrences in the window only.  This
+takes O(n log n) time and about n log n bits; call it once, before the 
+searches, and again after modifications.  Like any modification, it must
+not be called while other threads are searching.
+**************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::buildRangeIndex()
+{
+    if (!dfsOrder) layOutSubtrees();
+    if (!rangeIndex) rangeIndex = new waveletMatrix(dfsOrder, textLength);
+}
+
+// dropLayout:  forget dfsOrder, and rangeIndex over it, which a 
+//  modification is about to make wrong, and the cached answers
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::dropLayout()
+{
+    if (!indexMap) delete []dfsOrder;
+    dfsOrder = NULL;
+    delete rangeIndex;
+    rangeIndex = NULL;
+    if (cache) cache->clear();
+}
+
+/***********************
+// preorderPrint:  Display the shape of the heap tree using indented preorder 
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::preorderPrint() const
+{
+    preorderAux(0,0);
+}
+
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::preorderAux (Index index, int depth) const
+{
+    if (index == NOCHILD) return;
+    else
+    {
+       for (int i = 0; i < depth; i++)
+          cout << ' ';
+       cout << "Node " << index << "  Depth " << depth;
+       cout << " max reach: " << maxReach[index];
+       cout << " discovery: " << discoveryTime[index];
+       cout << " finish: " << finishingTime[index];
+       cout << "  Children: ";
+       for (Index child = downArray[index].getChild(); 
+                child != NOCHILD; 
+                child = downArray[child].getSibling())
+             cout << '(' << downArray[child].getLabel() << ',' << child << ')';
+       cout << '\n';
+       for (Index child = downArray[index].getChild(); 
+                child != NOCHILD; 
+                child = downArray[child].getSibling())
+            preorderAux(child, depth+1);
+    }
+}
+
+
+
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::getTextLength() const
+{
+    return textLength;
+}
+
+// getIndexSize:  the number of bytes in a node id or position
+template <class Index, class Symbol>
+int positionHeap<Index, Symbol>::getIndexSize() const
+{
+    return sizeof(Index);
+}
+
+// getBuildStats:  what the heap's last build cost; all zero for a heap
+//  that was loaded from an index file
+template <class Index, class Symbol>
+const buildStats &positionHeap<Index, Symbol>::getBuildStats() const
+{
+    return stats;
+}
+
+// memoryUsage:  the bytes the heap holds now, by structure
+template <class Index, class Symbol>
+heapMemory positionHeap<Index, Symbol>::memoryUsage() const
+{
+    heapMemory usage;
+    memset (&usage, 0, sizeof(usage));
+    if (indexMap)
+        usage.mapped = indexMapLength;
+    else
+    {
+        long long arrayBytes = (long long) nodeCapacity * sizeof(Index);
+        usage.nodes = nodeCapacity * sizeof(downNode<Index, Symbol>);
+        usage.maxReach = arrayBytes;
+        usage.dfsTimes = 2 * arrayBytes;
+        usage.dfsOrder = dfsOrder ? arrayBytes : 0;
+    }
+    usage.rangeIndex = rangeIndex ? rangeIndex->memoryUsage() : 0;
+    usage.children = children->memoryUsage();
+    usage.text = textBufferLength * sizeof(Symbol);
+    usage.total = usage.nodes + usage.maxReach + usage.dfsTimes 
+                  + usage.dfsOrder + usage.rangeIndex + usage.children 
+                  + usage.text;
+    return usage;
+}
+
+/***********************
+openCursor:  do the part of the search that an occurrenceCursor does when 
+it is created (see occurrenceCursor.cpp):  list the occurrences that are 
+not in the subtree of the end of the indexing path, and set the cursor up
+to report that subtree from dfsOrder or, if the heap is not laid out, by
+walking it.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::openCursor(occurrenceCursor &cursor, 
+                                             const Symbol *pattern, 
+                                             int patternLength) const
 {
-    return discoveryTime[node1] >= discoveryTime[node2] 
-        && finishingTime[node1] <= finishingTime[node2];
-               
+    int pathEndDepth;
+    Index pathEndNode = indexIntoTrie (pattern, patternLength, pathEndDepth);
+    if (pathEndDepth < patternLength)
+    {
+        cursor.pathHits = search (pattern, patternLength);
+        cursor.subtreeRoot = -1;
+    }
+    else
+    {
+        cursor.pathHits = new mylist();
+        pathOccurrences (pattern, pathEndNode, cursor.pathHits);
+        cursor.subtreeRoot = pathEndNode;
+        if (dfsOrder)
+        {
+            cursor.nextRank = discoveryTime[pathEndNode];
+            cursor.lastRank = finishingTime[pathEndNode];
+        }
+        else
+        {
+            cursor.stack = new mylist();
+            cursor.stack->add(pathEndNode);
+        }
+    }
 }
 
-/****************************
- *  If you didn't fall off the tree while indexing in on the pattern
- *  string, then all positions corresponding to descendants of the
- *  last node on the indexing path are also occurrences of the pattern.
- *  Append them to the list of places where the pattern string occurs.
-*****************************/
-void heap::appendSubtreeOccurrences(int node, mylist *Occurrences)
+/***********************
+findOccurrenceRanks:  find the occurrences of the pattern as a range of
+ranks, [firstRank, lastRank], whose positions are dfsOrder[firstRank ..
+lastRank] (see positionAtRank), and at most m others, which are put in 
+the list 'others', which must be empty.  The range is empty (lastRank < 
+firstRank) if the pattern falls off the tree, and also if the heap has 
+been modified and not laid out again (see layOutSubtrees), in which case
+every occurrence is put in 'others'.  This is for callers that keep arrays
+of their own in DFS order, such as a documentCollection.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::findOccurrenceRanks(const Symbol *pattern, 
+                                                      int patternLength, 
+                                                      mylist *others,
+                                                      long long &firstRank,
+                                                      long long &lastRank)
+                                                      const
+{
+    int pathEndDepth;
+    Index pathEndNode = indexIntoTrie (pattern, patternLength, pathEndDepth);
+    firstRank = 0;
+    lastRank = -1;
+    if (pathEndDepth < patternLength || !dfsOrder)
+        findOccurrences (pattern, patternLength, others);
+    else
+    {
+        pathOccurrences (pattern, pathEndNode, others);
+        firstRank = discoveryTime[pathEndNode];
+        lastRank = finishingTime[pathEndNode];
+    }
+}
+
+// positionAtRank:  the position with DFS discovery time 'rank', which is
+//  dfsOrder[rank]; the heap must be laid out (see layOutSubtrees)
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::positionAtRank(long long rank) const
+{
+    return dfsOrder[rank];
+}
+
+/***********************
+setCache:  keep the answers to searches, for patterns that are searched
+again, in up to 'maxBytes' of memory, giving up answers by 'policy' when it
+is full (see resultCache.cpp); 0 bytes stops caching.  search, count and
+contains then look the pattern up before searching the heap.  An answer is
+kept as the end of the indexing path, if the pattern does not fall off the
+tree, and the at most m other positions, so a hit saves all of the search
+but the listing of the subtree, and count needs only the subtree's size.
+Modifying the heap drops every answer.  The cache may be used by any number
+of threads at once, but this must not be called while any are searching.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::setCache(long long maxBytes, 
+                                           cachePolicy policy)
+{
+    delete cache;
+    cache = maxBytes > 0 ? new resultCache(maxBytes, policy) : NULL;
+}
+
+// getCacheStats:  what the cache has done since setCache, all zero if 
+//  there is none
+template <class Index, class Symbol>
+cacheStats positionHeap<Index, Symbol>::getCacheStats() const
 {
-    Occurrences->add(node);   // append root of subtree
-    for (int child = downArray[node].getChild();  //recursively append
-            child != NOCHILD;                          //  descendants
-            child = downArray[child].getSibling())
-       appendSubtreeOccurrences (child, Occurrences);
+    cacheStats stats;
+    memset (&stats, 0, sizeof(stats));
+    if (cache) cache->addStats(stats);
+    return stats;
 }
 
+// pushChildren:  add the children of 'node' to 'stack'
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::pushChildren(long long node, 
+                                                mylist *stack) const
+{
+    for (Index child = downArray[node].getChild(); child != NOCHILD;
+             child = downArray[child].getSibling())
+        stack->add(child);
+}
+
+/***********************
+Dynamic operations.  Positions are numbered from right to left, so the
+characters at the left end of the text are the most recently added 
+positions.  Adding a character there adds one node to the heap, as a leaf, 
+and deleting it removes a leaf; no other node changes.  This is the 
+direction in which the heap is built, so these operations cost about as 
+much per character as building does:  O(h(T)) to index down to the new 
+node's parent (the build algorithm climbs to it instead, which needs 
+parent pointers that are discarded after construction).
+
+The maximal-reach pointers that change are those of the occurrences of 
+the name of the new (or deleted) node.  Since the node is a leaf, those
+occurrences are all ancestors of it, so only the nodes on its path need 
+to be looked at.
+
+The DFS discovery and finishing times are kept as labels that need only
+to be in the right order, not consecutive.  A new leaf is labeled between 
+its parent's discovery time and its new sibling's discovery time.  When 
+there is no room there, the labels are kept as an order-maintenance list
+of the DFS's events, the discoveries and finishings in the order the DFS
+meets them:  they lie in [0, 2^B), B one less than the bits in an Index,
+and the aligned block of 2^i labels around the parent's discovery time is
+relabeled, spreading its events and the new leaf's two evenly over it,
+for the smallest i at which the block holds at most labelBase^i events.
+Its events are found by walking down from the deepest ancestor on the new
+leaf's path whose interval contains the whole block, so a walk costs
+about as much as the events it finds.  While labelBase is less than 2,
+which it is until the labels are nearly used up, each spread block
+leaves room in the blocks within it, and a new leaf costs O(log n)
+relabelings, amortized, whatever the shape of the heap; a periodic text,
+whose heap is one long path, is no worse than any other.  When the whole
+range overflows, labelBase is chosen again, so that it holds twice the
+events there are.  Deleting a leaf leaves its labels unused.  The labels
+given by setDiscoveryFinishing leave no room, so the first insertion after
+it spreads them over the whole range.  Either way, the intervals of a
+node's descendants lie within its own, which is all isDescendant needs,
+but the labels no longer index dfsOrder, so it is dropped until
+layOutSubtrees is called.
+
+Deleting characters at the right end of the text renumbers every position,
+and the heap of the remaining text is not obtained from the old one by
+deleting nodes (the node for the new position 0 must become the root), so
+deleteSuffix rebuilds the heap.
+*************************/
 /*************************
-discoveryFinishing:  label all nodes of the heap with their Depth-First Search
-discovery and finishing times.
-**************************/
-void heap::setDiscoveryFinishing()
+prepend:  add the 'length' characters at 'str' to the left end of the 
+text.  The text is copied into a buffer of the heap's own the first time
+this is called (and when the buffer needs to grow), so the caller's text 
+is no longer used.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::prepend(const Symbol *str, long long length)
 {
-    int i = 0;
-    setDFAux(0,0,i);
+    if (length <= 0) return;
+    if ((unsigned long long) length > NOCHILD - 1 - textLength)
+       {cout << "heap:  text too long for this index; rebuild it\n"; exit(1);}
+    makeWritable();
+    dropLayout();
+    reserveText(length);
+    reserveNodes(textLength + length);
+    for (long long i = length - 1; i >= 0; i--)  // right to left
+    {
+        textBuffer[(textEnd - textBuffer) - textLength] = str[i];
+        textLength++;
+        addLeftmostPosition();
+    }
+    text = textEnd - textLength + 1;
 }
 
-void heap::setDFAux (int index, int depth, int &i)
+/*************************
+deletePrefix:  delete the leftmost 'length' characters of the text.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::deletePrefix(long long length)
 {
-    if (index == -1) return;
-    else
+    if (length >= (long long) textLength)
+       {cout << "heap:  cannot delete the whole text\n"; exit(1);}
+    makeWritable();
+    dropLayout();
+    for (long long i = 0; i < length; i++)
     {
-       discoveryTime[index] = i++;
-       for (int child = downArray[index].getChild(); 
-                child != NOCHILD; 
-                child = downArray[child].getSibling())
-            setDFAux(child, depth+1, i);
-       finishingTime[index] = i++;
+        deleteLeftmostPosition();
+        textLength--;
+    }
+    if (!dna) text = textEnd - textLength + 1;
+}
+
+/*************************
+deleteSuffix:  delete the rightmost 'length' characters of the text.  This
+takes O(n) time; see above.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::deleteSuffix(long long length)
+{
+    if (length >= (long long) textLength)
+       {cout << "heap:  cannot delete the whole text\n"; exit(1);}
+    if (length <= 0) return;
+    freeArrays();
+    if (cache) cache->clear();
+    textLength -= length;
+    if (dna) dnaEnd -= length;
+    else textEnd -= length;
+    allocateArrays();
+    build();
+}
+
+/*************************
+addLeftmostPosition:  add the node for position textLength-1, whose 
+character has just been put at the left end of the text.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::addLeftmostPosition()
+{
+    Index x = textLength - 1;  // the new position
+    mylist path;               // path from the root to the new node's parent
+
+    // index into the heap on text[x..0] as far as possible; the new node's
+    //  name is one letter longer.  This cannot run off the end of the text,
+    //  since the path has fewer nodes than the heap does.
+    Index pathNode = ROOT;
+    Index depth = 0;
+    Index child = childOnLetter(ROOT, letter(x));
+    while (child != NOCHILD)
+    {
+        path.add(pathNode);
+        pathNode = child;
+        depth++;
+        child = childOnLetter(pathNode, letter(x - depth));
+    }
+    path.add(pathNode);
+
+    // The positions whose maximal-reach pointer now reaches x are the 
+    //  occurrences of x's name.  They are ancestors of x, so they were
+    //  occurrences of its parent's name that could go no further, and 
+    //  whose next letter is x's letter.
+    Symbol c = letter(x - depth);
+    downArray[x].clear();
+    labelNewLeaf(x, pathNode, &path);
+    insertChild(x, pathNode, c);
+
+    maxReach[x] = x;
+    for (long long index = 0; index < path.size(); index++)
+    {
+        Index ancestor = path.getElement(index);
+        if (maxReach[ancestor] == pathNode && ancestor >= depth
+                && letter(ancestor - depth) == c)
+            maxReach[ancestor] = x;
+    }
+}
+
+/*************************
+deleteLeftmostPosition:  delete the node for position textLength-1, which
+is a leaf, since it is the most recently added position.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::deleteLeftmostPosition()
+{
+    Index x = textLength - 1;
+    mylist path;               // path from the root to x's parent
+
+    Index pathNode = ROOT;
+    Index depth = 0;
+    Index child = childOnLetter(ROOT, letter(x));
+    while (child != x)
+    {
+        path.add(pathNode);
+        pathNode = child;
+        depth++;
+        child = childOnLetter(pathNode, letter(x - depth));
+    }
+    path.add(pathNode);
+
+    // occurrences of x's name fall back to its parent's name ...
+    for (long long index = 0; index < path.size(); index++)
+    {
+        Index ancestor = path.getElement(index);
+        if (maxReach[ancestor] == x)
+            maxReach[ancestor] = pathNode;
+    }
+
+    removeChild(x, pathNode);
+}
+
+/*************************
+labelNewLeaf:  give leaf 'x', which is about to become the first child of
+'parent', DFS times between the parent's discovery time and those of the
+parent's current first child.  'path' holds the ancestors of 'x', from 
+the root down to 'parent'.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::labelNewLeaf(Index x, Index parent, 
+                                                mylist *path)
+{
+    Index low = discoveryTime[parent];
+    Index high = nextLabel(parent);
+    if (labelBase == 0 || high - low < 3)
+    {
+        relabelForInsertion(x, parent, path);
+        return;
+    }
+    discoveryTime[x] = low + (high - low) / 3;
+    finishingTime[x] = low + 2 * (high - low) / 3;
+}
+
+// nextLabel:  the label that follows 'node''s discovery time
+template <class Index, class Symbol>
+Index positionHeap<Index, Symbol>::nextLabel(Index node) const
+{
+    Index child = downArray[node].getChild();
+    return child == NOCHILD ? finishingTime[node] : discoveryTime[child];
+}
+
+/*************************
+relabelForInsertion:  label leaf 'x', the new first child of 'parent', by
+relabeling the smallest aligned block of labels around the parent's
+discovery time that is not too full (see above), or, if there is none,
+every label.  'path' holds the ancestors of 'x', from the root down to 
+'parent'.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::relabelForInsertion(Index x, Index parent, 
+                                                       mylist *path)
+{
+    const int bits = 8 * sizeof(Index) - 1;   // labels are below 2^bits
+    long long deepest = path->size() - 1;
+    double limit = 1;
+    for (int i = 1; i < bits && labelBase != 0; i++)
+    {
+        Index size = (Index) 1 << i;
+        Index low = discoveryTime[parent] & ~(size - 1);
+        Index high = low + size;
+        limit *= labelBase;
+        // the deepest ancestor whose interval contains the whole block; it
+        //  only moves up as the blocks grow
+        while (deepest >= 0)
+        {
+            Index ancestor = path->getElement(deepest);
+            if (discoveryTime[ancestor] < low 
+                    && finishingTime[ancestor] >= high)
+                break;
+            deepest--;
+        }
+        Index top = deepest >= 0 ? path->getElement(deepest) : NOCHILD;
+        long long events = blockEvents(top, low, high, x, parent, 0);
+        if (events <= limit)
+        {
+            blockEvents(top, low, high, x, parent, events);
+            return;
+        }
+    }
+
+    // every label:  the whole range is to hold twice the events there are
+    Index size = (Index) 1 << bits;
+    long long events = blockEvents(NOCHILD, 0, size, x, parent, 0);
+    if ((unsigned long long) events > size)
+       {cout << "heap:  too many positions to label for insertion\n"; exit(1);}
+    labelBase = pow(2.0 * events, 1.0 / bits);
+    labelBase = std::max(4.0 / 3, std::min(2.0, labelBase));
+    blockEvents(NOCHILD, 0, size, x, parent, events);
+}
+
+// labelSpreader:  the labels low + floor(k size / count), for k = 0, 1,
+//  ..., stepped without overflow; step and remainder are size / count
+//  and size % count
+template <class Index>
+struct labelSpreader
+{
+    Index label, step, remainder, carry, count;
+    Index next()
+    {
+        Index current = label;
+        label += step;
+        carry += remainder;
+        if (carry >= count)
+        {
+            carry -= count;
+            label++;
+        }
+        return current;
+    }
+};
+
+/*************************
+blockEvents:  the DFS's events whose labels are in [low, high), in the 
+order it meets them, with leaf 'x''s discovery and finishing, which come 
+right after the discovery of 'parent', as x is to be its first child.  
+Count them, or, if 'spread' is not 0, relabel them, spreading 'spread' 
+labels evenly over the block.  'top' is a node whose interval contains
+the block, from which the walk starts, or NOCHILD to start at the root.
+The labels of the events not yet met are the old ones, so the walk knows
+where to stop even as it relabels.
+*************************/
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::blockEvents(Index top, Index low, 
+                                                   Index high, Index x, 
+                                                   Index parent, 
+                                                   long long spread)
+{
+    mylist stack;   // nodes discovered but not finished, below 'top'
+    Index node = ROOT;
+    bool finishing = false;   // whether the event is node's finishing
+
+    // down to the first event in the block:  skip the children that
+    //  finish before it, and go into one that is discovered before it
+    if (top != NOCHILD || discoveryTime[ROOT] < low)
+    {
+        node = top != NOCHILD ? top : ROOT;
+        Index child = downArray[node].getChild();
+        while (child != NOCHILD && discoveryTime[child] < low)
+        {
+            if (finishingTime[child] < low)
+                child = downArray[child].getSibling();
+            else
+            {
+                stack.add(node);
+                node = child;
+                child = downArray[node].getChild();
+            }
+        }
+        if (child != NOCHILD)
+        {
+            stack.add(node);
+            node = child;
+        }
+        else
+            finishing = true;
+    }
+
+    // then on through the events, in order, until one is past the block
+    long long events = 0;
+    labelSpreader<Index> labels = {low, 0, 0, 0, (Index) spread};
+    if (spread)
+    {
+        labels.step = (high - low) / spread;
+        labels.remainder = (high - low) % spread;
+    }
+    while ((finishing ? finishingTime[node] : discoveryTime[node]) < high)
+    {
+        if (spread)
+            (finishing ? finishingTime : discoveryTime)[node] = labels.next();
+        events++;
+        if (node == parent && !finishing)   // x is to be its first child
+        {
+            if (spread)
+            {
+                discoveryTime[x] = labels.next();
+                finishingTime[x] = labels.next();
+            }
+            events += 2;
+        }
+
+        if (!finishing)
+        {
+            Index child = downArray[node].getChild();
+            if (child != NOCHILD)
+            {
+                stack.add(node);
+                node = child;
+            }
+            else
+                finishing = true;
+        }
+        else
+        {
+            Index sibling = node == ROOT ? NOCHILD 
+                                         : downArray[node].getSibling();
+            if (sibling != NOCHILD)
+            {
+                node = sibling;
+                finishing = false;
+            }
+            else if (stack.size() > 0)
+                node = stack.removeLast();
+            else
+                break;   // finished the root
+        }
+    }
+    return events;
+}
+
+// subtreeSize:  number of proper descendants of 'node'
+template <class Index, class Symbol>
+long long positionHeap<Index, Symbol>::subtreeSize(Index node) const
+{
+    mylist stack;
+    long long size = 0;
+    for (Index child = downArray[node].getChild(); child != NOCHILD;
+             child = downArray[child].getSibling())
+        stack.add(child);
+    while (stack.size() > 0)
+    {
+        size++;
+        for (Index child = downArray[stack.removeLast()].getChild(); 
+                 child != NOCHILD; child = downArray[child].getSibling())
+            stack.add(child);
+    }
+    return size;
+}
+
+/*************************
+makeWritable:  if the arrays are mapped from an index file, copy them into
+memory of the heap's own, so that they can be modified.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::makeWritable()
+{
+    if (!indexMap) return;
+    children->makeWritable();
+    downNode<Index, Symbol> *newDown = new downNode<Index, Symbol>[textLength];
+    Index *newMaxReach = new Index[textLength];
+    Index *newDiscovery = new Index[textLength];
+    Index *newFinishing = new Index[textLength];
+    if (!newDown || !newMaxReach || !newDiscovery || !newFinishing)
+       {cout << "Memory allocation failure in makeWritable\n"; exit(1);}
+    for (Index i = 0; i < textLength; i++)
+    {
+        newDown[i] = downArray[i];
+        newMaxReach[i] = maxReach[i];
+        newDiscovery[i] = discoveryTime[i];
+        newFinishing[i] = finishingTime[i];
+    }
+    fileUnmap (indexMap, indexMapLength);
+    indexMap = NULL;
+    dfsOrder = NULL;    // the heap is about to be modified or laid out
+    downArray = newDown;
+    maxReach = newMaxReach;
+    discoveryTime = newDiscovery;
+    finishingTime = newFinishing;
+    nodeCapacity = textLength;
+}
+
+/*************************
+reserveText:  make sure there is room in the heap's own text buffer for
+'extra' more characters at the left end, copying the text into a larger
+buffer if not.  The buffer at least doubles, so the copying takes O(1)
+amortized time per character added.  A packed text is unpacked into the
+buffer, and not used after that.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::reserveText(long long extra)
+{
+    if (textBuffer && (textEnd - textBuffer) + 1 - (long long) textLength 
+                          >= extra) 
+        return;
+    long long newLength = 2 * (textLength + extra);
+    Symbol *newBuffer = new Symbol[newLength];
+    if (!newBuffer)
+       {cout << "Memory allocation failure in reserveText\n"; exit(1);}
+    for (Index i = 0; i < textLength; i++)   // right-align the text
+        newBuffer[newLength - 1 - i] = letter(i);
+    delete []textBuffer;
+    textBuffer = newBuffer;
+    textBufferLength = newLength;
+    textEnd = textBuffer + textBufferLength - 1;
+    text = textEnd - textLength + 1;
+    dna = NULL;
+}
+
+/*************************
+reserveNodes:  make sure the node arrays have room for 'count' nodes, 
+at least doubling them if not.
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::reserveNodes(long long count)
+{
+    if (count <= (long long) nodeCapacity) return;
+    long long newCapacity = 2 * (long long) nodeCapacity;
+    if (count > newCapacity) newCapacity = count;
+    if ((unsigned long long) newCapacity > NOCHILD) newCapacity = NOCHILD;
+    downNode<Index, Symbol> *newDown = new downNode<Index, Symbol>[newCapacity];
+    Index *newMaxReach = new Index[newCapacity];
+    Index *newDiscovery = new Index[newCapacity];
+    Index *newFinishing = new Index[newCapacity];
+    if (!newDown || !newMaxReach || !newDiscovery || !newFinishing)
+       {cout << "Memory allocation failure in reserveNodes\n"; exit(1);}
+    for (Index i = 0; i < textLength; i++)
+    {
+        newDown[i] = downArray[i];
+        newMaxReach[i] = maxReach[i];
+        newDiscovery[i] = discoveryTime[i];
+        newFinishing[i] = finishingTime[i];
     }
+    delete []downArray;
+    delete []maxReach;
+    delete []discoveryTime;
+    delete []finishingTime;
+    downArray = newDown;
+    maxReach = newMaxReach;
+    discoveryTime = newDiscovery;
+    finishingTime = newFinishing;
+    nodeCapacity = newCapacity;
 }
 
 /***********************
-// preorderPrint:  Display the shape of the heap tree using indented preorder 
+Index files.  Building the heap, installing the maximal-reach pointers and
+labeling the nodes with DFS times all take O(n) time, but it is a lot of
+work for a large text.  'save' writes the five arrays that searching needs,
+exactly as they lie in memory, and 'load' maps them back in without
+reading or converting them, so a query process can start serving as soon
+as the mapping is made.  The text itself is not stored; the caller
+supplies it (typically mapped with fileMap), and the header records enough
+about it to detect an index file that belongs to a different text.
+
+File layout:  the header below, then the downArray, maxReach,
+discoveryTime, finishingTime and dfsOrder arrays, then the arrays of the 
+childIndex, each starting at a multiple of INDEX_ALIGNMENT bytes so that 
+the mapped arrays are aligned.  The header ends with a checksum of the
+rest of it, and records a checksum of the arrays, so that a damaged file
+is turned away rather than followed into memory it does not hold.
 *************************/
-void heap::preorderPrint()
+const char INDEX_MAGIC[8] = {'P','O','S','H','E','A','P','\0'};
+const int INDEX_VERSION = 6;
+const long INDEX_ALIGNMENT = 4096;
+const int INDEX_SAMPLES = 4096;   // text positions hashed for quick check
+
+struct indexHeader
 {
-    preorderAux(0,0);
+    char magic[8];          // INDEX_MAGIC
+    int version;            // INDEX_VERSION
+    int byteOrder;          // 1, as written by the machine that saved it
+    int indexSize;          // bytes in a node id: 4 or 8 (see create)
+    int symbolSize;         // bytes in a letter: 1, 2 or 4
+    int nodeSize;           // sizeof(downNode<Index, Symbol>) on that machine
+    long long textLength;   // number of letters in the text
+    int alphabetSize;       // number of distinct bytes in a text of bytes;
+                            //   0 for wider letters
+    unsigned char alphabet[32];  // bit c is set if byte c occurs
+    unsigned long long textChecksum;    // checksum of the whole text
+    unsigned long long sampleChecksum;  // checksum of INDEX_SAMPLES positions
+    long long downOffset;        // file offsets of the arrays
+    long long maxReachOffset;
+    long long discoveryOffset;
+    long long finishingOffset;
+    long long dfsOrderOffset;
+    childIndexSizes childSizes;  // sizes of the childIndex arrays ...
+    long long hashNodesOffset;   //   and their offsets
+    long long hashSlotsOffset;
+    long long slotOffset;
+    long long labelPoolOffset;
+    long long childPoolOffset;
+    long long fileLength;
+    unsigned long long arrayChecksum;   // checksum of the arrays, in order
+    unsigned long long headerChecksum;  // checksum of the fields above
+};
+
+const int INDEX_ARRAYS = 10;
+
+// indexArrays:  the offset and length in bytes of each array 'header'
+//  records, in the order they lie in the file
+template <class Index, class Symbol>
+static void indexArrays(const indexHeader &header, 
+                        long long offset[INDEX_ARRAYS],
+                        long long length[INDEX_ARRAYS])
+{
+    const childIndexSizes &sizes = header.childSizes;
+    long long n = header.textLength;
+    offset[0] = header.downOffset;
+    length[0] = n * sizeof(downNode<Index, Symbol>);
+    offset[1] = header.maxReachOffset;
+    offset[2] = header.discoveryOffset;
+    offset[3] = header.finishingOffset;
+    offset[4] = header.dfsOrderOffset;
+    length[1] = length[2] = length[3] = length[4] = n * sizeof(Index);
+    offset[5] = header.hashNodesOffset;
+    offset[6] = header.hashSlotsOffset;
+    length[5] = length[6] = sizes.hashCapacity * sizeof(Index);
+    offset[7] = header.slotOffset;
+    length[7] = sizes.slotCount * sizeof(childSlot<Index>);
+    offset[8] = header.labelPoolOffset;
+    length[8] = sizes.poolLength * sizeof(Symbol);
+    offset[9] = header.childPoolOffset;
+    length[9] = sizes.poolLength * sizeof(Index);
+}
+
+// arraysInFile:  whether every array 'header' records lies, whole and 
+//  aligned, between the header and the end of the file.  The counts are
+//  checked against the file length first, so that the lengths cannot 
+//  overflow.
+template <class Index, class Symbol>
+static bool arraysInFile(const indexHeader &header)
+{
+    const childIndexSizes &sizes = header.childSizes;
+    long long fileLength = header.fileLength;
+    if (header.textLength < 1 || header.textLength > fileLength
+            || sizes.hashCapacity < 0 || sizes.hashCapacity > fileLength
+            || (sizes.hashCapacity & (sizes.hashCapacity - 1)) != 0
+            || sizes.slotCount < 0 || sizes.slotCount > fileLength
+            || sizes.poolLength < 0 || sizes.poolLength > fileLength)
+        return false;
+    long long offset[INDEX_ARRAYS], length[INDEX_ARRAYS];
+    indexArrays<Index, Symbol> (header, offset, length);
+    for (int a = 0; a < INDEX_ARRAYS; a++)
+        if (offset[a] < (long long) sizeof(indexHeader)
+                || offset[a] % INDEX_ALIGNMENT != 0 
+                || offset[a] > fileLength 
+                || length[a] > fileLength - offset[a])
+            return false;
+    return true;
+}
+
+// arrayChecksum:  checksum of the arrays of the index file in 'map',
+//  which arraysInFile has checked lie within it
+template <class Index, class Symbol>
+static unsigned long long arrayChecksum(const char *map)
+{
+    long long offset[INDEX_ARRAYS], length[INDEX_ARRAYS];
+    indexArrays<Index, Symbol> (*(const indexHeader *) map, offset, length);
+    unsigned long long hash = CHECKSUM_SEED;
+    for (int a = 0; a < INDEX_ARRAYS; a++)
+        hash = checksum (map + offset[a], length[a], hash);
+    return hash;
+}
+
+// headerChecksum:  checksum of the header up to its own checksum
+static unsigned long long headerChecksum(const indexHeader &header)
+{
+    return checksum ((const char *) &header, 
+                     offsetof(indexHeader, headerChecksum));
+}
+
+// round 'offset' up to the next multiple of INDEX_ALIGNMENT
+static long long alignOffset(long long offset)
+{
+    return (offset + INDEX_ALIGNMENT - 1) / INDEX_ALIGNMENT * INDEX_ALIGNMENT;
+}
+
+// Checksum of a fixed number of evenly spaced letters of the text; it
+//  takes the same time for a text of any length, so it is cheap enough to
+//  check every time an index is loaded.  'text' is a string of Symbols or
+//  a dnaWindow; a text gets the same checksum either way.
+template <class Symbol, class Letters>
+static unsigned long long sampleChecksum(const Letters &text, long long length)
+{
+    unsigned long long hash = CHECKSUM_SEED;
+    long long step = length / INDEX_SAMPLES + 1;
+    Symbol c;
+    for (long long i = 0; i < length; i += step)
+    {
+        c = text[i];
+        hash = checksum ((const char *) &c, sizeof(Symbol), hash);
+    }
+    c = text[length - 1];   // always include the end
+    return checksum ((const char *) &c, sizeof(Symbol), hash);
+}
+
+// textAlphabet:  set bit c of 'alphabet' for each byte c that occurs in
+//  a text of bytes; a text of wider letters has no alphabet recorded
+template <class Symbol, class Letters>
+static void textAlphabet(const Letters &text, long long length, 
+                         unsigned char alphabet[32])
+{
+    memset (alphabet, 0, 32);
+    for (long long i = 0; sizeof(Symbol) == 1 && i < length; i++)
+    {
+        unsigned char c = text[i];
+        alphabet[c / 8] |= 1 << (c % 8);
+    }
+}
+
+// samplesInAlphabet:  whether the letters sampleChecksum reads all occur 
+//  in 'alphabet'; as cheap as sampleChecksum, and a stale index usually 
+//  fails it when the texts differ in their letters
+template <class Symbol, class Letters>
+static bool samplesInAlphabet(const Letters &text, long long length,
+                              const unsigned char alphabet[32])
+{
+    if (sizeof(Symbol) != 1) return true;
+    long long step = length / INDEX_SAMPLES + 1;
+    for (long long i = 0; i < length; i += step)
+    {
+        unsigned char c = text[i];
+        if (!(alphabet[c / 8] & (1 << (c % 8)))) return false;
+    }
+    return true;
+}
+
+// alphabetSize:  the number of bytes set in 'alphabet'
+static int alphabetSize(const unsigned char alphabet[32])
+{
+    int size = 0;
+    for (int c = 0; c < 256; c++)
+        if (alphabet[c / 8] & (1 << (c % 8)))
+            size++;
+    return size;
+}
+
+// textChecksum:  checksum of the whole text
+template <class Symbol>
+static unsigned long long textChecksum(const Symbol *text, long long length)
+{
+    return checksum ((const char *) text, length * sizeof(Symbol));
+}
+
+// The letters of a packedDna from 'first' on, indexed like a string
+struct dnaWindow
+{
+    const packedDna *dna;
+    long long first;
+    char operator[](long long i) const {return dna->letter(first + i);}
+};
+
+// textChecksum:  the same for a packed text, unpacked a block at a time
+const int CHECKSUM_BLOCK = 4096;
+template <class Symbol>
+static unsigned long long textChecksum(const dnaWindow &dna, long long length)
+{
+    unsigned long long hash = CHECKSUM_SEED;
+    Symbol block[CHECKSUM_BLOCK];
+    for (long long start = 0; start < length; start += CHECKSUM_BLOCK)
+    {
+        int count = 0;
+        while (count < CHECKSUM_BLOCK && start + count < length)
+        {
+            block[count] = dna[start + count];
+            count++;
+        }
+        hash = checksum ((const char *) block, count * sizeof(Symbol), hash);
+    }
+    return hash;
+}
+
+// write 'length' bytes at 'offset', padding the file with zeros up to it
+static void writeAt(std::ofstream &out, long long offset, 
+                    const void *data, long long length)
+{
+    while ((long long) out.tellp() < offset)
+        out.put('\0');
+    out.write((const char *) data, length);
 }
 
-void heap::preorderAux (int index, int depth)
+/***********************
+save:  write the heap to the file 'indexFilename' so that 'load' can 
+map it back in later, together with the same text.  A heap that has been
+modified is laid out again first (see layOutSubtrees).
+*************************/
+template <class Index, class Symbol>
+void positionHeap<Index, Symbol>::save(const char *indexFilename)
 {
-    if (index == -1) return;
+    if (!dfsOrder) layOutSubtrees();
+    indexHeader header;
+    memset (&header, 0, sizeof(header));
+    memcpy (header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.byteOrder = 1;
+    header.indexSize = sizeof(Index);
+    header.symbolSize = sizeof(Symbol);
+    header.nodeSize = sizeof(downNode<Index, Symbol>);
+    header.textLength = textLength;
+    if (dna)
+    {
+        dnaWindow window = {dna, dnaEnd - (long long) textLength + 1};
+        textAlphabet<Symbol> (window, textLength, header.alphabet);
+        header.textChecksum = textChecksum<Symbol> (window, textLength);
+        header.sampleChecksum = sampleChecksum<Symbol> (window, textLength);
+    }
     else
     {
-       for (int i = 0; i < depth; i++)
-          cout << ' ';
-       cout << "Node " << index << "  Depth " << depth;
-       cout << " max reach: " << maxReach[index];
-       cout << " discovery: " << discoveryTime[index];
-       cout << " finish: " << finishingTime[index];
-       cout << "  Children: ";
-       for (int child = downArray[index].getChild(); 
-                child != NOCHILD; 
-                child = downArray[child].getSibling())
-             cout << '(' << text[child-depth] << ',' << child << ')';
-       cout << '\n';
-       for (int child = downArray[index].getChild(); 
-                child != NOCHILD; 
-                child = downArray[child].getSibling())
-            preorderAux(child, depth+1);
+        textAlphabet<Symbol> (text, textLength, header.alphabet);
+        header.textChecksum = textChecksum (text, textLength);
+        header.sampleChecksum = sampleChecksum<Symbol> (text, textLength);
+    }
+    header.alphabetSize = alphabetSize (header.alphabet);
+
+    long long arrayLength = (long long) textLength * sizeof(Index);
+    header.downOffset = alignOffset (sizeof(header));
+    header.maxReachOffset = alignOffset (header.downOffset 
+                         + textLength * sizeof(downNode<Index, Symbol>));
+    header.discoveryOffset = alignOffset (header.maxReachOffset + arrayLength);
+    header.finishingOffset = alignOffset (header.discoveryOffset + arrayLength);
+    header.dfsOrderOffset = alignOffset (header.finishingOffset + arrayLength);
+
+    const Index *hashNodes, *hashSlots, *childPool;
+    const childSlot<Index> *slots;
+    const Symbol *labelPool;
+    children->getArrays (hashNodes, hashSlots, slots, labelPool, childPool);
+    childIndexSizes sizes = children->getSizes();
+    header.childSizes = sizes;
+    header.hashNodesOffset = alignOffset (header.dfsOrderOffset + arrayLength);
+    header.hashSlotsOffset = alignOffset (header.hashNodesOffset 
+                                          + sizes.hashCapacity * sizeof(Index));
+    header.slotOffset = alignOffset (header.hashSlotsOffset 
+                                     + sizes.hashCapacity * sizeof(Index));
+    header.labelPoolOffset = alignOffset (header.slotOffset 
+                               + sizes.slotCount * sizeof(childSlot<Index>));
+    header.childPoolOffset = alignOffset (header.labelPoolOffset 
+                                   + sizes.poolLength * sizeof(Symbol));
+    header.fileLength = header.childPoolOffset 
+                        + sizes.poolLength * sizeof(Index);
+
+    const void *data[INDEX_ARRAYS] = {downArray, maxReach, discoveryTime, 
+                                      finishingTime, dfsOrder, hashNodes, 
+                                      hashSlots, slots, labelPool, childPool};
+    long long offset[INDEX_ARRAYS], length[INDEX_ARRAYS];
+    indexArrays<Index, Symbol> (header, offset, length);
+    header.arrayChecksum = CHECKSUM_SEED;
+    for (int a = 0; a < INDEX_ARRAYS; a++)
+        header.arrayChecksum = checksum ((const char *) data[a], length[a],
+                                         header.arrayChecksum);
+    header.headerChecksum = headerChecksum (header);
+
+    std::ofstream out (indexFilename, std::ios::out | std::ios::binary);
+    if (out.fail())
+    {
+        cout << "Attempt to open " << indexFilename << " failed.\n";
+        exit(1);
+    }
+    writeAt (out, 0, &header, sizeof(header));
+    for (int a = 0; a < INDEX_ARRAYS; a++)
+        writeAt (out, offset[a], data[a], length[a]);
+    out.close();
+    if (out.fail())
+    {
+        cout << "Attempt to write " << indexFilename << " failed.\n";
+        exit(1);
     }
 }
 
+/***********************
+load:  map a heap that was written by 'save' for the 'length' characters
+pointed to by 'str'.  Nothing is rebuilt or copied; the arrays are used 
+where they lie in the mapped file.  Returns NULL, after saying why, if the
+file is not an index file this program can use, or if it was not made
+for this text.  The length and a sample of the characters are always
+compared, and the sampled characters must be in the saved alphabet; if
+'verify' is true, the alphabet and the checksum of the whole text are
+also compared, which catches any change to the text but takes time 
+proportional to its length, and so is the checksum of the arrays, which
+catches damage to the file itself.  Damage to the header is always
+caught, as is an array that does not lie within the file.  Callers should verify unless the text is
+known not to have changed since the index was saved.  The heap has the
+index width it was saved with.  An index saved for a text may be loaded
+for the same text packed (see create), and the other way around.
+*************************/
+template <class Symbol>
+basicHeap<Symbol> *basicHeap<Symbol>::load(const Symbol *str, long long length,
+                                           const char *indexFilename, 
+                                           bool verify)
+{
+    return loadIndex (str, NULL, length, indexFilename, verify);
+}
 
+template <class Symbol>
+basicHeap<Symbol> *basicHeap<Symbol>::load(const packedDna *dna,
+                                           const char *indexFilename, 
+                                           bool verify)
+{
+    return loadIndex (NULL, dna, dna->getLength(), indexFilename, verify);
+}
 
-int heap::getTextLength()
+// loadIndex:  'load', for the text 'str' or, if that is NULL, 'dna'
+template <class Symbol>
+basicHeap<Symbol> *basicHeap<Symbol>::loadIndex(const Symbol *str, 
+                                                const packedDna *dna,
+                                                long long length,
+                                                const char *indexFilename, 
+                                                bool verify)
+{
+    if (access (indexFilename, R_OK) != 0)
+    {
+        cout << "Cannot read index file " << indexFilename << ".\n";
+        return NULL;
+    }
+    long mapLength;
+    char *map = fileMap (indexFilename, mapLength, false);
+    if (!map)
+    {
+        cout << "Cannot map index file " << indexFilename << ".\n";
+        return NULL;
+    }
+    indexHeader *header = (indexHeader *) map;
+    dnaWindow window = {dna, 0};
+    const char *problem = NULL;
+    if (mapLength < (long) sizeof(indexHeader) 
+            || memcmp (header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+        problem = "is not a position heap index file";
+    else if (header->version != INDEX_VERSION)
+        problem = "was written by a different version of this program";
+    else if (header->symbolSize != sizeof(Symbol))
+        problem = "was written for letters of a different width";
+    else if (header->byteOrder != 1
+                 || !((header->indexSize == sizeof(uint32_t) 
+                         && header->nodeSize 
+                                == sizeof(downNode<uint32_t, Symbol>))
+                      || (header->indexSize == sizeof(uint64_t) 
+                         && header->nodeSize 
+                                == sizeof(downNode<uint64_t, Symbol>))))
+        problem = "was written on an incompatible machine";
+    else if (header->fileLength != mapLength)
+        problem = "is truncated";
+    else if (header->headerChecksum != headerChecksum (*header)
+                 || header->alphabetSize != alphabetSize (header->alphabet)
+                 || !(header->indexSize == sizeof(uint32_t)
+                          ? arraysInFile<uint32_t, Symbol> (*header)
+                          : arraysInFile<uint64_t, Symbol> (*header)))
+        problem = "has a damaged header";
+    else if (header->textLength != length
+                 || header->sampleChecksum 
+                        != (dna ? sampleChecksum<Symbol> (window, length)
+                                : sampleChecksum<Symbol> (str, length))
+                 || !(dna ? samplesInAlphabet<Symbol> (window, length, 
+                                                       header->alphabet)
+                          : samplesInAlphabet<Symbol> (str, length,
+                                                       header->alphabet)))
+        problem = "was built for a different text";
+    else if (verify)
+    {
+        unsigned char alphabet[32];
+        if (dna)
+            textAlphabet<Symbol> (window, length, alphabet);
+        else
+            textAlphabet<Symbol> (str, length, alphabet);
+        if (memcmp (alphabet, header->alphabet, sizeof(alphabet)) != 0
+                || header->textChecksum 
+                       != (dna ? textChecksum<Symbol> (window, length)
+                               : textChecksum (str, length)))
+            problem = "was built for a different text";
+        else if (header->arrayChecksum
+                     != (header->indexSize == sizeof(uint32_t)
+                             ? arrayChecksum<uint32_t, Symbol> (map)
+                             : arrayChecksum<uint64_t, Symbol> (map)))
+            problem = "is damaged";
+    }
+    if (problem)
+    {
+        cout << "Index file " << indexFilename << ' ' << problem << ".\n";
+        fileUnmap (map, mapLength);
+        return NULL;
+    }
+
+    if (header->indexSize == sizeof(uint32_t))
+        return positionHeap<uint32_t, Symbol>::mapIndex (str, dna, length, 
+                                                         map, mapLength);
+    return positionHeap<uint64_t, Symbol>::mapIndex (str, dna, length, map, 
+                                                     mapLength);
+}
+
+// mapIndex:  the heap whose arrays are in 'map', which 'load' has checked
+template <class Index, class Symbol>
+basicHeap<Symbol> *positionHeap<Index, Symbol>::mapIndex(const Symbol *str, 
+                                                         const packedDna *dna,
+                                                         Index length, 
+                                                         char *map, 
+                                                         long mapLength)
+{
+    indexHeader *header = (indexHeader *) map;
+    positionHeap<Index, Symbol> *H = new positionHeap<Index, Symbol>();
+    H->textLength = length;
+    H->progress = NULL;
+    H->progressData = NULL;
+    H->memoryBudget = 0;
+    memset (&H->stats, 0, sizeof(H->stats));
+    H->text = str;
+    H->textEnd = str ? str + length - 1 : NULL;
+    H->dna = dna;
+    H->dnaEnd = length - 1;
+    H->parent = NULL;
+    H->nodeCapacity = length;
+    H->textBuffer = NULL;
+    H->textBufferLength = 0;
+    H->indexMap = map;
+    H->indexMapLength = mapLength;
+    H->downArray = (downNode<Index, Symbol> *) (map + header->downOffset);
+    H->maxReach = (Index *) (map + header->maxReachOffset);
+    H->discoveryTime = (Index *) (map + header->discoveryOffset);
+    H->finishingTime = (Index *) (map + header->finishingOffset);
+    H->dfsOrder = (Index *) (map + header->dfsOrderOffset);
+    H->labelBase = 0;
+    H->rangeIndex = NULL;
+    H->cache = NULL;
+    H->children = new childIndex<Index, Symbol>();
+    H->children->attach (header->childSizes, 
+                         (Index *) (map + header->hashNodesOffset),
+                         (Index *) (map + header->hashSlotsOffset),
+                         (childSlot<Index> *) (map + header->slotOffset),
+                         (Symbol *) (map + header->labelPoolOffset),
+                         (Index *) (map + header->childPoolOffset));
+    return H;
+}
+
+// private constructor for 'mapIndex', which fills in the fields itself
+template <class Index, class Symbol>
+positionHeap<Index, Symbol>::positionHeap()
 {
-    return textLength;
 }
 
+template class basicHeap<char>;
+template class basicHeap<uint16_t>;
+template class basicHeap<uint32_t>;
+template class positionHeap<uint32_t, char>;
+template class positionHeap<uint64_t, char>;
+template class positionHeap<uint32_t, uint16_t>;
+template class positionHeap<uint64_t, uint16_t>;
+template class positionHeap<uint32_t, uint32_t>;
+template class positionHeap<uint64_t, uint32_t>;
@@ -2,43 +2,363 @@
   heap.h:  see heap.cpp
  ************************/
 #include <math.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // Objects to represent the nodes of the position heap's tree.
-class downNode;  
+template <class Index, class Symbol> class downNode;
+template <class Index, class Symbol> class childIndex;
 class mylist;
+class queryContext;
+class occurrenceCursor;
+class packedDna;
+class waveletMatrix;
+class resultCache;
+template <class Symbol> class succinctHeap;
+template <class Index> struct pathWalk;
+template <class Index> struct matchWalk;
 const int ROOT = 0;
-const int NOCHILD = -1;  
-class heap
+const int CANDIDATE_BUFFER = 256;  // candidates 'count' keeps on the stack
+const int INTERLEAVED_SEARCHES = 16;  // searches searchBatch keeps going
+
+// Progress of a build:  'done' of the 'total' steps of 'phase' (one of
+//  PHASE_NAMES) are complete.  'data' is whatever the caller gave 'create'.
+typedef void (*progressCallback) (const char *phase, long long done,
+                                  long long total, void *data);
+const long long PROGRESS_INTERVAL = 1 << 20;  // positions between reports
+
+// The phases of a build, in order
+enum buildPhase {CONSTRUCT_PHASE, MAX_REACH_PHASE, CONVERT_PHASE, DFS_PHASE,
+                 PHASE_COUNT};
+extern const char *PHASE_NAMES[PHASE_COUNT];
+
+// What approximateSearch counts as an error:  a letter that differs from 
+//  the pattern's, or also a letter inserted or deleted
+enum errorModel {MISMATCHES, EDITS};
+
+// Which answers a heap's result cache (see setCache) gives up when it is
+//  full:  the least recently used, or those used least often lately
+enum cachePolicy : int {RECENCY_EVICTION, FREQUENCY_EVICTION};
+
+// What a heap's result cache has done since it was set up
+struct cacheStats
+{
+    long long hits, misses;    // searches answered from it, and not
+    long long insertions;      // answers added
+    long long evictions;       // answers given up to make room
+    long long entries;         // answers held now
+    long long bytes;           // memory they take
+};
+
+// What one phase of a build cost
+struct phaseStats
+{
+    double seconds;            // wall time
+    long long climbSteps;      // parent pointers followed
+    long long bytesAllocated;  // memory allocated for arrays
+};
+
+// What a build cost, as getBuildStats reports it.  Each child lookup 
+//  during construction is counted in scanHistogram[b] if it scanned a
+//  sibling list of s nodes, where b is 0 if s is 0 and otherwise s is 
+//  at least 2^(b-1) and less than 2^b (the last bucket takes all larger 
+//  s), or in indexedLookups if the childIndex answered it.
+const int SCAN_BUCKETS = 8;
+struct buildStats
+{
+    phaseStats phases[PHASE_COUNT];
+    long long scanHistogram[SCAN_BUCKETS];
+    long long indexedLookups;
+    long long maxDepth;        // depth of the deepest node
+    long long bytesAllocated;  // all phases together
+    long long peakBytes;       // most memory the heap held at once
+};
+
+// The bytes a heap takes, structure by structure, as memoryUsage reports
+//  them.  Arrays that are mapped from an index file are not the heap's 
+//  own memory; they are counted in 'mapped' and not in the others.
+struct heapMemory
+{
+    long long nodes;           // downArray
+    long long maxReach;
+    long long dfsTimes;        // discoveryTime and finishingTime
+    long long dfsOrder;
+    long long children;        // the childIndex
+    long long rangeIndex;      // the waveletMatrix over dfsOrder, if any
+    long long text;            // the heap's own copy of the text, if any
+    long long total;           // all of the above
+    long long mapped;          // the mapped index file
+};
+
+// The position heap of a text of letters of type Symbol:  char for text 
+//  or binary data, whose letters are bytes, or uint16_t or uint32_t for a 
+//  stream of tokens, such as a tokenizer's ids.  Lengths are always given,
+//  in letters, so a text may contain any letter, including '\0' and '\n'.
+//  Positions are reported as long longs, whatever the width of the index 
+//  underneath; 'create' and 'load' choose the width (see positionHeap 
+//  below).  A genome may be given as a packedDna instead of a string.
+template <class Symbol>
+class basicHeap
+{
+    friend class occurrenceCursor;
+    public:
+        static basicHeap *create(const Symbol *str, long long length,
+                                 progressCallback progress = NULL,
+                                 void *progressData = NULL,
+                                 long long memoryBudget = 0);
+        static basicHeap *create(const packedDna *dna,
+                                 progressCallback progress = NULL,
+                                 void *progressData = NULL,
+                                 long long memoryBudget = 0);
+        static basicHeap *load(const Symbol *str, long long length,
+                               const char *indexFilename, bool verify);
+        static basicHeap *load(const packedDna *dna, 
+                               const char *indexFilename, bool verify);
+        virtual ~basicHeap();
+        virtual void preorderPrint() const = 0;
+        virtual mylist *search(const Symbol *pattern,
+                               int patternLength) const = 0;
+        virtual long long search(const Symbol *pattern, int patternLength,
+                                 queryContext &context) const = 0;
+        virtual void searchBatch(const Symbol **patterns, 
+                                 const int *patternLengths, 
+                                 int patternCount, 
+                                 mylist **results) const = 0;
+        virtual void searchDictionary(const Symbol **patterns, 
+                                      const int *patternLengths, 
+                                      int patternCount, 
+                                      mylist **results) const = 0;
+        virtual long long count(const Symbol *pattern,
+                                int patternLength) const = 0;
+        virtual bool contains(const Symbol *pattern,
+                              int patternLength) const = 0;
+        virtual mylist *search(const Symbol *pattern, int patternLength,
+                               long long left, long long right) const = 0;
+        virtual mylist *approximateSearch(const Symbol *pattern,
+                                          int patternLength, int maxErrors,
+                                          errorModel model) const = 0;
+        virtual void matchingStatistics(const Symbol *query,
+                                        long long queryLength,
+                                        long long *lengths,
+                                        long long *positions) const = 0;
+        virtual void save(const char *indexFilename) = 0;
+        virtual void prepend(const Symbol *str, long long length) = 0;
+        virtual void deletePrefix(long long length) = 0;
+        virtual void deleteSuffix(long long length) = 0;
+        virtual void layOutSubtrees() = 0;
+        virtual void buildRangeIndex() = 0;
+        virtual long long getTextLength() const = 0;
+        virtual int getIndexSize() const = 0;
+        virtual const buildStats &getBuildStats() const = 0;
+        virtual heapMemory memoryUsage() const = 0;
+        virtual void findOccurrenceRanks(const Symbol *pattern,
+                                         int patternLength, mylist *others,
+                                         long long &firstRank,
+                                         long long &lastRank) const = 0;
+        virtual long long positionAtRank(long long rank) const = 0;
+        virtual void setCache(long long maxBytes, 
+                              cachePolicy policy = RECENCY_EVICTION) = 0;
+        virtual cacheStats getCacheStats() const = 0;
+    private:
+        static basicHeap *newHeap(const Symbol *str, const packedDna *dna,
+                                  long long length, progressCallback progress,
+                                  void *progressData, long long memoryBudget);
+        static basicHeap *loadIndex(const Symbol *str, const packedDna *dna,
+                                    long long length, 
+                                    const char *indexFilename, bool verify);
+        // for occurrenceCursor ...
+        virtual void openCursor(occurrenceCursor &cursor, 
+                                const Symbol *pattern,
+                                int patternLength) const = 0;
+        virtual void pushChildren(long long node, mylist *stack) const = 0;
+};
+
+typedef basicHeap<char> heap;          // the heap of a text of bytes
+typedef basicHeap<uint16_t> heap16;    // of 16-bit tokens
+typedef basicHeap<uint32_t> heap32;    // of 32-bit tokens
+
+// The position heap, with node ids, positions and DFS times of type Index,
+//  which is uint32_t or uint64_t.  A 32-bit heap takes half the space of a
+//  64-bit one, and serves texts of up to MAX_COMPACT_LENGTH letters.
+const long long MAX_COMPACT_LENGTH = 0xFFFFFFFELL;
+template <class Index, class Symbol = char>
+class positionHeap : public basicHeap<Symbol>
 {
+    friend class basicHeap<Symbol>;
+    friend class succinctHeap<Symbol>;
     public:
-        heap (char *str);
-        ~heap();
-        void preorderPrint();
-        mylist *search(char *pattern, int patternLength);
+        positionHeap (const Symbol *str, Index length, 
+                      progressCallback progress = NULL, 
+                      void *progressData = NULL, long long memoryBudget = 0);
+        positionHeap (const packedDna *dna, Index length,
+                      progressCallback progress = NULL, 
+                      void *progressData = NULL, long long memoryBudget = 0);
+        ~positionHeap();
+        void preorderPrint() const;
+        mylist *search(const Symbol *pattern, int patternLength) const;
+        long long search(const Symbol *pattern, int patternLength,
+                         queryContext &context) const;
+        void searchBatch(const Symbol **patterns, const int *patternLengths,
+                         int patternCount, mylist **results) const;
+        void searchDictionary(const Symbol **patterns, 
+                              const int *patternLengths, int patternCount,
+                              mylist **results) const;
+        long long count(const Symbol *pattern, int patternLength) const;
+        bool contains(const Symbol *pattern, int patternLength) const;
+        mylist *search(const Symbol *pattern, int patternLength,
+                       long long left, long long right) const;
+        mylist *approximateSearch(const Symbol *pattern, int patternLength,
+                                  int maxErrors, errorModel model) const;
+        void matchingStatistics(const Symbol *query, long long queryLength,
+                                long long *lengths, 
+                                long long *positions) const;
+        void save(const char *indexFilename);
+        void prepend(const Symbol *str, long long length);
+        void deletePrefix(long long length);
+        void deleteSuffix(long long length);
+        void layOutSubtrees();
+        void buildRangeIndex();
+        long long getTextLength() const;
+        int getIndexSize() const;
+        const buildStats &getBuildStats() const;
+        heapMemory memoryUsage() const;
+        static long long leastBuildMemory(long long length);
+        void findOccurrenceRanks(const Symbol *pattern, int patternLength,
+                                 mylist *others, long long &firstRank,
+                                 long long &lastRank) const;
+        long long positionAtRank(long long rank) const;
+        void setCache(long long maxBytes, 
+                      cachePolicy policy = RECENCY_EVICTION);
+        cacheStats getCacheStats() const;
     private:
-        int *parent;          // upwardly-directed tree for storing primal 
+        static const Index NOCHILD = (Index) -1;  // no child, sibling or node
+
+        positionHeap ();
+        char *indexMap;       // index file that the arrays below are mapped
+        long indexMapLength;  //   from, or NULL if the heap was built here
+        Index *parent;        // upwardly-directed tree for storing primal
                               //   position heap during construction
                               //   (set to NULL once constructed)
-	downNode *downArray;  // array of nodes of downwardly directed tree
-        int *maxReach;        // maximal-reach pointers 
-        int *discoveryTime;  // DFS discovery times of tree nodes
-        int *finishingTime;  // DFS finishing times of tree nodes
-	char *text;           // text string that the heap is constructed from
-	int textLength;       // number of characters in the text
-        int getTextLength();
+	downNode<Index, Symbol> *downArray;  // array of nodes of downwardly directed
+                                     //   tree
+        childIndex<Index, Symbol> *children; // children of nodes that have
+                                     //   many
+        Index *maxReach;      // maximal-reach pointers
+        Index *discoveryTime; // DFS discovery times of tree nodes
+        Index *finishingTime; // DFS finishing times of tree nodes
+        Index *dfsOrder;      // positions in DFS order, so the subtree of x
+                              //   is dfsOrder[discoveryTime[x] ..
+                              //   finishingTime[x]]; NULL once the heap
+                              //   is modified (see layOutSubtrees)
+        double labelBase;     // a block of 2^i DFS labels may hold 
+                              //   labelBase^i times; 0 until prepend
+                              //   first spreads them (see labelNewLeaf)
+        resultCache *cache;   // answers to recent searches, or NULL; see 
+                              //   setCache
+        waveletMatrix *rangeIndex;  // dfsOrder, for searches within a
+                              //   window of the text; built by
+                              //   buildRangeIndex, dropped with dfsOrder
+	const Symbol *text;   // text string that the heap is constructed from
+                              //   (not copied; owned by the caller unless
+                              //   it is in textBuffer)
+        Symbol *textBuffer;   // the heap's own copy of the text, right-
+        long long textBufferLength; //   aligned, once the text is modified
+        const Symbol *textEnd;  // rightmost letter of text, which is
+                              //   position 0; see letter()
+        const packedDna *dna; // the text, if it was given packed; then
+        long long dnaEnd;     //   text is NULL, and position 0 is letter
+                              //   dnaEnd of dna (owned by the caller)
+	Index textLength;     // number of letters in the text
+        Index nodeCapacity;   // number of nodes the arrays have room for
+        progressCallback progress;  // reports the progress of build, if
+        void *progressData;         //   not NULL
+        long long memoryBudget;  // bytes build may use, or 0 for no limit
+        buildStats stats;     // what the last build cost; see build()
+        Symbol letter(Index position) const;
+        void initialize(const Symbol *str, const packedDna *dna, 
+                        Index length, progressCallback progress, 
+                        void *progressData, long long memoryBudget);
+        void allocateArrays();
+        void freeArrays();
         void build();
-        mylist *genCandidates(char *pattern, int patternLength, int &pathEndDepth);
-        mylist *pruneCandidates(char *pattern, int patternLength, 
-                                mylist *candidates, int &offset);
-        int indexIntoTrie(char *pattern, int patternLength, int &endDepth);
-        void appendSubtreeOccurrences(int node, mylist *Occurrences);
+        Index countedChildOnLetter(Index node, Symbol c);
+        void reportProgress(buildPhase phase, Index done) const;
+        void endPhase(buildPhase phase, double &phaseStart, 
+                      long long bytesAllocated);
+        long long heldBytes(int indexArrays) const;
+        void findOccurrences(const Symbol *pattern, int patternLength,
+                             mylist *Occurrences) const;
+        void findOccurrences(const Symbol *pattern, int patternLength,
+                             Index pathEndNode, int pathEndDepth,
+                             mylist *Occurrences) const;
+        Index childToTry(Index node, Symbol c) const;
+        Index compactOccurrences(const Symbol *pattern, int patternLength,
+                                 mylist *others) const;
+        void mismatchSearch(const Symbol *pattern, int patternLength,
+                            int maxErrors, mylist *Occurrences) const;
+        bool mismatchesWithin(const Symbol *pattern, int patternLength,
+                              Index position, int depth, 
+                              int errorsLeft) const;
+        void editSearch(const Symbol *pattern, int patternLength,
+                        int maxErrors, mylist *Occurrences) const;
+        bool editsWithin(const Symbol *pattern, int patternLength,
+                         int maxErrors, Index position, int depth,
+                         const int *column, int *scratch) const;
+        void genCandidates(const Symbol *pattern, int patternLength,
+                           Index pathEndNode, int pathEndDepth,
+                           mylist *candidates) const;
+        int pruneCandidates(const Symbol *pattern, int patternLength,
+                            long long *candidates, int candidateCount,
+                            int &offset) const;
+        int keepCandidates(const Symbol *pattern, int patternLength,
+                           Index pathEndNode, int pathEndDepth,
+                           long long *candidates, int candidateCount,
+                           int &offset) const;
+        bool finishPath(pathWalk<Index> &walk, const Symbol *pattern,
+                        int patternLength, mylist *Occurrences) const;
+        int survivingCandidates(const Symbol *pattern, int patternLength,
+                             Index pathEndNode, int pathEndDepth,
+                             long long *candidates) const;
+        long long locate(const Symbol *pattern, int patternLength) const;
+        void extendMatch(matchWalk<Index> &walk, const Symbol *query,
+                         long long j) const;
+        void endWalk(matchWalk<Index> &walk, const Symbol *query) const;
+        long long nextOccurrence(matchWalk<Index> &walk, 
+                                 const Symbol *query) const;
+        int countPathOccurrences(const Symbol *pattern, 
+                                 Index pathEndNode) const;
+        long long subtreeCount(Index node) const;
+        Index indexIntoTrie(const Symbol *pattern, int patternLength,
+                            int &endDepth) const;
+        void appendSubtreeOccurrences(Index node, mylist *Occurrences) const;
         void installMaxReaches();
         void setDiscoveryFinishing();
-        void setDFAux (int index, int depth, int &i);
-        bool isDescendant(int node1, int node2);
-        mylist *pathOccurrences(char *pattern, int patternLength, 
-                               int pathEndNode);
-        int childOnLetter(int node, int depth, char c);  
-        void insertChild (int child, int parent); 
-        void preorderAux (int index, int depth);
+        bool isDescendant(Index node1, Index node2) const;
+        void pathOccurrences(const Symbol *pattern, Index pathEndNode,
+                             mylist *Occurrences) const;
+        void pathOccurrences(const Index *path, int depth,
+                             mylist *Occurrences) const;
+        Index childOnLetter(Index node, Symbol c) const;
+        void insertChild (Index child, Index parent, Symbol label);
+        void removeChild (Index child, Index parent);
+        void preorderAux (Index index, int depth) const;
+        void openCursor(occurrenceCursor &cursor, const Symbol *pattern,
+                        int patternLength) const;
+        void pushChildren(long long node, mylist *stack) const;
+        void addLeftmostPosition();
+        void deleteLeftmostPosition();
+        void labelNewLeaf(Index x, Index parent, mylist *path);
+        Index nextLabel(Index node) const;
+        void relabelForInsertion(Index x, Index parent, mylist *path);
+        long long blockEvents(Index top, Index low, Index high, Index x,
+                              Index parent, long long spread);
+        long long subtreeSize(Index node) const;
+        void makeWritable();
+        void dropLayout();
+        void reserveText(long long extra);
+        void reserveNodes(long long count);
+        static basicHeap<Symbol> *mapIndex(const Symbol *str, 
+                                           const packedDna *dna, 
+                                           Index length, char *map, 
+                                           long mapLength);
 };
@@ -4,11 +4,13 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "mylist.h"
 
 using std::cout;
 
-//  Implements a stack that only supports push.  The implementation is an
+//  Implements a stack that supports push (add) and pop (removeLast), and
+//  indexing into the elements that are on it.  The implementation is an
 //  array.  When the array fills up, it is reallocated to be twice is large.
 //  See Cormen, Leiserson, Rivest, Stein, Introduction to Algorithms, Chapter
 //  17 (Amortized Analysis) to see why this takes O(1) amortized time per
@@ -19,11 +21,14 @@ using std::cout;
 //  to the number of pushes since the last time it was reallocated.  The
 //  O(n) time to reallocate can be charged at O(1) apiece to those pushes, 
 //  which are never subsequently charge.
+//
+//  The elements are 64-bit, so that a list can hold positions of a text of
+//  any length (see heap.h).
 
 const int initSize = 4;
 mylist::mylist()
 {
-    arrayPtr = new int[initSize];
+    arrayPtr = new long long[initSize];
     arraySize = initSize;
     currentIndex = -1;
 }
@@ -33,7 +38,7 @@ mylist::~mylist()
     delete[] arrayPtr;
 }
 
-int mylist::getElement(int index)
+long long mylist::getElement(long long index)
 {
     if (index < 0 || index >= size())
        {cout << "mylist:  attempt to index outside of list\n"; exit(1);}
@@ -41,14 +46,14 @@ int mylist::getElement(int index)
        return arrayPtr[index];
 }
 
-void mylist::setElement(int index, int value)
+void mylist::setElement(long long index, long long value)
 {
     if (index < 0 || index >= size())
        {cout << "mylist:  attempt to index outside of list\n"; exit(1);}
     else arrayPtr[index] = value;
 }
 
-void mylist::add (int element)
+void mylist::add (long long element)
 {
     currentIndex++;
     if (currentIndex == arraySize)
@@ -56,41 +61,85 @@ void mylist::add (int element)
     arrayPtr[currentIndex] = element;	
 }
 
-int mylist::size()
+// extend:  add 'count' elements at the end, and return a pointer to the
+//  first of them, for the caller to fill in
+long long *mylist::extend (long long count)
+{
+    long long newSize = arraySize > 0 ? arraySize : initSize;  // 0 after compact
+    while (newSize < currentIndex + 1 + count)
+        newSize *= 2;
+    if (newSize != arraySize)
+    {
+        long long *newPtr = new long long[newSize];
+        if (newPtr == NULL) { cout<<"Error (re)allocating memory in mylist"; exit(1); }
+        memcpy (newPtr, arrayPtr, (currentIndex + 1) * sizeof(long long));
+        delete [] arrayPtr;
+        arrayPtr = newPtr;
+        arraySize = newSize;
+    }
+    long long *added = arrayPtr + currentIndex + 1;
+    currentIndex += count;
+    return added;
+}
+
+long long mylist::removeLast ()
+{
+    if (currentIndex < 0)
+       {cout << "mylist:  attempt to remove from an empty list\n"; exit(1);}
+    return arrayPtr[currentIndex--];
+}
+
+long long mylist::size()
 {
    return currentIndex + 1;
 }
 
+// getArray:  the array holding the elements, for a caller that reads or 
+//  rearranges them in place; it moves when the list grows
+long long *mylist::getArray()
+{
+   return arrayPtr;
+}
+
+// truncate:  keep only the first 'newSize' elements
+void mylist::truncate(long long newSize)
+{
+    if (newSize < 0 || newSize > size())
+       {cout << "mylist:  attempt to truncate to an invalid size\n"; exit(1);}
+    currentIndex = newSize - 1;
+}
+
+// clear:  remove all of the elements, keeping the space for reuse
+void mylist::clear()
+{
+    currentIndex = -1;
+}
+
 void mylist::memReAlloc ()
 {
-    int *newPtr = new int[2*arraySize];
+    long long newSize = arraySize > 0 ? 2*arraySize : initSize;  // 0 after compact
+    long long *newPtr = new long long[newSize];
     if (newPtr == NULL) { cout<<"Error (re)allocating memory in mylist"; exit(1); }
-    int *p1 = arrayPtr;
-    int *p2 = newPtr;
-    for (int i = 0; i < arraySize; i++)
-        *p2++ = *p1++;
+    memcpy (newPtr, arrayPtr, arraySize * sizeof(long long));
     delete [] arrayPtr;
     arrayPtr = newPtr;
-    arraySize *= 2;
+    arraySize = newSize;
 }
 
 /* Get rid of extra buffer space at end of the array  */
 void mylist::compact()
 {
     arraySize = currentIndex+1;
-    int *newPtr = new int[arraySize];
+    long long *newPtr = new long long[arraySize];
     if (newPtr == NULL) { cout<<"Error (re)allocating memory in mylist"; exit(1); }
-    int *p1 = arrayPtr;
-    int *p2 = newPtr;
-    for (int i = 0; i < arraySize; i++)
-        *p2++ = *p1++;
+    memcpy (newPtr, arrayPtr, arraySize * sizeof(long long));
     delete [] arrayPtr;
     arrayPtr = newPtr;
 }
 
 void mylist::print ()
 {
-   for (int i=0; i <= currentIndex; i++)
+   for (long long i=0; i <= currentIndex; i++)
        cout << arrayPtr[i] << ' ';
    cout << '\n';
 }
@@ -7,15 +7,20 @@ class mylist
 	mylist ();
         mylist (int initialSize);
 	~mylist ();
-        int getElement(int index);
-        void setElement(int index, int value);
-	void add (int element);
-        int size();              // number of elements in array
+        long long getElement(long long index);
+        void setElement(long long index, long long value);
+	void add (long long element);
+        long long *extend (long long count);
+        long long removeLast ();
+        long long size();        // number of elements in array
+        long long *getArray();   // the elements themselves
+        void truncate(long long newSize);
+        void clear();
 	void print();
         void compact();
     private:
-	int* arrayPtr;     // array for storing elements of array
-	int arraySize;     // currently allocated size of array
-	int currentIndex;  // index of most recently added element
+	long long* arrayPtr;    // array for storing elements of array
+	long long arraySize;    // currently allocated size of array
+	long long currentIndex; // index of most recently added element
 	void memReAlloc ();  // reallocates array to be twice as large
 };
@@ -0,0 +1,88 @@
+/****************************
+ * occurrenceCursor.cpp:  reports the occurrences of a pattern in a 
+ * position heap one at a time, as the caller asks for them
+ * **************************/
+#include <iostream>
+#include "occurrenceCursor.h"
+#include "heap.h"
+#include "mylist.h"
+
+//  heap::search finds every occurrence before it returns, so a caller that
+//  wants only the first few pays for all of them.  A cursor does the O(m)
+//  part of the search when it is created:  it finds the occurrences among
+//  the ancestors of the end of the indexing path, or, if the pattern falls
+//  off the tree, all of the occurrences, since there are at most m of them
+//  (see heap::search).  The rest are the nodes of one subtree, and the
+//  cursor reports them as it is asked for them, either from the subtree's
+//  slice of the heap's dfsOrder or, if the heap has been modified since it
+//  was laid out, by walking the subtree.  Getting the first page of 
+//  positions therefore takes O(m + page size) time, however many there are
+//  in all.  The heap does the parts of this that depend on its index width;
+//  see positionHeap::openCursor.
+//
+//  The heap must not be modified while a cursor on it is in use.
+
+/****************************
+ * occurrenceCursor:  prepare to report the positions of 'pattern', whose
+ * length is 'patternLength', in 'H'; report no more than 'limit' of them,
+ * unless 'limit' is 0 or less.  The pattern is not used after this 
+ * returns.
+ * **************************/
+occurrenceCursor::occurrenceCursor(const heap *H, const char *pattern, 
+                                   int patternLength, int limit)
+{
+    this->H = H;
+    this->limit = limit;
+    reported = 0;
+    pathIndex = 0;
+    nextRank = 0;
+    lastRank = -1;
+    stack = NULL;
+    H->openCursor (*this, pattern, patternLength);
+}
+
+occurrenceCursor::~occurrenceCursor()
+{
+    delete pathHits;
+    delete stack;
+}
+
+/****************************
+ * next:  set 'position' to the next occurrence and return true, or return
+ * false if all of them, or 'limit' of them, have been reported.
+ * **************************/
+bool occurrenceCursor::next(long long &position)
+{
+    if (limit > 0 && reported == limit)
+        return false;
+    if (pathIndex < pathHits->size())
+        position = pathHits->getElement(pathIndex++);
+    else if (nextRank <= lastRank)
+        position = H->positionAtRank(nextRank++);
+    else if (stack && stack->size() > 0)
+    {
+        position = stack->removeLast();
+        H->pushChildren(position, stack);
+    }
+    else return false;
+    reported++;
+    return true;
+}
+
+/****************************
+ * fetch:  put up to 'count' of the next occurrences in 'positions', and 
+ * return how many there were; fewer than 'count' means there are no more.
+ * **************************/
+int occurrenceCursor::fetch(long long *positions, int count)
+{
+    int fetched = 0;
+    while (fetched < count && next (positions[fetched]))
+        fetched++;
+    return fetched;
+}
+
+// getReported:  the number of occurrences reported so far
+int occurrenceCursor::getReported() const
+{
+    return reported;
+}
@@ -0,0 +1,29 @@
+/*************************
+  occurrenceCursor.h:  see occurrenceCursor.cpp
+ ************************/
+template <class Symbol> class basicHeap;
+typedef basicHeap<char> heap;
+class mylist;
+class occurrenceCursor
+{
+    template <class Index, class Symbol> friend class positionHeap;  // see openCursor
+    public:
+        occurrenceCursor (const heap *H, const char *pattern, 
+                          int patternLength, int limit);
+        ~occurrenceCursor ();
+        bool next (long long &position);
+        int fetch (long long *positions, int count);
+        int getReported () const;
+    private:
+        const heap *H;
+        int limit;             // most positions to report; 0 for no limit
+        int reported;          // positions reported so far
+        mylist *pathHits;      // occurrences that are not in the subtree
+        long long pathIndex;   //   and the next one to report
+        long long subtreeRoot; // root of the subtree of occurrences, or
+                               //   -1 if the pattern fell off the tree
+        long long nextRank;    // next rank to report in H's dfsOrder, ...
+        long long lastRank;    //   through this one
+        mylist *stack;         // ... or, if H is not laid out, the nodes
+                               //   of the subtree still to be reported
+};
@@ -0,0 +1,227 @@
+/****************************
+ * packedDna.cpp:  a DNA text stored in two bits per base, for building and
+ * searching the position heap of a genome without a byte per base
+ * **************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "packedDna.h"
+using std::cout;
+
+//  A reference genome is almost all A, C, G and T, so each letter is kept
+//  as a two-bit code, four to a byte, which is a quarter of the space of
+//  the text.  The rest are kept as exceptions:  runs of N, the other IUPAC
+//  ambiguity codes, and anything else at all, are each recorded as a run
+//  of one letter, with the code under them left as A.  Soft-masked
+//  (lower-case) stretches are recorded as runs of their own, so a masked
+//  region costs one run rather than one exception per letter.  The letters
+//  come back exactly as they were given.
+//
+//  Finding whether a letter is in a run is a binary search among the runs
+//  that overlap its block of RUN_BLOCK letters, which are listed for each
+//  block, so it is O(1) for a genome, whose runs are long and few.  A heap
+//  built over a packedDna (see heap::create) reads its letters from here,
+//  and the caller need not keep the text of bytes at all.
+
+const int RUN_BLOCK_BITS = 16;               // letters per block, as a
+const long long RUN_BLOCK = 1LL << RUN_BLOCK_BITS;  //   power of two
+const char BASE_LETTERS[4] = {'A', 'C', 'G', 'T'};
+
+// baseCode:  the two-bit code of 'c', or -1 if it is not A, C, G or T
+static inline int baseCode(char c)
+{
+    switch (c)
+    {
+        case 'A':  return 0;
+        case 'C':  return 1;
+        case 'G':  return 2;
+        case 'T':  return 3;
+        default:   return -1;
+    }
+}
+
+/****************************
+ * packedDna:  pack the 'length' letters at 'str', which need not be kept
+ * afterwards.
+ * **************************/
+packedDna::packedDna(const char *str, long long length)
+{
+    this->length = length;
+    bases = new unsigned char[length / 4 + 1];
+    if (!bases)
+       {cout << "Memory allocation failure in packedDna\n"; exit(1);}
+    memset (bases, 0, length / 4 + 1);
+    memset (&exceptions, 0, sizeof(exceptions));
+    memset (&lowerCase, 0, sizeof(lowerCase));
+    exceptionLetter = NULL;
+
+    long long exceptionCapacity = 0, lowerCapacity = 0;
+    long long lowerStart = -1;   // start of the current lower-case run
+    for (long long i = 0; i < length; i++)
+    {
+        char c = str[i];
+        if (islower ((unsigned char) c))
+        {
+            if (lowerStart < 0) lowerStart = i;
+            c = toupper ((unsigned char) c);
+        }
+        else if (lowerStart >= 0)
+        {
+            addRun (lowerCase, lowerCapacity, lowerStart, i);
+            lowerStart = -1;
+        }
+
+        int code = baseCode (c);
+        if (code >= 0)
+            bases[i / 4] |= code << (2 * (i % 4));
+        else if (exceptions.count > 0 
+                     && exceptions.end[exceptions.count - 1] == i
+                     && exceptionLetter[exceptions.count - 1] == c)
+            exceptions.end[exceptions.count - 1]++;   // the run goes on
+        else
+        {
+            long long oldCapacity = exceptionCapacity;
+            addRun (exceptions, exceptionCapacity, i, i + 1);
+            if (exceptionCapacity != oldCapacity)
+            {
+                char *newLetters = new char[exceptionCapacity];
+                if (!newLetters)
+                {
+                    cout << "Memory allocation failure in packedDna\n";
+                    exit(1);
+                }
+                if (exceptions.count > 1)   // none to copy the first time
+                    memcpy (newLetters, exceptionLetter, 
+                            exceptions.count - 1);
+                delete []exceptionLetter;
+                exceptionLetter = newLetters;
+            }
+            exceptionLetter[exceptions.count - 1] = c;
+        }
+    }
+    if (lowerStart >= 0)
+        addRun (lowerCase, lowerCapacity, lowerStart, length);
+    finishRuns (exceptions);
+    finishRuns (lowerCase);
+}
+
+packedDna::~packedDna()
+{
+    delete []bases;
+    delete []exceptions.start;
+    delete []exceptions.end;
+    delete []exceptions.blockFirst;
+    delete []exceptionLetter;
+    delete []lowerCase.start;
+    delete []lowerCase.end;
+    delete []lowerCase.blockFirst;
+}
+
+// addRun:  add the run [start, end) to 'runs', which have room for
+//  'capacity'; they are doubled if they are full
+void packedDna::addRun(letterRuns &runs, long long &capacity, long long start,
+                       long long end)
+{
+    if (runs.count == capacity)
+    {
+        capacity = capacity ? 2 * capacity : 64;
+        long long *newStart = new long long[capacity];
+        long long *newEnd = new long long[capacity];
+        if (!newStart || !newEnd)
+           {cout << "Memory allocation failure in packedDna\n"; exit(1);}
+        for (long long r = 0; r < runs.count; r++)
+        {
+            newStart[r] = runs.start[r];
+            newEnd[r] = runs.end[r];
+        }
+        delete []runs.start;
+        delete []runs.end;
+        runs.start = newStart;
+        runs.end = newEnd;
+    }
+    runs.start[runs.count] = start;
+    runs.end[runs.count] = end;
+    runs.count++;
+}
+
+// finishRuns:  list the first run that ends after the start of each block
+void packedDna::finishRuns(letterRuns &runs)
+{
+    long long blocks = (length >> RUN_BLOCK_BITS) + 2;
+    runs.blockFirst = new long long[blocks];
+    if (!runs.blockFirst)
+       {cout << "Memory allocation failure in packedDna\n"; exit(1);}
+    long long r = 0;
+    for (long long b = 0; b < blocks; b++)
+    {
+        while (r < runs.count && runs.end[r] <= b * RUN_BLOCK)
+            r++;
+        runs.blockFirst[b] = r;
+    }
+}
+
+// findRun:  the run that contains 'index', or -1 if none does.  Only the
+//  runs from the first that ends after the start of its block to the first
+//  that ends after the start of the next can contain it.
+long long packedDna::findRun(const letterRuns &runs, long long index) const
+{
+    long long block = index >> RUN_BLOCK_BITS;
+    long long low = runs.blockFirst[block];
+    long long high = runs.blockFirst[block + 1];
+    if (high == runs.count) high--;
+    if (low > high) return -1;
+    while (low < high)    // the first run in [low, high] that ends after it
+    {
+        long long middle = (low + high) / 2;
+        if (runs.end[middle] <= index)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (runs.start[low] <= index && index < runs.end[low])
+        return low;
+    return -1;
+}
+
+/****************************
+ * letter:  the letter at 'index', counted from the left.
+ * **************************/
+char packedDna::letter(long long index) const
+{
+    char c = BASE_LETTERS[(bases[index / 4] >> (2 * (index % 4))) & 3];
+    if (exceptions.count > 0)
+    {
+        long long run = findRun (exceptions, index);
+        if (run >= 0) c = exceptionLetter[run];
+    }
+    if (lowerCase.count > 0 && findRun (lowerCase, index) >= 0)
+        c = tolower ((unsigned char) c);
+    return c;
+}
+
+char packedDna::operator[](long long index) const
+{
+    return letter (index);
+}
+
+long long packedDna::getLength() const
+{
+    return length;
+}
+
+// getExceptionCount:  the number of runs of letters other than A, C, G, T
+long long packedDna::getExceptionCount() const
+{
+    return exceptions.count;
+}
+
+// memoryUsage:  bytes taken by the packed letters and the runs
+long long packedDna::memoryUsage() const
+{
+    long long blocks = (length >> RUN_BLOCK_BITS) + 2;
+    return length / 4 + 1
+           + exceptions.count * (2 * sizeof(long long) + 1)
+           + lowerCase.count * 2 * sizeof(long long)
+           + 2 * blocks * sizeof(long long);
+}
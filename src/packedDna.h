@@ -0,0 +1,36 @@
+/*************************
+  packedDna.h:  see packedDna.cpp
+ ************************/
+
+// Stretches of a text that are not stored as bases, such as runs of N
+struct letterRuns
+{
+    long long count;
+    long long *start;        // first letter of each run, in order ...
+    long long *end;          //   and one past its last
+    long long *blockFirst;   // first run that ends after the start of
+                             //   each block of RUN_BLOCK letters
+};
+
+class packedDna
+{
+    public:
+        packedDna (const char *str, long long length);
+        ~packedDna ();
+        char letter (long long index) const;
+        char operator[] (long long index) const;
+        long long getLength () const;
+        long long getExceptionCount () const;
+        long long memoryUsage () const;
+    private:
+        unsigned char *bases;    // 2 bits per letter, 4 letters per byte
+        long long length;        // number of letters
+        letterRuns exceptions;   // letters other than A, C, G and T ...
+        char *exceptionLetter;   //   and the (upper-case) letter of each
+        letterRuns lowerCase;    // stretches of lower-case letters
+
+        void addRun (letterRuns &runs, long long &capacity, long long start,
+                     long long end);
+        void finishRuns (letterRuns &runs);
+        long long findRun (const letterRuns &runs, long long index) const;
+};
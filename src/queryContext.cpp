@@ -0,0 +1,42 @@
+/****************************
+ * queryContext.cpp:  space for the results of searches, reused from one
+ * search to the next
+ * **************************/
+#include "queryContext.h"
+#include "mylist.h"
+
+//  heap::search(pattern, patternLength) allocates a new list for every
+//  search, and the caller deletes it.  A program that searches at a high
+//  rate, especially from several threads at once, spends much of its time
+//  in the memory allocator doing this.  Instead, it can create one 
+//  queryContext per thread and pass it to heap::search(pattern, 
+//  patternLength, context), which leaves the positions in the context's
+//  list.  The list is cleared, not freed, before each search, so once it
+//  has grown to the size of the largest result, searching allocates no 
+//  memory.  The candidates of a pattern that falls off the tree are pruned
+//  in place in the same list.
+//
+//  The positions are valid until the next search with the same context.
+//  A context must not be used by two threads at once.
+
+queryContext::queryContext()
+{
+    occurrences = new mylist();
+}
+
+queryContext::~queryContext()
+{
+    delete occurrences;
+}
+
+// size:  the number of positions found by the last search
+long long queryContext::size() const
+{
+    return occurrences->size();
+}
+
+// getOccurrences:  the positions found by the last search
+const long long *queryContext::getOccurrences() const
+{
+    return occurrences->getArray();
+}
@@ -0,0 +1,16 @@
+/*************************
+  queryContext.h:  see queryContext.cpp
+ ************************/
+class mylist;
+class queryContext
+{
+    template <class Index, class Symbol> friend class positionHeap;
+    template <class Symbol> friend class succinctHeap;
+    public:
+        queryContext ();
+        ~queryContext ();
+        long long size () const;
+        const long long *getOccurrences () const;
+    private:
+        mylist *occurrences;   // positions found by the last search
+};
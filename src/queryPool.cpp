@@ -0,0 +1,118 @@
+/****************************
+ * queryPool.cpp:  searches one position heap for a batch of patterns
+ * on several threads at once
+ * **************************/
+#include <iostream>
+#include "queryPool.h"
+#include "heap.h"
+#include "mylist.h"
+
+//  heap::search only reads the heap, so the threads share a single heap
+//  without any locking.  The threads are started once, when the pool is
+//  created, and wait between batches.  Within a batch, each thread takes
+//  the next few unsearched patterns from a shared counter, so a thread 
+//  that draws a pattern with many occurrences does not hold up the others,
+//  and searches them together with heap::searchBatch, which overlaps their
+//  cache misses.
+//  The thread that calls searchBatch searches along with the workers.
+
+/****************************
+ * queryPool:  create a pool of 'threadCount' threads, counting the
+ * caller's, for searching 'H'.  If 'threadCount' is 0 or less, use one
+ * thread per core.
+ * **************************/
+queryPool::queryPool(const heap *H, int threadCount)
+{
+    this->H = H;
+    generation = 0;
+    busyWorkers = 0;
+    stopping = false;
+    patterns = NULL;
+    patternLengths = NULL;
+    patternCount = 0;
+    results = NULL;
+    nextPattern = 0;
+
+    if (threadCount <= 0)
+        threadCount = std::thread::hardware_concurrency();
+    for (int i = 1; i < threadCount; i++)
+        workers.push_back(std::thread(&queryPool::workerLoop, this));
+}
+
+queryPool::~queryPool()
+{
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (unsigned i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+int queryPool::getThreadCount() const
+{
+    return workers.size() + 1;
+}
+
+/****************************
+ * searchBatch:  search for each of the 'patternCount' patterns, setting
+ * results[i] to the list heap::search returns for patterns[i], whose
+ * length is patternLengths[i].  As with heap::search, the caller must
+ * delete the lists.  Returns when all of the patterns have been searched.
+ * **************************/
+void queryPool::searchBatch(const char **patterns, const int *patternLengths,
+                            int patternCount, mylist **results)
+{
+    std::unique_lock<std::mutex> batchGuard(batchLock);
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        this->patterns = patterns;
+        this->patternLengths = patternLengths;
+        this->patternCount = patternCount;
+        this->results = results;
+        nextPattern = 0;
+        busyWorkers = workers.size();
+        generation++;
+    }
+    wakeWorkers.notify_all();
+
+    runBatch();
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (busyWorkers > 0)
+        batchDone.wait(guard);
+}
+
+void queryPool::workerLoop()
+{
+    long seen = 0;  // last batch this worker has worked on
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        while (!stopping && generation == seen)
+            wakeWorkers.wait(guard);
+        if (stopping) return;
+        seen = generation;
+
+        guard.unlock();
+        runBatch();
+        guard.lock();
+
+        if (--busyWorkers == 0)
+            batchDone.notify_all();
+    }
+}
+
+// search for patterns until there are none left in the batch
+void queryPool::runBatch()
+{
+    int first;
+    while ((first = nextPattern.fetch_add(POOL_CHUNK)) < patternCount)
+    {
+        int count = patternCount - first;
+        if (count > POOL_CHUNK) count = POOL_CHUNK;
+        H->searchBatch(patterns + first, patternLengths + first, count,
+                       results + first);
+    }
+}
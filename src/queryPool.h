@@ -0,0 +1,43 @@
+/*************************
+  queryPool.h:  see queryPool.cpp
+ ************************/
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+template <class Symbol> class basicHeap;
+typedef basicHeap<char> heap;
+class mylist;
+class queryPool
+{
+    public:
+        queryPool (const heap *H, int threadCount);
+        ~queryPool ();
+        void searchBatch (const char **patterns, const int *patternLengths,
+                          int patternCount, mylist **results);
+        int getThreadCount () const;
+    private:
+        static const int POOL_CHUNK = 64;   // patterns a thread takes at once
+        const heap *H;                      // heap shared by all threads
+        std::vector<std::thread> workers;   // threads other than the caller's
+
+        std::mutex batchLock;      // lets one searchBatch run at a time
+        std::mutex lock;           // protects the fields below
+        std::condition_variable wakeWorkers;
+        std::condition_variable batchDone;
+        long generation;           // number of batches started so far
+        int busyWorkers;           // workers still working on this batch
+        bool stopping;             // set when the pool is being destroyed
+
+        // the batch being worked on ...
+        const char **patterns;
+        const int *patternLengths;
+        int patternCount;
+        mylist **results;
+        std::atomic<int> nextPattern;  // index of next pattern to search for
+
+        void workerLoop ();
+        void runBatch ();
+};
@@ -0,0 +1,207 @@
+/****************************
+ * resultCache.cpp:  answers to recent searches of a heap, for query logs
+ * in which a few patterns make up most of the traffic
+ * **************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "heap.h"
+#include "mylist.h"
+#include "resultCache.h"
+using std::cout;
+
+//  A heap caches the answer to a search in the form the search finds it
+//  in before it lists the subtree (see heap::setCache):  the node whose
+//  subtree holds the occurrences that lie together, and the at most m
+//  others.  So an answer takes O(m) space however many occurrences the
+//  pattern has, and a frequent pattern with millions of them costs no more
+//  to keep than a rare one.
+//
+//  The answers are spread over SHARDS shards by a hash of the pattern, and
+//  each shard has its own lock, so threads that search at once seldom
+//  wait for one another.  Each shard keeps its answers in a list from the
+//  newest to the oldest, and gets an equal share of the budget; when an
+//  answer does not fit, answers are taken from the old end of the list
+//  until it does:
+//
+//    - RECENCY_EVICTION moves an answer to the new end whenever it is
+//      used, so the least recently used goes first.
+//    - FREQUENCY_EVICTION instead counts the uses of each answer, up to
+//      MAX_USES, and leaves it where it is.  An answer at the old end
+//      that has uses left gives one up and goes back to the new end (the
+//      "generalized clock").  A burst of patterns that are searched once
+//      then passes through the cache without pushing out the patterns that
+//      are searched all the time.
+
+const int MAX_USES = 7;
+const long long ENTRY_OVERHEAD = 64;  // the map's node and bucket, roughly
+
+resultCache::resultCache(long long maxBytes, cachePolicy policy)
+{
+    shardBytes = maxBytes / SHARDS;
+    this->policy = policy;
+    for (int s = 0; s < SHARDS; s++)
+    {
+        shards[s].newest = shards[s].oldest = NULL;
+        shards[s].bytes = 0;
+        shards[s].hits = shards[s].misses = 0;
+        shards[s].insertions = shards[s].evictions = 0;
+    }
+}
+
+resultCache::~resultCache()
+{
+    clear();
+}
+
+// shardOf:  the shard that holds 'key', by its FNV-1a hash
+resultCache::cacheShard &resultCache::shardOf(const std::string &key)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < key.size(); i++)
+        hash = (hash ^ (unsigned char) key[i]) * 1099511628211ULL;
+    return shards[hash % SHARDS];
+}
+
+/****************************
+ * lookup:  if the answer for the 'keyBytes' bytes at 'key' is cached,
+ * give its subtree node and number of other positions, add the positions
+ * to 'positions' unless it is NULL, and return true
+ * **************************/
+bool resultCache::lookup(const void *key, int keyBytes,
+                         long long &subtreeNode, long long &positionCount,
+                         mylist *positions)
+{
+    std::string name ((const char *) key, keyBytes);
+    cacheShard &shard = shardOf (name);
+    std::lock_guard<std::mutex> guard (shard.lock);
+    std::unordered_map<std::string, cacheEntry *>::iterator found
+        = shard.entries.find (name);
+    if (found == shard.entries.end())
+    {
+        shard.misses++;
+        return false;
+    }
+    cacheEntry *entry = found->second;
+    shard.hits++;
+    if (policy == RECENCY_EVICTION)
+    {
+        unlink (shard, entry);
+        pushNewest (shard, entry);
+    }
+    else if (entry->uses < MAX_USES)
+        entry->uses++;
+    subtreeNode = entry->subtreeNode;
+    positionCount = entry->positionCount;
+    if (positions)
+        memcpy (positions->extend (positionCount), entry->positions,
+                positionCount * sizeof(long long));
+    return true;
+}
+
+/****************************
+ * insert:  cache an answer for the 'keyBytes' bytes at 'key', unless one
+ * is cached already or it is larger than a shard's share of the budget
+ * **************************/
+void resultCache::insert(const void *key, int keyBytes, long long subtreeNode,
+                         const long long *positions, long long positionCount)
+{
+    std::string name ((const char *) key, keyBytes);
+    long long bytes = sizeof(cacheEntry) + ENTRY_OVERHEAD + 2 * keyBytes
+                      + positionCount * sizeof(long long);
+    if (bytes > shardBytes) return;
+    cacheShard &shard = shardOf (name);
+    std::lock_guard<std::mutex> guard (shard.lock);
+    if (shard.entries.count (name) > 0) return;   // another thread's
+    while (shard.bytes + bytes > shardBytes)
+        evictOne (shard);
+
+    cacheEntry *entry = new cacheEntry;
+    entry->key = name;
+    entry->subtreeNode = subtreeNode;
+    entry->positions = new long long[positionCount];
+    memcpy (entry->positions, positions, positionCount * sizeof(long long));
+    entry->positionCount = positionCount;
+    entry->bytes = bytes;
+    entry->uses = 0;
+    pushNewest (shard, entry);
+    shard.entries[name] = entry;
+    shard.bytes += bytes;
+    shard.insertions++;
+}
+
+// evictOne:  give up one answer from the old end of 'shard'; see above
+void resultCache::evictOne(cacheShard &shard)
+{
+    cacheEntry *entry = shard.oldest;
+    while (policy == FREQUENCY_EVICTION && entry->uses > 0)
+    {
+        entry->uses--;
+        unlink (shard, entry);
+        pushNewest (shard, entry);
+        entry = shard.oldest;
+    }
+    unlink (shard, entry);
+    shard.entries.erase (entry->key);
+    shard.bytes -= entry->bytes;
+    shard.evictions++;
+    delete []entry->positions;
+    delete entry;
+}
+
+// unlink:  take 'entry' out of the recency list of 'shard'
+void resultCache::unlink(cacheShard &shard, cacheEntry *entry)
+{
+    if (entry->newer) entry->newer->older = entry->older;
+    else shard.newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else shard.oldest = entry->newer;
+}
+
+// pushNewest:  put 'entry' at the new end of the recency list of 'shard'
+void resultCache::pushNewest(cacheShard &shard, cacheEntry *entry)
+{
+    entry->newer = NULL;
+    entry->older = shard.newest;
+    if (shard.newest) shard.newest->newer = entry;
+    else shard.oldest = entry;
+    shard.newest = entry;
+}
+
+// clear:  give up every answer, as when the heap changes; the counts of
+//  hits and misses are kept
+void resultCache::clear()
+{
+    for (int s = 0; s < SHARDS; s++)
+    {
+        cacheShard &shard = shards[s];
+        std::lock_guard<std::mutex> guard (shard.lock);
+        for (cacheEntry *entry = shard.newest; entry; )
+        {
+            cacheEntry *older = entry->older;
+            delete []entry->positions;
+            delete entry;
+            entry = older;
+        }
+        shard.entries.clear();
+        shard.newest = shard.oldest = NULL;
+        shard.bytes = 0;
+    }
+}
+
+// addStats:  add the counts of every shard to 'stats'
+void resultCache::addStats(cacheStats &stats)
+{
+    for (int s = 0; s < SHARDS; s++)
+    {
+        cacheShard &shard = shards[s];
+        std::lock_guard<std::mutex> guard (shard.lock);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.insertions += shard.insertions;
+        stats.evictions += shard.evictions;
+        stats.entries += shard.entries.size();
+        stats.bytes += shard.bytes;
+    }
+}
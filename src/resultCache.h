@@ -0,0 +1,56 @@
+/*************************
+  resultCache.h:  see resultCache.cpp
+ ************************/
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class mylist;
+struct cacheStats;
+enum cachePolicy : int;
+
+// One cached answer:  the positions of a pattern that are not in the
+//  subtree of 'subtreeNode', and that subtree, if any
+struct cacheEntry
+{
+    std::string key;           // the pattern's bytes
+    long long subtreeNode;     // -1 if the pattern falls off the tree
+    long long *positions;
+    long long positionCount;
+    long long bytes;           // what the entry is charged
+    int uses;                  // hits not yet forgiven by the clock
+    cacheEntry *newer, *older; // recency list of its shard
+};
+
+// A cache of search answers keyed on the pattern's bytes, with a budget
+//  of memory, that many threads may use at once
+class resultCache
+{
+    public:
+        resultCache (long long maxBytes, cachePolicy policy);
+        ~resultCache ();
+        bool lookup (const void *key, int keyBytes, long long &subtreeNode,
+                     long long &positionCount, mylist *positions);
+        void insert (const void *key, int keyBytes, long long subtreeNode,
+                     const long long *positions, long long positionCount);
+        void clear ();
+        void addStats (cacheStats &stats);
+    private:
+        static const int SHARDS = 16;  // each with its own lock
+        struct cacheShard
+        {
+            std::mutex lock;           // protects the fields below
+            std::unordered_map<std::string, cacheEntry *> entries;
+            cacheEntry *newest, *oldest;
+            long long bytes;
+            long long hits, misses, insertions, evictions;
+        };
+        cacheShard shards[SHARDS];
+        long long shardBytes;          // the budget of each shard
+        cachePolicy policy;
+
+        cacheShard &shardOf (const std::string &key);
+        void unlink (cacheShard &shard, cacheEntry *entry);
+        void pushNewest (cacheShard &shard, cacheEntry *entry);
+        void evictOne (cacheShard &shard);
+};
@@ -0,0 +1,232 @@
+/****************************
+ * shardedHeap.cpp:  a position heap for a text too large to build in one
+ * piece on one core, made of heaps for overlapping pieces of the text
+ * that are built on several threads at once
+ * **************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "shardedHeap.h"
+#include "heap.h"
+#include "mylist.h"
+#include "queryContext.h"
+using std::cout;
+
+//  heap::create builds from right to left, one position at a time, so it
+//  uses one core however large the text is.  A shardedHeap cuts the text
+//  into 'shardCount' pieces of about the same length and builds a heap for
+//  each, several at a time.  The piece for a shard is its own part of the
+//  text followed by the first maxPatternLength-1 characters of the next
+//  part, so every occurrence of a pattern of up to maxPatternLength
+//  characters that starts in a shard's own part lies wholly inside that
+//  shard's piece.  A search asks every shard, translates its positions
+//  into positions in the whole text, and keeps only those that start in
+//  the shard's own part; an occurrence that starts in the overlap is
+//  reported by the next shard, which owns it.
+//
+//  Positions are numbered from the right end of the whole text, as in a
+//  heap.  A piece that ends 'e' characters from the left end of the text
+//  is the text whose position 0 is at textLength-e, so a shard's positions
+//  are translated by adding textLength - shardEnd.
+//
+//  A search costs O(m + k) in each shard, or O(sm + k) in all for s
+//  shards, so it pays to have no more shards than there are cores to
+//  build them.  A longer pattern could span two shards, so its first
+//  maxPatternLength characters are searched for instead, and each of their
+//  occurrences is kept if the rest of the pattern follows it in the text;
+//  that costs O(m) for each occurrence of the prefix.  The shards index
+//  the text in place, so the caller must keep it for as long as the
+//  shardedHeap is in use.
+
+/****************************
+ * shardedHeap:  build the heaps for the 'length' characters at 'str', in
+ * 'shardCount' pieces that overlap by 'maxPatternLength'-1 characters,
+ * on 'threadCount' threads.  If either count is 0 or less,
+ * use one per core.
+ * **************************/
+shardedHeap::shardedHeap(const char *str, long long length, int shardCount,
+                         int maxPatternLength, int threadCount)
+{
+    if (maxPatternLength < 1)
+       {cout << "shardedHeap:  the maximum pattern length must be positive\n";
+        exit(1);}
+    if (length < 1)
+       {cout << "shardedHeap:  cannot index an empty text\n"; exit(1);}
+    if (threadCount <= 0)
+        threadCount = std::thread::hardware_concurrency();
+    if (shardCount <= 0)
+        shardCount = std::thread::hardware_concurrency();
+    if (shardCount > length)
+        shardCount = length;
+    text = str;
+    textLength = length;
+    this->maxPatternLength = maxPatternLength;
+    this->shardCount = shardCount;
+
+    shards = new heap *[shardCount];
+    shardStart = new long long[shardCount];
+    shardEnd = new long long[shardCount];
+    if (!shards || !shardStart || !shardEnd)
+       {cout << "Memory allocation failure in shardedHeap\n"; exit(1);}
+    long long partLength = (length + shardCount - 1) / shardCount;
+    for (int i = 0; i < shardCount; i++)
+    {
+        shardStart[i] = i * partLength;
+        if (shardStart[i] > length) shardStart[i] = length;
+    }
+    for (int i = 0; i < shardCount; i++)
+    {
+        shardEnd[i] = length;
+        if (i < shardCount - 1
+                && shardStart[i + 1] + maxPatternLength - 1 < length)
+            shardEnd[i] = shardStart[i + 1] + maxPatternLength - 1;
+    }
+    // the last pieces may be empty if the text is short; drop them
+    while (this->shardCount > 1
+               && shardStart[this->shardCount - 1] >= length)
+        this->shardCount--;
+    buildShards (threadCount);
+}
+
+shardedHeap::~shardedHeap()
+{
+    for (int i = 0; i < shardCount; i++)
+        delete shards[i];
+    delete []shards;
+    delete []shardStart;
+    delete []shardEnd;
+}
+
+// buildShards:  build the heaps on 'threadCount' threads, counting the 
+//  caller's
+void shardedHeap::buildShards(int threadCount)
+{
+    std::atomic<int> nextShard (0);
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threadCount && t < shardCount; t++)
+        workers.push_back (std::thread (&shardedHeap::buildLoop, this, 
+                                        &nextShard));
+    buildLoop (&nextShard);
+    for (unsigned t = 0; t < workers.size(); t++)
+        workers[t].join();
+}
+
+// buildLoop:  build shards until there are none left; 'nextShard' is the
+//  next one that no thread has taken
+void shardedHeap::buildLoop(std::atomic<int> *nextShard)
+{
+    int i;
+    while ((i = (*nextShard)++) < shardCount)
+        shards[i] = heap::create (text + shardStart[i],
+                                  shardEnd[i] - shardStart[i]);
+}
+
+/****************************
+ * search:  the positions of all occurrences of the pattern in the whole
+ * text, in a list that the caller must delete, as with heap::search.
+ * **************************/
+mylist *shardedHeap::search(const char *pattern, int patternLength) const
+{
+    if (patternLength > maxPatternLength)
+        return longSearch (pattern, patternLength);
+    mylist *Occurrences = new mylist();
+    if (! Occurrences)
+       {cout << "Memory allocation failure in shardedHeap::search\n"; exit(1);}
+    queryContext context;
+    for (int i = 0; i < shardCount; i++)
+    {
+        long long hits = shards[i]->search (pattern, patternLength, context);
+        const long long *positions = context.getOccurrences();
+        long long offset = textLength - shardEnd[i];
+
+        // positions above 'ownedAfter' start in the shard's own part
+        long long ownedAfter = -1;
+        if (i < shardCount - 1)
+            ownedAfter = textLength - 1 - shardStart[i + 1];
+        for (long long h = 0; h < hits; h++)
+            if (positions[h] + offset > ownedAfter)
+                Occurrences->add (positions[h] + offset);
+    }
+    return Occurrences;
+}
+
+/****************************
+ * longSearch:  'search', for a pattern longer than maxPatternLength (see
+ * above).  The positions of the prefix are those of the pattern, if the
+ * rest of it follows.
+ * **************************/
+mylist *shardedHeap::longSearch(const char *pattern, int patternLength) const
+{
+    mylist *Occurrences = search (pattern, maxPatternLength);
+    long long *positions = Occurrences->getArray();
+    long long kept = 0;
+    int restLength = patternLength - maxPatternLength;
+    for (long long h = 0; h < Occurrences->size(); h++)
+    {
+        long long rest = textLength - positions[h] - 1 + maxPatternLength;
+        if (rest + restLength <= textLength 
+                && memcmp (text + rest, pattern + maxPatternLength, 
+                           restLength) == 0)
+            positions[kept++] = positions[h];
+    }
+    Occurrences->truncate (kept);
+    return Occurrences;
+}
+
+/****************************
+ * count:  the number of occurrences of the pattern in the whole text.
+ * Each shard counts its occurrences in O(m) time, and those that lie
+ * wholly in an overlap, which two shards count, are subtracted; an
+ * overlap is shorter than the longest pattern, so it is simply scanned.
+ * A longer pattern is counted by searching for it.
+ * **************************/
+long long shardedHeap::count(const char *pattern, int patternLength) const
+{
+    if (patternLength > maxPatternLength)
+    {
+        mylist *Occurrences = longSearch (pattern, patternLength);
+        long long total = Occurrences->size();
+        delete Occurrences;
+        return total;
+    }
+    long long total = 0;
+    for (int i = 0; i < shardCount; i++)
+    {
+        total += shards[i]->count (pattern, patternLength);
+        if (i == shardCount - 1) break;
+        for (long long start = shardStart[i + 1]; start < shardEnd[i]
+                 && start + patternLength <= shardEnd[i]; start++)
+            if (memcmp (text + start, pattern, patternLength) == 0)
+                total--;
+    }
+    return total;
+}
+
+// contains:  whether the pattern occurs anywhere in the text
+bool shardedHeap::contains(const char *pattern, int patternLength) const
+{
+    if (patternLength > maxPatternLength)
+        return count (pattern, patternLength) > 0;
+    for (int i = 0; i < shardCount; i++)
+        if (shards[i]->contains (pattern, patternLength))
+            return true;
+    return false;
+}
+
+long long shardedHeap::getTextLength() const
+{
+    return textLength;
+}
+
+int shardedHeap::getShardCount() const
+{
+    return shardCount;
+}
+
+int shardedHeap::getMaxPatternLength() const
+{
+    return maxPatternLength;
+}
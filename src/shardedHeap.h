@@ -0,0 +1,35 @@
+/*************************
+  shardedHeap.h:  see shardedHeap.cpp
+ ************************/
+#include <atomic>
+
+template <class Symbol> class basicHeap;
+typedef basicHeap<char> heap;
+class mylist;
+class shardedHeap
+{
+    public:
+        shardedHeap (const char *str, long long length, int shardCount,
+                     int maxPatternLength, int threadCount);
+        ~shardedHeap ();
+        mylist *search (const char *pattern, int patternLength) const;
+        long long count (const char *pattern, int patternLength) const;
+        bool contains (const char *pattern, int patternLength) const;
+        long long getTextLength () const;
+        int getShardCount () const;
+        int getMaxPatternLength () const;
+    private:
+        const char *text;      // the whole text, which the shards index
+        long long textLength;  //   in place
+        int maxPatternLength;  // longest pattern the shards answer alone
+        int shardCount;
+        heap **shards;
+        long long *shardStart; // first character of each shard, counted
+                               //   from the left end of the text
+        long long *shardEnd;   // one past its last character, counted the
+                               //   same way
+
+        void buildShards (int threadCount);
+        void buildLoop (std::atomic<int> *nextShard);
+        mylist *longSearch (const char *pattern, int patternLength) const;
+};
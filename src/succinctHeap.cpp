@@ -0,0 +1,655 @@
+/****************************
+ * succinctHeap.cpp:  a read-only copy of a position heap, for serving
+ * queries from several large indexes on one machine
+ * **************************/
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <stdint.h>
+#include "heap.h"
+#include "downNode.h"
+#include "childIndex.h"
+#include "mylist.h"
+#include "queryContext.h"
+#include "bitVector.h"
+#include "succinctHeap.h"
+using std::cout;
+
+/***********************
+Once a heap is built, searching it needs its tree, the maximal-reach
+pointers and the DFS times; the heap keeps these as five integers per
+node, and the DFS order as a sixth, which is 24 bytes per letter of text
+with 32-bit positions.  A succinctHeap keeps the same information in
+far less (see memoryUsage), at the price of slower navigation:
+
+  - The tree is a string of balanced parentheses in preorder, an opening
+    parenthesis when the DFS discovers a node and a closing one when it
+    finishes it.  A node is numbered by its rank in preorder, which is
+    its discovery time, and its opening parenthesis is the one of that
+    rank (select).  Its subtree is the ranks from its own through the
+    number of nodes up to its closing parenthesis (findClose), so the
+    finishing time is not kept; nor are the child and sibling pointers,
+    since a node's first child opens right after it, and each child's
+    next sibling right after the child closes.  The label on the edge
+    into each node is kept by rank, and the children of a node with
+    many are kept in a childIndex, by rank, as in the heap.
+
+  - The position of each node, which is its name in the heap, is kept by
+    rank in as many bits as the largest position takes.  Pruning looks
+    nodes up by position, so the inverse permutation is needed too; it is
+    not kept, but found by following the cycle of the permutation that
+    holds the position, using a pointer back SHORTCUT_STEP steps along
+    it that is kept at every SHORTCUT_STEP-th element of each cycle.
+    This takes at most 2*SHORTCUT_STEP steps.
+
+  - The maximal reach of a node is a descendant of it, so its rank is at
+    least the node's, and close to it when the subtree between them is
+    small, as it mostly is.  The difference is kept instead, in blocks of
+    REACH_BLOCK nodes that each take only as many bits per node as the
+    largest difference in the block.
+
+The heap's search is followed step for step, in ranks instead of node
+ids.  One step is cheaper here:  when pruning checks whether a node is
+an ancestor of the end of the indexing path whose maximal reach lies in
+the end's subtree, the node and the end are both ancestors of that
+maximal reach, so they are on one path from the root, and which is the
+deeper is given by their ranks, without finding the node's subtree.
+*************************/
+const int PAREN_BLOCK = 512;       // parentheses per leaf of minTree
+const int REACH_BLOCK = 64;        // nodes per block of maxReach
+const int SHORTCUT_STEP = 16;      // elements between back pointers
+
+// The excess of a byte of parentheses, scanned from its lowest bit, at its
+//  end and at its lowest point; findClose skips whole bytes with these
+struct excessTable
+{
+    signed char total[256];
+    signed char minimum[256];
+    excessTable()
+    {
+        for (int byte = 0; byte < 256; byte++)
+        {
+            int excess = 0, least = 8;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                excess += (byte >> bit) & 1 ? 1 : -1;
+                if (excess < least) least = excess;
+            }
+            total[byte] = excess;
+            minimum[byte] = least;
+        }
+    }
+};
+static const excessTable EXCESS;
+
+/****************************
+ * succinctHeap:  copy the tree and pointers of 'H', which may be freed
+ * afterwards; the text is not needed either.
+ * **************************/
+template <class Symbol>
+succinctHeap<Symbol>::succinctHeap(const basicHeap<Symbol> *H)
+{
+    const positionHeap<uint32_t, Symbol> *compactHeap
+        = dynamic_cast<const positionHeap<uint32_t, Symbol> *> (H);
+    if (compactHeap)
+        build (compactHeap);
+    else
+        build (dynamic_cast<const positionHeap<uint64_t, Symbol> *> (H));
+}
+
+template <class Symbol>
+succinctHeap<Symbol>::~succinctHeap()
+{
+    delete parens;
+    delete []minTree;
+    delete []labels;
+    delete positions;
+    delete shortcuts;
+    delete backs;
+    delete []reachBits;
+    delete []reachStart;
+    delete indexed;
+    delete children;
+}
+
+/****************************
+ * build:  lay out the tree of 'H' in preorder, with an iterative DFS as
+ * in the heap's setDiscoveryFinishing, then its maximal-reach pointers
+ * **************************/
+template <class Symbol>
+template <class Index>
+void succinctHeap<Symbol>::build(const positionHeap<Index, Symbol> *H)
+{
+    textLength = H->textLength;
+    lastLetter = H->letter(0);
+    parens = new bitVector(2 * textLength);
+    labels = new Symbol[textLength];
+    positions = new packedArray(textLength,
+                                packedArray::widthOf (textLength - 1));
+    indexed = new bitVector(textLength);
+    children = new childIndex<uint64_t, Symbol>();
+    Index *rankOf = new Index[textLength];   // the inverse of 'positions'
+    if (!labels || !rankOf)
+       {cout << "Memory allocation failure in succinctHeap\n"; exit(1);}
+
+    const downNode<Index, Symbol> *down = H->downArray;
+    mylist stack;   // path from the root to the current node
+    long long rank = 0, paren = 0;
+    Index current = ROOT;
+    do
+    {
+        if (current != H->NOCHILD)   // discover 'current'
+        {
+            rankOf[current] = rank;
+            positions->set(rank, current);
+            labels[rank] = down[current].getLabel();
+            if (down[current].isIndexed())
+            {
+                indexed->set(rank);
+                children->addNode(rank);
+            }
+            if (stack.size() > 0)
+            {
+                Index parent = stack.getElement(stack.size() - 1);
+                if (down[parent].isIndexed())
+                    children->add(rankOf[parent], labels[rank], rank);
+            }
+            parens->set(paren++);
+            rank++;
+            stack.add(current);
+            current = down[current].getChild();
+        }
+        else                         // finish the node on top of the stack
+        {
+            Index finished = stack.removeLast();
+            paren++;
+            current = finished == ROOT ? H->NOCHILD
+                                       : down[finished].getSibling();
+        }
+    } while (stack.size() > 0);
+    parens->finish();
+    indexed->finish();
+    buildMinTree();
+
+    // The maximal reaches, as differences of ranks:  first the width of
+    //  each block, then the differences themselves
+    long long blocks = (textLength + REACH_BLOCK - 1) / REACH_BLOCK;
+    reachStart = new long long[blocks + 1];
+    if (!reachStart)
+       {cout << "Memory allocation failure in succinctHeap\n"; exit(1);}
+    memset (reachStart, 0, (blocks + 1) * sizeof(long long));
+    for (long long node = 0; node < textLength; node++)
+    {
+        long long difference = rankOf[H->maxReach[node]] - rankOf[node];
+        long long &widest = reachStart[rankOf[node] / REACH_BLOCK + 1];
+        if (difference > 0 && packedArray::widthOf (difference) > widest)
+            widest = packedArray::widthOf (difference);
+    }
+    for (long long b = 0; b < blocks; b++)
+        reachStart[b + 1] = reachStart[b] + reachStart[b + 1] * REACH_BLOCK;
+    long long reachWords = reachStart[blocks] / 64 + 2;
+    reachBits = new uint64_t[reachWords];
+    if (!reachBits)
+       {cout << "Memory allocation failure in succinctHeap\n"; exit(1);}
+    memset (reachBits, 0, reachWords * sizeof(uint64_t));
+    for (long long node = 0; node < textLength; node++)
+    {
+        long long nodeRank = rankOf[node];
+        long long b = nodeRank / REACH_BLOCK;
+        int width = (reachStart[b + 1] - reachStart[b]) / REACH_BLOCK;
+        packedArray::writeBits (reachBits, reachStart[b]
+                                    + nodeRank % REACH_BLOCK * width, width,
+                                rankOf[H->maxReach[node]] - nodeRank);
+    }
+    delete []rankOf;
+    buildShortcuts();
+}
+
+// buildMinTree:  the lowest excess in each block of PAREN_BLOCK
+//  parentheses, at the leaves of a complete binary tree whose inner
+//  nodes hold the minimum of their children
+template <class Symbol>
+void succinctHeap<Symbol>::buildMinTree()
+{
+    long long length = parens->getLength();
+    long long blocks = (length + PAREN_BLOCK - 1) / PAREN_BLOCK;
+    treeLeaves = 1;
+    while (treeLeaves < blocks) treeLeaves *= 2;
+    minTree = new long long[2 * treeLeaves];
+    if (!minTree)
+       {cout << "Memory allocation failure in succinctHeap\n"; exit(1);}
+    for (long long leaf = 0; leaf < treeLeaves; leaf++)
+        minTree[treeLeaves + leaf] = LLONG_MAX;
+    long long excess = 0;
+    for (long long i = 0; i < length; i++)
+    {
+        excess += parens->get(i) ? 1 : -1;
+        long long &least = minTree[treeLeaves + i / PAREN_BLOCK];
+        if (excess < least) least = excess;
+    }
+    for (long long node = treeLeaves - 1; node >= 1; node--)
+        minTree[node] = minTree[2 * node] < minTree[2 * node + 1]
+                            ? minTree[2 * node] : minTree[2 * node + 1];
+}
+
+// buildShortcuts:  mark every SHORTCUT_STEP-th element of each cycle of
+//  'positions', starting from its least, and give each marked element a
+//  pointer back to the one marked before it, or the first the last one
+template <class Symbol>
+void succinctHeap<Symbol>::buildShortcuts()
+{
+    shortcuts = new bitVector(textLength);
+    bitVector *visited = new bitVector(textLength);
+    for (long long start = 0; start < textLength; start++)
+    {
+        if (visited->get(start)) continue;
+        long long step = 0, element = start;
+        do
+        {
+            visited->set(element);
+            if (step++ % SHORTCUT_STEP == 0) shortcuts->set(element);
+            element = positions->get(element);
+        } while (element != start);
+    }
+    delete visited;
+    shortcuts->finish();
+
+    backs = new packedArray(shortcuts->getOnes(),
+                            packedArray::widthOf (textLength - 1));
+    visited = new bitVector(textLength);
+    for (long long start = 0; start < textLength; start++)
+    {
+        if (visited->get(start)) continue;
+        long long element = start, marked = start;
+        do
+        {
+            visited->set(element);
+            element = positions->get(element);
+            if (element != start && shortcuts->get(element))
+            {
+                backs->set(shortcuts->rank(element), marked);
+                marked = element;
+            }
+        } while (element != start);
+        backs->set(shortcuts->rank(start), marked);
+    }
+    delete visited;
+}
+
+// excess:  the number of opening parentheses before 'position', less the
+//  number of closing ones
+template <class Symbol>
+inline long long succinctHeap<Symbol>::excess(long long position) const
+{
+    return 2 * parens->rank(position) - position;
+}
+
+/****************************
+ * findClose:  the closing parenthesis that matches the one at 'open'.  It
+ * is the first after 'open' that brings the excess back to what it was
+ * before 'open'.  The rest of the block of 'open' is scanned; if it is
+ * not there, minTree gives the first block to the right whose excess
+ * falls that low, which is scanned from its start.
+ * **************************/
+template <class Symbol>
+long long succinctHeap<Symbol>::findClose(long long open) const
+{
+    long long length = parens->getLength();
+    long long target = excess(open);
+    long long block = open / PAREN_BLOCK;
+    long long end = (block + 1) * PAREN_BLOCK;
+    long long close = scanClose(open + 1, end < length ? end : length,
+                                target + 1, target);
+    if (close >= 0) return close;
+
+    long long node = treeLeaves + block;
+    while (node & 1 || minTree[node + 1] > target)   // climb ...
+        node >>= 1;
+    node++;
+    while (node < treeLeaves)                        // ... and descend
+    {
+        node *= 2;
+        if (minTree[node] > target) node++;
+    }
+    long long start = (node - treeLeaves) * PAREN_BLOCK;
+    end = start + PAREN_BLOCK;
+    return scanClose(start, end < length ? end : length, excess(start),
+                     target);
+}
+
+// scanClose:  the first parenthesis in [from, to) after which the excess
+//  is 'target' or less, given the 'excess' before 'from'; -1 if none is
+template <class Symbol>
+long long succinctHeap<Symbol>::scanClose(long long from, long long to,
+                                          long long excess,
+                                          long long target) const
+{
+    const uint64_t *words = parens->getWords();
+    long long i = from;
+    for (;;)
+    {
+        // a bit at a time up to a byte boundary, or through a byte that
+        //  reaches the target ...
+        for ( ; i < to && (i & 7); i++)
+        {
+            excess += (words[i >> 6] >> (i & 63)) & 1 ? 1 : -1;
+            if (excess <= target) return i;
+        }
+        // ... and whole bytes that do not
+        for ( ; i + 8 <= to; i += 8)
+        {
+            int byte = (words[i >> 6] >> (i & 63)) & 0xFF;
+            if (excess + EXCESS.minimum[byte] <= target) break;
+            excess += EXCESS.total[byte];
+        }
+        if (i >= to) return -1;
+        if (i + 8 > to)   // the last partial byte
+        {
+            for ( ; i < to; i++)
+            {
+                excess += (words[i >> 6] >> (i & 63)) & 1 ? 1 : -1;
+                if (excess <= target) return i;
+            }
+            return -1;
+        }
+        for (int bit = 0; bit < 8; bit++, i++)
+        {
+            excess += (words[i >> 6] >> (i & 63)) & 1 ? 1 : -1;
+            if (excess <= target) return i;
+        }
+    }
+}
+
+// subtreeSize:  the number of nodes in the subtree of the node that
+//  opens at 'open'
+template <class Symbol>
+long long succinctHeap<Symbol>::subtreeSize(long long open) const
+{
+    return (findClose (open) - open + 1) / 2;
+}
+
+// nodeAt:  the rank of the node at 'position'; see above
+template <class Symbol>
+long long succinctHeap<Symbol>::nodeAt(long long position) const
+{
+    long long element = position;
+    bool jumped = false;
+    for (;;)
+    {
+        long long next = positions->get(element);
+        if (next == position) return element;
+        if (!jumped && shortcuts->get(element))
+        {
+            element = backs->get(shortcuts->rank(element));
+            jumped = true;
+        }
+        else
+            element = next;
+    }
+}
+
+// maxReach:  the rank of the maximal reach of the node of rank 'node'
+template <class Symbol>
+long long succinctHeap<Symbol>::maxReach(long long node) const
+{
+    long long b = node / REACH_BLOCK;
+    int width = (reachStart[b + 1] - reachStart[b]) / REACH_BLOCK;
+    return node + packedArray::readBits (reachBits, reachStart[b]
+                                             + node % REACH_BLOCK * width,
+                                         width);
+}
+
+/****************************
+ * childOnLetter:  the child on letter 'c' of the node of rank 'node',
+ * whose parenthesis opens at 'open', or NOCHILD.  The child's opening
+ * parenthesis goes in 'childOpen'.
+ * **************************/
+template <class Symbol>
+long long succinctHeap<Symbol>::childOnLetter(long long node, long long open,
+                                              Symbol c,
+                                              long long &childOpen) const
+{
+    if (indexed->get(node))
+    {
+        uint64_t child = children->find(node, c);
+        if (child == childIndex<uint64_t, Symbol>::NOCHILD) return NOCHILD;
+        childOpen = parens->select(child);
+        return child;
+    }
+    long long child = node + 1;
+    long long length = parens->getLength();
+    for (long long i = open + 1; i < length && parens->get(i); )
+    {
+        if (labels[child] == c)
+        {
+            childOpen = i;
+            return child;
+        }
+        long long close = findClose (i);
+        child += (close - i + 1) / 2;
+        i = close + 1;
+    }
+    return NOCHILD;
+}
+
+// indexIntoTrie:  as in the heap; the opening parenthesis of the node
+//  returned goes in 'endOpen'
+template <class Symbol>
+long long succinctHeap<Symbol>::indexIntoTrie(const Symbol *pattern,
+                                              int patternLength,
+                                              int &endDepth,
+                                              long long &endOpen) const
+{
+    long long node = ROOT, open = 0;
+    endDepth = 0;
+    endOpen = 0;
+    for (int depth = 0; depth < patternLength; depth++)
+    {
+        long long childOpen;
+        long long child = childOnLetter(node, open, pattern[depth],
+                                        childOpen);
+        if (child == NOCHILD) break;
+        node = child;
+        open = childOpen;
+        endDepth = depth + 1;
+    }
+    endOpen = open;
+    return node;
+}
+
+/****************************
+ * search:  the positions of the occurrences of the pattern, in a new list
+ * that the caller must delete
+ * **************************/
+template <class Symbol>
+mylist *succinctHeap<Symbol>::search(const Symbol *pattern,
+                                     int patternLength) const
+{
+    mylist *Occurrences = new mylist();
+    findOccurrences (pattern, patternLength, Occurrences);
+    return Occurrences;
+}
+
+// search:  the same search, with the positions left in 'context'
+template <class Symbol>
+long long succinctHeap<Symbol>::search(const Symbol *pattern,
+                                       int patternLength,
+                                       queryContext &context) const
+{
+    context.occurrences->clear();
+    findOccurrences (pattern, patternLength, context.occurrences);
+    return context.occurrences->size();
+}
+
+// findOccurrences:  the heap's findOccurrences and genCandidates together
+template <class Symbol>
+void succinctHeap<Symbol>::findOccurrences(const Symbol *pattern,
+                                           int patternLength,
+                                           mylist *Occurrences) const
+{
+    int pathEndDepth;
+    long long endOpen;
+    long long pathEnd = indexIntoTrie (pattern, patternLength, pathEndDepth,
+                                       endOpen);
+    long long endSize = subtreeSize (endOpen);
+
+    // the proper ancestors of the end of the path that are occurrences
+    long long node = ROOT, open = 0;
+    for (int depth = 0; node != pathEnd; depth++)
+    {
+        if ((unsigned long long) (maxReach (node) - pathEnd)
+                < (unsigned long long) endSize)
+            Occurrences->add(positions->get(node));
+        node = childOnLetter (node, open, pattern[depth], open);
+    }
+
+    if (pathEndDepth == patternLength)   // and its whole subtree ...
+    {
+        long long *added = Occurrences->extend (endSize);
+        for (long long i = 0; i < endSize; i++)
+            added[i] = positions->get(pathEnd + i);
+        return;
+    }
+    Occurrences->add(positions->get(pathEnd));   // ... or only it
+    int offset = pathEndDepth;
+    int candidateCount = Occurrences->size();
+    while (offset < patternLength && candidateCount > 0)
+        candidateCount = pruneCandidates (pattern + offset,
+                                          patternLength - offset,
+                                          Occurrences->getArray(),
+                                          candidateCount, offset);
+    Occurrences->truncate(candidateCount);
+}
+
+// pruneCandidates:  as in the heap; see above for the difference
+template <class Symbol>
+int succinctHeap<Symbol>::pruneCandidates(const Symbol *suffix,
+                                          int suffixLength,
+                                          long long *candidates,
+                                          int candidateCount,
+                                          int &offset) const
+{
+    int pathEndDepth;
+    long long endOpen;
+    long long pathEnd = indexIntoTrie (suffix, suffixLength, pathEndDepth,
+                                       endOpen);
+    bool fellOffTree = (pathEndDepth < suffixLength);
+    int kept = 0;
+    if (pathEndDepth > 0)
+    {
+        unsigned long long endSize = subtreeSize (endOpen);
+        for (int index = 0; index < candidateCount; index++)
+        {
+            long long h = candidates[index];
+            if (h < offset) continue;
+            long long node = nodeAt (h - offset);
+            if (((unsigned long long) (maxReach (node) - pathEnd) < endSize
+                     && node <= pathEnd)
+                  || (!fellOffTree
+                      && (unsigned long long) (node - pathEnd) < endSize))
+                candidates[kept++] = h;
+        }
+        offset += pathEndDepth;
+    }
+    else if (suffixLength == 1 && suffix[0] == lastLetter)
+    {
+        for (int index = 0; index < candidateCount; index++)
+            if (candidates[index] == offset)
+                candidates[kept++] = offset;
+        offset += suffixLength;
+    }
+    return kept;
+}
+
+/****************************
+ * count:  the number of occurrences of the pattern, as the heap counts
+ * them
+ * **************************/
+template <class Symbol>
+long long succinctHeap<Symbol>::count(const Symbol *pattern,
+                                      int patternLength) const
+{
+    int pathEndDepth;
+    long long endOpen;
+    long long pathEnd = indexIntoTrie (pattern, patternLength, pathEndDepth,
+                                       endOpen);
+    unsigned long long endSize = subtreeSize (endOpen);
+
+    long long stackCandidates[CANDIDATE_BUFFER];
+    long long *candidates = stackCandidates;
+    if (pathEndDepth + 1 > CANDIDATE_BUFFER)
+        candidates = new long long[pathEndDepth + 1];
+    int candidateCount = 0;
+    long long node = ROOT, open = 0;
+    for (int depth = 0; node != pathEnd; depth++)
+    {
+        if ((unsigned long long) (maxReach (node) - pathEnd) < endSize)
+            candidates[candidateCount++] = positions->get(node);
+        node = childOnLetter (node, open, pattern[depth], open);
+    }
+
+    long long total;
+    if (pathEndDepth == patternLength)
+        total = candidateCount + endSize;
+    else
+    {
+        candidates[candidateCount++] = positions->get(pathEnd);
+        int offset = pathEndDepth;
+        while (offset < patternLength && candidateCount > 0)
+            candidateCount = pruneCandidates (pattern + offset,
+                                              patternLength - offset,
+                                              candidates, candidateCount,
+                                              offset);
+        total = candidateCount;
+    }
+    if (candidates != stackCandidates) delete []candidates;
+    return total;
+}
+
+// contains:  whether the pattern occurs at all
+template <class Symbol>
+bool succinctHeap<Symbol>::contains(const Symbol *pattern,
+                                    int patternLength) const
+{
+    int pathEndDepth;
+    long long endOpen;
+    indexIntoTrie (pattern, patternLength, pathEndDepth, endOpen);
+    if (pathEndDepth == patternLength)
+        return true;
+    return count (pattern, patternLength) > 0;
+}
+
+// isDescendant:  whether the node at 'position1' is in the subtree of the
+//  node at 'position2', as in the heap
+template <class Symbol>
+bool succinctHeap<Symbol>::isDescendant(long long position1,
+                                        long long position2) const
+{
+    long long node1 = nodeAt (position1), node2 = nodeAt (position2);
+    return (unsigned long long) (node1 - node2)
+               < (unsigned long long) subtreeSize (parens->select(node2));
+}
+
+template <class Symbol>
+long long succinctHeap<Symbol>::getTextLength() const
+{
+    return textLength;
+}
+
+// memoryUsage:  bytes taken by all of the structures above
+template <class Symbol>
+long long succinctHeap<Symbol>::memoryUsage() const
+{
+    long long blocks = (textLength + REACH_BLOCK - 1) / REACH_BLOCK;
+    return parens->memoryUsage() + 2 * treeLeaves * sizeof(long long)
+           + textLength * sizeof(Symbol) + positions->memoryUsage()
+           + shortcuts->memoryUsage() + backs->memoryUsage()
+           + (reachStart[blocks] / 64 + 2) * sizeof(uint64_t)
+           + (blocks + 1) * sizeof(long long)
+           + indexed->memoryUsage() + children->memoryUsage();
+}
+
+template class succinctHeap<char>;
+template class succinctHeap<uint16_t>;
+template class succinctHeap<uint32_t>;
@@ -0,0 +1,68 @@
+/*************************
+  succinctHeap.h:  see succinctHeap.cpp
+ ************************/
+template <class Symbol> class basicHeap;
+template <class Index, class Symbol> class positionHeap;
+template <class Index, class Symbol> class childIndex;
+class bitVector;
+class packedArray;
+class mylist;
+class queryContext;
+
+// A read-only copy of a position heap that answers the same queries in a
+//  fraction of the space; see succinctHeap.cpp.  Nodes are numbered by
+//  their rank in preorder, and positions are reported as the heap reports
+//  them.
+template <class Symbol>
+class succinctHeap
+{
+    public:
+        succinctHeap (const basicHeap<Symbol> *H);
+        ~succinctHeap ();
+        mylist *search (const Symbol *pattern, int patternLength) const;
+        long long search (const Symbol *pattern, int patternLength,
+                          queryContext &context) const;
+        long long count (const Symbol *pattern, int patternLength) const;
+        bool contains (const Symbol *pattern, int patternLength) const;
+        bool isDescendant (long long position1, long long position2) const;
+        long long getTextLength () const;
+        long long memoryUsage () const;
+    private:
+        static const long long NOCHILD = -1;
+
+        long long textLength;  // number of letters, and of nodes
+        Symbol lastLetter;     // the letter at position 0 (see search)
+        bitVector *parens;     // the tree as balanced parentheses, 1 for
+                               //   an opening one, in preorder
+        long long *minTree;    // minimum excess of each block of parens,
+        long long treeLeaves;  //   in a complete binary tree; see findClose
+        Symbol *labels;        // letter on the edge into each node
+        packedArray *positions;  // position of each node
+        bitVector *shortcuts;  // nodes on a cycle of 'positions' that have
+        packedArray *backs;    //   a pointer back along it; see nodeAt
+        uint64_t *reachBits;   // maxReach of each node, as the difference
+        long long *reachStart; //   of ranks, in blocks of REACH_BLOCK
+        bitVector *indexed;    // nodes whose children are in 'children'
+        childIndex<uint64_t, Symbol> *children;
+
+        template <class Index>
+        void build (const positionHeap<Index, Symbol> *H);
+        void buildMinTree ();
+        void buildShortcuts ();
+        long long excess (long long position) const;
+        long long findClose (long long open) const;
+        long long scanClose (long long from, long long to, long long excess,
+                             long long target) const;
+        long long subtreeSize (long long open) const;
+        long long nodeAt (long long position) const;
+        long long maxReach (long long node) const;
+        long long childOnLetter (long long node, long long open, Symbol c,
+                                 long long &childOpen) const;
+        long long indexIntoTrie (const Symbol *pattern, int patternLength,
+                                 int &endDepth, long long &endOpen) const;
+        void findOccurrences (const Symbol *pattern, int patternLength,
+                              mylist *Occurrences) const;
+        int pruneCandidates (const Symbol *pattern, int patternLength,
+                             long long *candidates, int candidateCount,
+                             int &offset) const;
+};
@@ -0,0 +1,124 @@
+/****************************
+ * waveletMatrix.cpp:  range reporting over a sequence of integers, for
+ * the heap's searches restricted to a window of the text (see
+ * heap::search)
+ * **************************/
+#include <iostream>
+#include <stdlib.h>
+#include "bitVector.h"
+#include "mylist.h"
+#include "waveletMatrix.h"
+using std::cout;
+
+//  Level 0 holds the most significant bit of each integer, in the order of
+//  the sequence.  Each level after it holds the next bit of each integer,
+//  in the order the level above leaves them in when it is stably sorted on
+//  its own bit, zeros first.  So the integers that share their top l bits
+//  lie together at level l, and an interval of the sequence becomes an
+//  interval at each level, found from the one above by two ranks:  an
+//  integer with i zeros before it above goes to i, and one with i ones
+//  before it goes to zeros[level] + i.  report follows the intervals down
+//  the levels, ones first, and drops any whose integers all lie outside
+//  the range of values, so it takes O(log s) time per integer listed,
+//  where s is the largest, plus O(log s) to find that there are no more.
+//  This takes as many bits per integer as it has, and a quarter as many
+//  again for the rank directories.
+
+/****************************
+ * waveletMatrix:  the 'length' integers at 'values', which need not be
+ * kept afterwards.  Value is uint32_t or uint64_t.
+ * **************************/
+template <class Value>
+waveletMatrix::waveletMatrix(const Value *values, long long length)
+{
+    this->length = length;
+    Value largest = 0;
+    for (long long i = 0; i < length; i++)
+        if (values[i] > largest) largest = values[i];
+    levels = packedArray::widthOf (largest);
+    bits = new bitVector *[levels];
+    zeros = new long long[levels];
+    Value *current = new Value[length];
+    Value *next = new Value[length];
+    if (!bits || !zeros || !current || !next)
+       {cout << "Memory allocation failure in waveletMatrix\n"; exit(1);}
+    for (long long i = 0; i < length; i++)
+        current[i] = values[i];
+
+    for (int level = 0; level < levels; level++)
+    {
+        int shift = levels - 1 - level;
+        bits[level] = new bitVector(length);
+        for (long long i = 0; i < length; i++)
+            if ((current[i] >> shift) & 1) bits[level]->set(i);
+        bits[level]->finish();
+        zeros[level] = length - bits[level]->getOnes();
+
+        long long zero = 0, one = zeros[level];   // sort stably on the bit
+        for (long long i = 0; i < length; i++)
+            next[(current[i] >> shift) & 1 ? one++ : zero++] = current[i];
+        Value *swap = current;
+        current = next;
+        next = swap;
+    }
+    delete []current;
+    delete []next;
+}
+
+waveletMatrix::~waveletMatrix()
+{
+    for (int level = 0; level < levels; level++)
+        delete bits[level];
+    delete []bits;
+    delete []zeros;
+}
+
+/****************************
+ * report:  add to 'values' the integers from 'first' through 'last' of
+ * the sequence that are from 'low' through 'high', in descending order
+ * **************************/
+void waveletMatrix::report(long long first, long long last, uint64_t low,
+                           uint64_t high, mylist *values) const
+{
+    if (first < 0) first = 0;
+    if (last >= length) last = length - 1;
+    reportLevel (0, first, last + 1, 0, low, high, values);
+}
+
+// reportLevel:  report the integers in [first, end) at 'level', whose bits
+//  above it are 'prefix'
+void waveletMatrix::reportLevel(int level, long long first, long long end,
+                                uint64_t prefix, uint64_t low, uint64_t high,
+                                mylist *values) const
+{
+    if (first >= end) return;
+    int shift = levels - level;   // bits below 'prefix'
+    uint64_t least = shift < 64 ? prefix << shift : 0;
+    uint64_t most = shift < 64 ? least + ((1ULL << shift) - 1) : ~0ULL;
+    if (most < low || least > high) return;
+    if (level == levels)
+    {
+        for (long long i = first; i < end; i++)
+            values->add(prefix);
+        return;
+    }
+    long long onesBefore = bits[level]->rank(first);
+    long long onesThrough = bits[level]->rank(end);
+    reportLevel (level + 1, zeros[level] + onesBefore,
+                 zeros[level] + onesThrough, 2 * prefix + 1, low, high,
+                 values);
+    reportLevel (level + 1, first - onesBefore, end - onesThrough,
+                 2 * prefix, low, high, values);
+}
+
+// memoryUsage:  bytes taken by the levels
+long long waveletMatrix::memoryUsage() const
+{
+    long long total = levels * (sizeof(bitVector *) + sizeof(long long));
+    for (int level = 0; level < levels; level++)
+        total += bits[level]->memoryUsage();
+    return total;
+}
+
+template waveletMatrix::waveletMatrix(const uint32_t *, long long);
+template waveletMatrix::waveletMatrix(const uint64_t *, long long);
@@ -0,0 +1,29 @@
+/*************************
+  waveletMatrix.h:  see waveletMatrix.cpp
+ ************************/
+#include <stdint.h>
+class bitVector;
+class mylist;
+
+// A fixed sequence of unsigned integers that lists, for any range of the
+//  sequence and any range of values, the integers of the one that lie in
+//  the other, largest first
+class waveletMatrix
+{
+    public:
+        template <class Value>
+        waveletMatrix (const Value *values, long long length);
+        ~waveletMatrix ();
+        void report (long long first, long long last, uint64_t low,
+                     uint64_t high, mylist *values) const;
+        long long memoryUsage () const;
+    private:
+        int levels;            // bits per integer
+        long long length;      // number of integers
+        bitVector **bits;      // one bit of each integer per level, most
+                               //   significant first; see waveletMatrix.cpp
+        long long *zeros;      // number of zeros at each level
+        void reportLevel (int level, long long first, long long end,
+                          uint64_t prefix, uint64_t low, uint64_t high,
+                          mylist *values) const;
+};